@@ -0,0 +1,226 @@
+/*
+ * AdaptiveOrder.hpp
+ *
+ * Evaluation order of filters for ordered mode (-c) when strict priority is
+ * not needed (--adaptive_order). Evaluation stops at the first filter that
+ * matches, so the expected cost per read is lowest when filters are sorted by
+ * cost / acceptance rate. Both are measured while reads are classified.
+ *
+ * Each thread counts into its own statistics. Every s_interval reads a thread
+ * merges them into the shared statistics and the order is recomputed. Threads
+ * pick up a new order before their next read.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef ADAPTIVEORDER_HPP_
+#define ADAPTIVEORDER_HPP_
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <omp.h>
+
+using namespace std;
+
+class AdaptiveOrder {
+public:
+	explicit AdaptiveOrder(unsigned filterNum) :
+			m_order(filterNum), m_version(0), m_stats(filterNum), m_reads(0), m_threads(
+					max(omp_get_max_threads(), 1)) {
+		for (unsigned i = 0; i < filterNum; ++i) {
+			m_order[i] = i;
+		}
+		for (vector<ThreadState>::iterator i = m_threads.begin();
+				i != m_threads.end(); ++i) {
+			i->order = m_order;
+			i->version = 0;
+			i->stats.resize(filterNum);
+			i->reads = 0;
+		}
+	}
+
+	/*
+	 * Order in which the calling thread should evaluate filters
+	 */
+	const vector<unsigned> &getOrder() {
+		ThreadState &ts = local();
+		unsigned version;
+#pragma omp atomic read
+		version = m_version;
+		if (version != ts.version) {
+#pragma omp critical(adaptiveOrder)
+			{
+				ts.order = m_order;
+				ts.version = m_version;
+			}
+		}
+		return ts.order;
+	}
+
+	/*
+	 * Records one evaluation of filter taking seconds
+	 */
+	void record(unsigned filter, bool hit, double seconds) {
+		Stats &stats = local().stats[filter];
+		++stats.evaluations;
+		stats.hits += hit;
+		stats.seconds += seconds;
+	}
+
+	/*
+	 * Call once per read (or pair) after its filters are evaluated
+	 */
+	void readDone() {
+		ThreadState &ts = local();
+		if (++ts.reads >= s_interval) {
+#pragma omp critical(adaptiveOrder)
+			merge(ts);
+		}
+	}
+
+	/*
+	 * Merges all remaining counts and prints how much evaluation work the
+	 * adaptive order saved compared with the command line order. Call outside
+	 * of parallel regions.
+	 */
+	void printStats(const vector<string> &filterIDs) {
+		for (vector<ThreadState>::iterator i = m_threads.begin();
+				i != m_threads.end(); ++i) {
+			merge(*i);
+		}
+		if (m_reads == 0) {
+			return;
+		}
+		size_t evaluations = 0;
+		double seconds = 0;
+		for (vector<Stats>::const_iterator i = m_stats.begin();
+				i != m_stats.end(); ++i) {
+			evaluations += i->evaluations;
+			seconds += i->seconds;
+		}
+		vector<unsigned> fixedOrder(m_order.size());
+		for (unsigned i = 0; i < fixedOrder.size(); ++i) {
+			fixedOrder[i] = i;
+		}
+		double fixedEvaluations = 0;
+		double fixedSeconds = 0;
+		expectedCost(fixedOrder, fixedEvaluations, fixedSeconds);
+		cerr << "Adaptive filter order:";
+		for (vector<unsigned>::const_iterator i = m_order.begin();
+				i != m_order.end(); ++i) {
+			cerr << " " << filterIDs[*i];
+		}
+		cerr << "\nFilter evaluations: " << evaluations
+				<< " Estimated in command line order: "
+				<< size_t(fixedEvaluations * m_reads) << " Saved: "
+				<< 100.0 * (1.0 - evaluations / (fixedEvaluations * m_reads))
+				<< "%\nEvaluation time: " << seconds
+				<< "s Estimated in command line order: "
+				<< fixedSeconds * m_reads << "s Saved: "
+				<< 100.0 * (1.0 - seconds / (fixedSeconds * m_reads)) << "%"
+				<< endl;
+	}
+
+private:
+	//reads a thread classifies between merges of its statistics
+	static const size_t s_interval = 10000;
+
+	struct Stats {
+		size_t evaluations;
+		size_t hits;
+		double seconds;
+		Stats() :
+				evaluations(0), hits(0), seconds(0) {
+		}
+	};
+
+	struct ThreadState {
+		vector<unsigned> order;
+		unsigned version;
+		vector<Stats> stats;
+		size_t reads;
+		//keep states of different threads on different cache lines
+		char padding[64];
+	};
+
+	vector<unsigned> m_order;
+	unsigned m_version;
+	vector<Stats> m_stats;
+	size_t m_reads;
+	vector<ThreadState> m_threads;
+
+	ThreadState &local() {
+		return m_threads[omp_get_thread_num() % m_threads.size()];
+	}
+
+	/*
+	 * Acceptance rate (with one pseudo hit and miss so unseen filters are not
+	 * ruled out) and mean seconds per evaluation of filter i
+	 */
+	void rates(unsigned i, double &acceptance, double &cost) const {
+		const Stats &stats = m_stats[i];
+		acceptance = (stats.hits + 1.0) / (stats.evaluations + 2.0);
+		cost = stats.evaluations > 0 ? stats.seconds / stats.evaluations : 0;
+	}
+
+	/*
+	 * Expected evaluations and seconds per read when filters are evaluated in
+	 * order, assuming filters match independently
+	 */
+	void expectedCost(const vector<unsigned> &order, double &evaluations,
+			double &seconds) const {
+		double reached = 1.0;
+		evaluations = 0;
+		seconds = 0;
+		for (vector<unsigned>::const_iterator i = order.begin();
+				i != order.end(); ++i) {
+			double acceptance, cost;
+			rates(*i, acceptance, cost);
+			evaluations += reached;
+			seconds += reached * cost;
+			reached *= 1.0 - acceptance;
+		}
+	}
+
+	struct ByCostPerHit {
+		const AdaptiveOrder &parent;
+		explicit ByCostPerHit(const AdaptiveOrder &p) :
+				parent(p) {
+		}
+		bool operator()(unsigned a, unsigned b) const {
+			double acceptA, costA, acceptB, costB;
+			parent.rates(a, acceptA, costA);
+			parent.rates(b, acceptB, costB);
+			return costA * acceptB < costB * acceptA;
+		}
+	};
+
+	/*
+	 * Must be called in critical(adaptiveOrder) or outside parallel regions
+	 */
+	void merge(ThreadState &ts) {
+		for (unsigned i = 0; i < m_stats.size(); ++i) {
+			m_stats[i].evaluations += ts.stats[i].evaluations;
+			m_stats[i].hits += ts.stats[i].hits;
+			m_stats[i].seconds += ts.stats[i].seconds;
+			ts.stats[i] = Stats();
+		}
+		m_reads += ts.reads;
+		ts.reads = 0;
+		//ties keep command line order
+		vector<unsigned> order(m_order.size());
+		for (unsigned i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		stable_sort(order.begin(), order.end(), ByCostPerHit(*this));
+		if (order != m_order) {
+			m_order = order;
+#pragma omp atomic
+			++m_version;
+		}
+	}
+};
+
+#endif /* ADAPTIVEORDER_HPP_ */
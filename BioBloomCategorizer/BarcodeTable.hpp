@@ -0,0 +1,148 @@
+/*
+ * BarcodeTable.hpp
+ *
+ * Maps index (barcode) sequences to samples for demultiplexing (--barcodes).
+ * The barcode file has one sample per line: a sample name followed by its
+ * barcode. Dual indexes are written as one barcode joined with '+'.
+ *
+ * All sequences within the allowed number of mismatches (0 or 1) of a barcode
+ * are precomputed so a lookup is a single hash table probe. Mismatched
+ * sequences that are shared by more than one sample are not assigned.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef BARCODETABLE_HPP_
+#define BARCODETABLE_HPP_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <google/dense_hash_map>
+
+using namespace std;
+
+static const string UNDETERMINED = "undetermined";
+
+class BarcodeTable {
+public:
+	BarcodeTable(const string &fileName, unsigned mismatches) {
+		m_exact.set_empty_key("");
+		m_mismatch.set_empty_key("");
+		ifstream barcodeFile(fileName.c_str());
+		if (!barcodeFile.is_open()) {
+			cerr << "Error: barcode file " << fileName << " cannot be opened"
+					<< endl;
+			exit(1);
+		}
+		string line;
+		for (unsigned lineNum = 1; getline(barcodeFile, line); ++lineNum) {
+			stringstream ss(line);
+			string name, barcode;
+			if (!(ss >> name) || name[0] == '#') {
+				continue;
+			}
+			if (!(ss >> barcode)) {
+				cerr << "Error: line " << lineNum << " of barcode file "
+						<< fileName << " should contain a sample name and "
+						<< "barcode" << endl;
+				exit(1);
+			}
+			if (m_exact.find(barcode) != m_exact.end()) {
+				cerr << "Error: barcode " << barcode << " is listed twice in "
+						<< fileName << endl;
+				exit(1);
+			}
+			m_exact[barcode] = m_names.size();
+			m_names.push_back(name);
+		}
+		if (m_names.empty()) {
+			cerr << "Error: barcode file " << fileName << " has no samples"
+					<< endl;
+			exit(1);
+		}
+		m_undetermined = m_names.size();
+		m_names.push_back(UNDETERMINED);
+		if (mismatches > 0) {
+			addMismatches();
+		}
+	}
+
+	/*
+	 * Returns the sample index of barcode, or getUndeterminedIndex()
+	 */
+	unsigned find(const string &barcode) const {
+		google::dense_hash_map<string, unsigned>::const_iterator itr =
+				m_exact.find(barcode);
+		if (itr != m_exact.end()) {
+			return itr->second;
+		}
+		itr = m_mismatch.find(barcode);
+		if (itr != m_mismatch.end()) {
+			return itr->second;
+		}
+		return m_undetermined;
+	}
+
+	/*
+	 * Sample names in index order, including UNDETERMINED as the last entry
+	 */
+	const vector<string> &getSampleNames() const {
+		return m_names;
+	}
+
+	unsigned getUndeterminedIndex() const {
+		return m_undetermined;
+	}
+
+	/*
+	 * Barcode is taken from the end of the comment of a read in Illumina
+	 * format, e.g. "1:N:0:ACGTACGT+GGTTAACC"
+	 */
+	static string fromComment(const string &comment) {
+		size_t pos = comment.find_last_of(':');
+		return pos == string::npos ? string() : comment.substr(pos + 1);
+	}
+
+private:
+	google::dense_hash_map<string, unsigned> m_exact;
+	google::dense_hash_map<string, unsigned> m_mismatch;
+	vector<string> m_names;
+	unsigned m_undetermined;
+
+	void addMismatches() {
+		static const char bases[] = "ACGTN";
+		for (google::dense_hash_map<string, unsigned>::const_iterator itr =
+				m_exact.begin(); itr != m_exact.end(); ++itr) {
+			string variant = itr->first;
+			for (unsigned i = 0; i < variant.size(); ++i) {
+				char orig = variant[i];
+				if (orig == '+') {
+					continue;
+				}
+				for (const char *base = bases; *base; ++base) {
+					if (*base == orig) {
+						continue;
+					}
+					variant[i] = *base;
+					if (m_exact.find(variant) == m_exact.end()) {
+						google::dense_hash_map<string, unsigned>::iterator mItr =
+								m_mismatch.find(variant);
+						if (mItr == m_mismatch.end()) {
+							m_mismatch[variant] = itr->second;
+						} else if (mItr->second != itr->second) {
+							//ambiguous between samples
+							mItr->second = m_undetermined;
+						}
+					}
+				}
+				variant[i] = orig;
+			}
+		}
+	}
+};
+
+#endif /* BARCODETABLE_HPP_ */
@@ -115,6 +115,32 @@ void printHelpDialog()
 	"  -h, --help             Display this dialog.\n"
 	"      --verbose          Display verbose output\n"
 	"  -I, --interval         Interval to report file processing status [10000000]\n"
+	"      --checkpoint=N     Save progress every N reads (or read pairs) so an\n"
+	"                         interrupted run can be continued with --resume. [0]\n"
+	"      --resume           Continue from the checkpoint saved with the same\n"
+	"                         prefix (-p), inputs and filters.\n"
+	"      --dup_cache=N      Cache results of up to N distinct read sequences so\n"
+	"                         exact duplicates are not evaluated again. Useful for\n"
+	"                         amplicon and other high duplication libraries. [0]\n"
+	"      --preserve_order   Write reads in the same order as the input, identical\n"
+	"                         for any number of threads (-t).\n"
+	"      --manifest=N       Classify every sample listed in file N, loading the\n"
+	"                         filters once. Each line is a sample name followed by\n"
+	"                         its read file (two files with -e). Outputs of each\n"
+	"                         sample use the prefix [-p]_[name].\n"
+	"      --barcodes=N       Demultiplex reads while classifying them. N is a file\n"
+	"                         of sample names and barcodes (dual indexes joined by\n"
+	"                         '+'). Outputs of each sample use the prefix\n"
+	"                         [-p]_[name]. Barcodes are read from the end of the\n"
+	"                         read comment unless --index_reads is set.\n"
+	"      --index_reads=N    Read barcodes from index read file N.\n"
+	"      --barcode_mismatches=N  Mismatches allowed in a barcode, 0 or 1. [1]\n"
+	"      --window=N         Evaluate reads longer than 2N bases in windows of N\n"
+	"                         k-mers looked up in parallel. Results are unchanged.\n"
+	"                         Useful for long reads with several threads (-t). [0]\n"
+	"      --window_tsv       Write the fraction of k-mers of each window found in\n"
+	"                         each filter to [prefix]_windows.tsv, e.g. to find\n"
+	"                         chimeric reads. Requires --window.\n"
 	"Advanced options:\n"
 	"  -r, --streak=N         The number of hits tiling in second pass needed to jump\n"
 	"                         Several tiles upon a miss. Small values decrease\n"
@@ -123,6 +149,22 @@ void printHelpDialog()
 	"                         (filters listed first have higher priority). Only taken\n"
 	"                         advantage of when k-mer sizes and number of hash\n"
 	"                         functions are the same.\n"
+	"      --adaptive_order   With -c, evaluate filters in the order that is\n"
+	"                         cheapest for the reads seen so far instead of the\n"
+	"                         listed order. A read matching several filters may\n"
+	"                         then be assigned to a lower priority one.\n"
+	"      --prescreen=N      Skip a filter for reads with fewer than N of their\n"
+	"                         sampled k-mers in its prescreen filter (made with\n"
+	"                         biobloommaker --prescreen). Faster when most reads\n"
+	"                         match nothing, but reads with few matching k-mers\n"
+	"                         may be missed. Not used with -b or -w. [0]\n"
+	"      --batch=N          Look up the k-mers of N reads per thread together,\n"
+	"                         sorted by where they fall in the filters. Faster for\n"
+	"                         filters much larger than the CPU cache when N is\n"
+	"                         large (e.g. 100000). Uses about 8(h+4) bytes per\n"
+	"                         k-mer, where h is the number of hash functions, for\n"
+	"                         at most 2^22 k-mers per thread at a time. Results\n"
+	"                         are unchanged. Implies --preserve_order. [0]\n"
 	"  -d, --stdout_filter    Outputs all matching reads to stdout for the first\n"
 	"                         filter listed by -f. Reads are outputed in fastq,\n"
 	"                         and if paired will output will be interlaced.\n"
@@ -167,6 +209,13 @@ int main(int argc, char *argv[])
 
 	double binomialScore = 100;
 
+	enum {
+		OPT_CHECKPOINT = 1, OPT_RESUME, OPT_DUP_CACHE, OPT_PRESERVE_ORDER,
+		OPT_MANIFEST, OPT_BARCODES, OPT_INDEX_READS, OPT_BARCODE_MISMATCHES,
+		OPT_WINDOW, OPT_WINDOW_TSV, OPT_ADAPTIVE_ORDER,
+		OPT_PRESCREEN, OPT_BATCH
+	};
+
 	//long form arguments
 	static struct option long_options[] = { {
 		"prefix", required_argument, NULL, 'p' }, {
@@ -196,6 +245,19 @@ int main(int argc, char *argv[])
 		"dust", no_argument, NULL, 'D' }, {
 		"T_dust", required_argument, NULL, 'T' }, {
 		"window_dust", required_argument, NULL, 'W' }, {
+		"checkpoint", required_argument, NULL, OPT_CHECKPOINT }, {
+		"resume", no_argument, NULL, OPT_RESUME }, {
+		"dup_cache", required_argument, NULL, OPT_DUP_CACHE }, {
+		"preserve_order", no_argument, NULL, OPT_PRESERVE_ORDER }, {
+		"manifest", required_argument, NULL, OPT_MANIFEST }, {
+		"barcodes", required_argument, NULL, OPT_BARCODES }, {
+		"index_reads", required_argument, NULL, OPT_INDEX_READS }, {
+		"barcode_mismatches", required_argument, NULL, OPT_BARCODE_MISMATCHES }, {
+		"window", required_argument, NULL, OPT_WINDOW }, {
+		"window_tsv", no_argument, NULL, OPT_WINDOW_TSV }, {
+		"adaptive_order", no_argument, NULL, OPT_ADAPTIVE_ORDER }, {
+		"prescreen", required_argument, NULL, OPT_PRESCREEN }, {
+		"batch", required_argument, NULL, OPT_BATCH }, {
 		NULL, 0, NULL, 0 } };
 
 	//actual checking step
@@ -334,6 +396,87 @@ int main(int argc, char *argv[])
 			convert >> opt::dustWindow;
 			break;
 		}
+		case OPT_CHECKPOINT: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::checkpoint)) {
+				cerr << "Error - Invalid parameter! checkpoint: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_RESUME: {
+			opt::resume = true;
+			break;
+		}
+		case OPT_DUP_CACHE: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::dupCacheSize)) {
+				cerr << "Error - Invalid parameter! dup_cache: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_PRESERVE_ORDER: {
+			opt::preserveOrder = true;
+			break;
+		}
+		case OPT_MANIFEST: {
+			opt::manifestFile = optarg;
+			break;
+		}
+		case OPT_BARCODES: {
+			opt::barcodeFile = optarg;
+			break;
+		}
+		case OPT_INDEX_READS: {
+			opt::indexReadFile = optarg;
+			break;
+		}
+		case OPT_BARCODE_MISMATCHES: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::barcodeMismatches)
+					|| opt::barcodeMismatches > 1) {
+				cerr << "Error - Invalid parameter! barcode_mismatches: "
+						<< optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_WINDOW: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::windowSize)) {
+				cerr << "Error - Invalid parameter! window: " << optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_WINDOW_TSV: {
+			opt::windowOutput = true;
+			break;
+		}
+		case OPT_ADAPTIVE_ORDER: {
+			opt::adaptiveOrder = true;
+			break;
+		}
+		case OPT_BATCH: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::batchSize)) {
+				cerr << "Error - Invalid parameter! batch: " << optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_PRESCREEN: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::prescreen)) {
+				cerr << "Error - Invalid parameter! prescreen: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
 		case '?': {
 			die = true;
 			break;
@@ -360,7 +503,8 @@ int main(int argc, char *argv[])
 	if (paired) {
 		if (inputFiles.size() == 1) {
 			smartPair = true;
-		} else if (inputFiles.size() != 2 && fileListFilename.empty()) {
+		} else if (inputFiles.size() != 2 && fileListFilename.empty()
+				&& opt::manifestFile.empty()) {
 			cerr << "Usage of paired end mode:\n"
 					<< "BioBloomCategorizer [OPTION]... -f \"[FILTER1]...\" [FILEPAIR1] [FILEPAIR2]\n"
 					<< "or BioBloomCategorizer [OPTION]... -f \"[FILTER1]...\" [SMARTPAIR]\n"
@@ -373,9 +517,83 @@ int main(int argc, char *argv[])
 				<< endl;
 		die = true;
 	}
+	if (opt::checkpoint || opt::resume) {
+		if (smartPair || (paired && !fileListFilename.empty())) {
+			cerr << "--checkpoint and --resume are not supported with "
+					<< "interleaved pairs or paired file lists" << endl;
+			die = true;
+		}
+		if (stdout) {
+			cerr << "--checkpoint and --resume cannot be used with -d" << endl;
+			die = true;
+		}
+	}
+
+	if (opt::batchSize > 0) {
+		if (opt::dupCacheSize > 0 || opt::prescreen > 0 || opt::windowSize > 0
+				|| opt::adaptiveOrder || !opt::manifestFile.empty()) {
+			cerr << "--batch cannot be used with --dup_cache, --prescreen, "
+					<< "--window, --adaptive_order or --manifest" << endl;
+			die = true;
+		}
+		//batches are classified by the --preserve_order code
+		opt::preserveOrder = true;
+	}
+
+	if (!opt::manifestFile.empty()) {
+		if (inputFiles.size() > 0 || !fileListFilename.empty()) {
+			cerr << "--manifest cannot be used with read files specified in "
+					<< "arguments or --file_list (-l)" << endl;
+			die = true;
+		}
+		if (stdout || opt::checkpoint || opt::resume) {
+			cerr << "--manifest cannot be used with -d, --checkpoint or --resume"
+					<< endl;
+			die = true;
+		}
+	}
+	if (!opt::barcodeFile.empty()) {
+		if (smartPair || !fileListFilename.empty()
+				|| !opt::manifestFile.empty()
+				|| inputFiles.size() != (paired ? 2 : 1)) {
+			cerr << "--barcodes needs a single read file, or a pair of files "
+					<< "with -e" << endl;
+			die = true;
+		}
+		if (stdout || opt::checkpoint || opt::resume || opt::preserveOrder) {
+			cerr << "--barcodes cannot be used with -d, --checkpoint, --resume "
+					<< "or --preserve_order" << endl;
+			die = true;
+		}
+	} else if (!opt::indexReadFile.empty()) {
+		cerr << "--index_reads requires --barcodes" << endl;
+		die = true;
+	}
+	if (opt::windowOutput) {
+		if (opt::windowSize == 0) {
+			cerr << "--window_tsv requires --window" << endl;
+			die = true;
+		}
+		if (opt::checkpoint || opt::resume) {
+			cerr << "--window_tsv cannot be used with --checkpoint or --resume"
+					<< endl;
+			die = true;
+		}
+	}
+	if (opt::adaptiveOrder && !collab) {
+		cerr << "--adaptive_order requires ordered mode (-c)" << endl;
+		die = true;
+	}
+	if (opt::preserveOrder
+			&& (smartPair || (paired && !fileListFilename.empty()))) {
+		cerr << "--preserve_order is not supported with interleaved pairs "
+				<< "or paired file lists" << endl;
+		die = true;
+	}
 
 	//Check needed options
-	if (inputFiles.size() == 0 && fileListFilename.empty()) {
+	if (inputFiles.size() == 0 && fileListFilename.empty()
+			&& opt::manifestFile.empty()) {
 		cerr << "Error: Need Input File" << endl;
 		die = true;
 	}
@@ -459,13 +677,40 @@ int main(int argc, char *argv[])
 		bbc.setStdout();
 	}
 
+	if (opt::dupCacheSize > 0) {
+		bbc.setReadCache(opt::dupCacheSize);
+	}
+
+	if (opt::prescreen > 0) {
+		bbc.setPrescreen(filterFilePaths, opt::prescreen);
+	}
+
+	if (opt::windowOutput) {
+		bbc.setWindowOutput();
+	}
+
 	if (collab) {
 		bbc.setOrderedFilter();
+		if (opt::adaptiveOrder) {
+			bbc.setAdaptiveOrder();
+		}
 	}
 
 	//filtering step
 	//create directory structure if it does not exist
-	if (paired) {
+	if (!opt::manifestFile.empty()) {
+		if (opt::inclusive) {
+			bbc.setInclusive();
+		}
+		bbc.filterManifest(loadManifest(opt::manifestFile, paired),
+				outputType);
+	} else if (!opt::barcodeFile.empty()) {
+		if (opt::inclusive) {
+			bbc.setInclusive();
+		}
+		BarcodeTable barcodes(opt::barcodeFile, opt::barcodeMismatches);
+		bbc.filterDemux(inputFiles, opt::indexReadFile, barcodes, outputType);
+	} else if (paired) {
 		if (opt::inclusive) {
 			bbc.setInclusive();
 		}
@@ -14,16 +14,24 @@
 #include "Common/Options.h"
 #include <boost/shared_ptr.hpp>
 #include <unordered_map>
+#include <limits>
+#include <cassert>
 #if _OPENMP
 # include <omp.h>
 #endif
 
+//reads per batch with --preserve_order, unless --batch is set
+static const size_t s_orderedBatchSize = 256;
+
 BioBloomClassifier::BioBloomClassifier(const vector<string> &filterFilePaths,
 		double scoreThreshold, const string &prefix,
 		const string &outputPostFix) :
 		m_scoreThreshold(scoreThreshold), m_filterNum(filterFilePaths.size()), m_prefix(
 				prefix), m_postfix(outputPostFix), m_stdout(false), m_inclusive(
-				false) {
+				false), m_readCache(NULL), m_windowOutput(NULL), m_sampled(
+				false), m_adaptiveOrder(NULL), m_evalRead(
+				SeqEval::readEvaluator<BloomFilter>(false)), m_evalScore(
+				SeqEval::scoreEvaluator(false)), m_prescreenHits(0) {
 	loadFilters(filterFilePaths);
 }
 
@@ -31,12 +39,23 @@ BioBloomClassifier::BioBloomClassifier(const vector<string> &filterFilePaths,
  * Generic filtering function (single end, no fa or fq file outputs)
  */
 void BioBloomClassifier::filter(const vector<string> &inputFiles) {
+	if (opt::preserveOrder) {
+		filterOrdered(inputFiles, "");
+		return;
+	}
 
 	//results summary object
 	ResultsManager<unsigned> resSummary(m_filterOrder, m_inclusive);
 
 	size_t totalReads = 0;
 
+	//continue from last checkpoint if requested
+	Checkpoint ckpt(m_prefix);
+	unsigned startFile = 0;
+	size_t startRead = 0;
+	loadCheckpoint(ckpt, inputFiles, resSummary, startFile, startRead,
+			totalReads);
+
 	//print out header info and initialize variables
 
 	cerr << "Filtering Start" << endl;
@@ -47,45 +66,65 @@ void BioBloomClassifier::filter(const vector<string> &inputFiles) {
 	hits.reserve(m_filterNum);
 	double score = 0;
 
-	for (vector<string>::const_iterator it = inputFiles.begin();
-			it != inputFiles.end(); ++it) {
+	for (unsigned fileIndex = startFile; fileIndex < inputFiles.size();
+			++fileIndex) {
 		gzFile fp;
-		fp = gzopen(it->c_str(), "r");
+		fp = gzopen(inputFiles[fileIndex].c_str(), "r");
 		if (fp == Z_NULL) {
-			cerr << "file " << *it << " cannot be opened" << endl;
+			cerr << "file " << inputFiles[fileIndex] << " cannot be opened"
+					<< endl;
 			exit(1);
 		}
 		kseq_t *kseq = kseq_init(fp);
+		size_t fileReads = skipReads(kseq,
+				fileIndex == startFile ? startRead : 0);
+		for (bool eof = false; !eof;) {
+			//stop at the next checkpoint so all threads are idle when it is saved
+			size_t batchEnd =
+					opt::checkpoint ?
+							fileReads + opt::checkpoint :
+							numeric_limits<size_t>::max();
 #pragma omp parallel private(rec, scores, score, hits)
-		for (int l;;) {
+			for (int l;;) {
 #pragma omp critical(kseq_read)
-			{
-				l = kseq_read(kseq);
-				if (l >= 0) {
-					rec.seq = string(kseq->seq.s, l);
-					rec.header = string(kseq->name.s, kseq->name.l);
-					rec.qual = string(kseq->qual.s, kseq->qual.l);
-					rec.comment = string(kseq->comment.s, kseq->comment.l);
-				}
-			}
-			if (l >= 0) {
-#pragma omp critical(totalReads)
 				{
-					++totalReads;
-					if (totalReads % opt::fileInterval == 0) {
-						cerr << "Currently Reading Read Number: " << totalReads
-								<< endl;
+					l = fileReads < batchEnd ? kseq_read(kseq) : -1;
+					if (l >= 0) {
+						++fileReads;
+						rec.seq = string(kseq->seq.s, l);
+						rec.header = string(kseq->name.s, kseq->name.l);
+						rec.qual = string(kseq->qual.s, kseq->qual.l);
+						rec.comment = string(kseq->comment.s,
+								kseq->comment.l);
+					} else if (fileReads < batchEnd) {
+						eof = true;
 					}
 				}
-				hits.clear();
-				score = 0;
-				scores.clear();
-				evaluateRead(rec.seq, hits, score, scores);
-				//Evaluate hit data and record for summary and print if needed
-				printSingle(rec, score, resSummary.updateSummaryData(hits));
-
-			} else
-				break;
+				if (l >= 0) {
+#pragma omp critical(totalReads)
+					{
+						++totalReads;
+						if (totalReads % opt::fileInterval == 0) {
+							cerr << "Currently Reading Read Number: "
+									<< totalReads << endl;
+						}
+					}
+					hits.clear();
+					score = 0;
+					scores.clear();
+					evaluateRead(rec.seq, hits, score, scores,
+							rec.header.c_str());
+					//Evaluate hit data and record for summary and print if needed
+					printSingle(rec, score, resSummary.updateSummaryData(hits));
+
+				} else
+					break;
+			}
+			if (opt::checkpoint) {
+				saveCheckpoint(ckpt, inputFiles, resSummary,
+						eof ? fileIndex + 1 : fileIndex, eof ? 0 : fileReads,
+						totalReads, vector<Dynamicofstream*>());
+			}
 		}
 		kseq_destroy(kseq);
 		gzclose(fp);
@@ -95,8 +134,10 @@ void BioBloomClassifier::filter(const vector<string> &inputFiles) {
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
 	summaryOutput.close();
 	cout.flush();
+	ckpt.remove();
 }
 
 /*
@@ -107,23 +148,34 @@ void BioBloomClassifier::filter(const vector<string> &inputFiles) {
  */
 void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
 		const string &outputType) {
+	if (opt::preserveOrder) {
+		filterOrdered(inputFiles, outputType);
+		return;
+	}
 
 	//results summary object
 	ResultsManager<unsigned> resSummary(m_filterOrder, m_inclusive);
 
 	size_t totalReads = 0;
 
+	//continue from last checkpoint if requested
+	Checkpoint ckpt(m_prefix);
+	unsigned startFile = 0;
+	size_t startRead = 0;
+	loadCheckpoint(ckpt, inputFiles, resSummary, startFile, startRead,
+			totalReads);
+
 	vector<Dynamicofstream*> outputFiles(m_filterOrder.size() + 2, 0);
 	//initialize variables
 	unsigned index = 0;
 	for (vector<string>::const_iterator i = m_filterOrder.begin();
 			i != m_filterOrder.end(); ++i) {
-		outputFiles[index++] = new Dynamicofstream(
+		outputFiles[index++] = openOutput(
 				m_prefix + "_" + *i + "." + outputType + m_postfix);
 	}
-	outputFiles[index++] = new Dynamicofstream(
+	outputFiles[index++] = openOutput(
 			m_prefix + "_" + NO_MATCH + "." + outputType + m_postfix);
-	outputFiles[index] = new Dynamicofstream(
+	outputFiles[index] = openOutput(
 			m_prefix + "_" + MULTI_MATCH + "." + outputType + m_postfix);
 
 	//print out header info and initialize variables
@@ -135,49 +187,70 @@ void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
 	vector<unsigned> hits;
 	hits.reserve(m_filterNum);
 	double score = 0;
-	for (vector<string>::const_iterator it = inputFiles.begin();
-			it != inputFiles.end(); ++it) {
+	for (unsigned fileIndex = startFile; fileIndex < inputFiles.size();
+			++fileIndex) {
 		gzFile fp;
-		fp = gzopen(it->c_str(), "r");
+		fp = gzopen(inputFiles[fileIndex].c_str(), "r");
 		if (fp == Z_NULL) {
-			cerr << "file " << *it << " cannot be opened" << endl;
+			cerr << "file " << inputFiles[fileIndex] << " cannot be opened"
+					<< endl;
 			exit(1);
 		}
 
 		kseq_t *kseq = kseq_init(fp);
+		size_t fileReads = skipReads(kseq,
+				fileIndex == startFile ? startRead : 0);
+		for (bool eof = false; !eof;) {
+			//stop at the next checkpoint so all threads are idle when it is saved
+			size_t batchEnd =
+					opt::checkpoint ?
+							fileReads + opt::checkpoint :
+							numeric_limits<size_t>::max();
 #pragma omp parallel private(rec, scores, score, hits)
-		for (int l;;) {
+			for (int l;;) {
 #pragma omp critical(kseq_read)
-			{
-				l = kseq_read(kseq);
-				if (l >= 0) {
-					rec.seq = string(kseq->seq.s, l);
-					rec.header = string(kseq->name.s, kseq->name.l);
-					rec.qual = string(kseq->qual.s, kseq->qual.l);
-					rec.comment = string(kseq->comment.s, kseq->comment.l);
-				}
-			}
-			if (l >= 0) {
-#pragma omp critical(totalReads)
 				{
-					++totalReads;
-					if (totalReads % opt::fileInterval == 0) {
-						cerr << "Currently Reading Read Number: " << totalReads
-								<< endl;
+					l = fileReads < batchEnd ? kseq_read(kseq) : -1;
+					if (l >= 0) {
+						++fileReads;
+						rec.seq = string(kseq->seq.s, l);
+						rec.header = string(kseq->name.s, kseq->name.l);
+						rec.qual = string(kseq->qual.s, kseq->qual.l);
+						rec.comment = string(kseq->comment.s,
+								kseq->comment.l);
+					} else if (fileReads < batchEnd) {
+						eof = true;
 					}
 				}
-				hits.clear();
-				score = 0;
-				scores.clear();
-				evaluateRead(rec.seq, hits, score, scores);
-				//Evaluate hit data and record for summary
-				unsigned outputFileName = resSummary.updateSummaryData(hits);
-				printSingle(rec, score, outputFileName);
-				printSingleToFile(outputFileName, rec, outputFiles, outputType,
-						score, scores, resSummary);
-
-			} else
-				break;
+				if (l >= 0) {
+#pragma omp critical(totalReads)
+					{
+						++totalReads;
+						if (totalReads % opt::fileInterval == 0) {
+							cerr << "Currently Reading Read Number: "
+									<< totalReads << endl;
+						}
+					}
+					hits.clear();
+					score = 0;
+					scores.clear();
+					evaluateRead(rec.seq, hits, score, scores,
+							rec.header.c_str());
+					//Evaluate hit data and record for summary
+					unsigned outputFileName = resSummary.updateSummaryData(
+							hits);
+					printSingle(rec, score, outputFileName);
+					printSingleToFile(outputFileName, rec, outputFiles,
+							outputType, score, scores, resSummary);
+
+				} else
+					break;
+			}
+			if (opt::checkpoint) {
+				saveCheckpoint(ckpt, inputFiles, resSummary,
+						eof ? fileIndex + 1 : fileIndex, eof ? 0 : fileReads,
+						totalReads, outputFiles);
+			}
 		}
 		kseq_destroy(kseq);
 		gzclose(fp);
@@ -205,8 +278,10 @@ void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
 	summaryOutput.close();
 	cout.flush();
+	ckpt.remove();
 }
 
 /*
@@ -215,12 +290,26 @@ void BioBloomClassifier::filterPrint(const vector<string> &inputFiles,
  * hash functions)
  */
 void BioBloomClassifier::filterPair(const string &file1, const string &file2) {
+	if (opt::preserveOrder) {
+		filterPairOrdered(file1, file2, "");
+		return;
+	}
 
 	//results summary object
 	ResultsManager<unsigned> resSummary(m_filterOrder, m_inclusive);
 
 	size_t totalReads = 0;
 
+	//continue from last checkpoint if requested
+	vector<string> inputFiles;
+	inputFiles.push_back(file1);
+	inputFiles.push_back(file2);
+	Checkpoint ckpt(m_prefix);
+	unsigned startFile = 0;
+	size_t startRead = 0;
+	loadCheckpoint(ckpt, inputFiles, resSummary, startFile, startRead,
+			totalReads);
+
 	cerr << "Filtering Start" << "\n";
 
 	gzFile fp1, fp2;
@@ -247,49 +336,73 @@ void BioBloomClassifier::filterPair(const string &file1, const string &file2) {
 	double score1 = 0;
 	double score2 = 0;
 
+	size_t pairReads = skipReads(kseq1, startRead);
+	skipReads(kseq2, startRead);
+	for (bool eof = false; !eof;) {
+		//stop at the next checkpoint so all threads are idle when it is saved
+		size_t batchEnd =
+				opt::checkpoint ?
+						pairReads + opt::checkpoint :
+						numeric_limits<size_t>::max();
 #pragma omp parallel private(rec1, rec2, scores1, score1, hits1, scores2, score2, hits2)
-	for (int l1, l2;;) {
+		for (int l1, l2;;) {
 #pragma omp critical(kseq)
-		{
-			l1 = kseq_read(kseq1);
-			if (l1 >= 0) {
-				rec1.seq = string(kseq1->seq.s, l1);
-				rec1.header = string(kseq1->name.s, kseq1->name.l);
-				rec1.qual = string(kseq1->qual.s, kseq1->qual.l);
-				rec1.comment = string(kseq1->comment.s, kseq1->comment.l);
-			}
-			l2 = kseq_read(kseq2);
-			if (l2 >= 0) {
-				rec2.seq = string(kseq2->seq.s, l2);
-				rec2.header = string(kseq2->name.s, kseq2->name.l);
-				rec2.qual = string(kseq2->qual.s, kseq2->qual.l);
-				rec2.comment = string(kseq2->comment.s, kseq2->comment.l);
-			}
-		}
-		if (l1 >= 0 && l2 >= 0) {
-#pragma omp critical(totalReads)
 			{
-				++totalReads;
-				if (totalReads % opt::fileInterval == 0) {
-					cerr << "Currently Reading Read Number: " << totalReads
-							<< endl;
+				l1 = l2 = -1;
+				if (pairReads < batchEnd) {
+					l1 = kseq_read(kseq1);
+					if (l1 >= 0) {
+						rec1.seq = string(kseq1->seq.s, l1);
+						rec1.header = string(kseq1->name.s, kseq1->name.l);
+						rec1.qual = string(kseq1->qual.s, kseq1->qual.l);
+						rec1.comment = string(kseq1->comment.s,
+								kseq1->comment.l);
+					}
+					l2 = kseq_read(kseq2);
+					if (l2 >= 0) {
+						rec2.seq = string(kseq2->seq.s, l2);
+						rec2.header = string(kseq2->name.s, kseq2->name.l);
+						rec2.qual = string(kseq2->qual.s, kseq2->qual.l);
+						rec2.comment = string(kseq2->comment.s,
+								kseq2->comment.l);
+					}
+					if (l1 >= 0 && l2 >= 0) {
+						++pairReads;
+					} else {
+						eof = true;
+					}
 				}
 			}
-			hits1.clear();
-			hits2.clear();
-			score1 = 0;
-			score2 = 0;
-			scores1.clear();
-			scores2.clear();
+			if (l1 >= 0 && l2 >= 0) {
+#pragma omp critical(totalReads)
+				{
+					++totalReads;
+					if (totalReads % opt::fileInterval == 0) {
+						cerr << "Currently Reading Read Number: " << totalReads
+								<< endl;
+					}
+				}
+				hits1.clear();
+				hits2.clear();
+				score1 = 0;
+				score2 = 0;
+				scores1.clear();
+				scores2.clear();
 
-			evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1, score2,
-					scores1, scores2);
+				evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1,
+						score2, scores1, scores2, rec1.header.c_str(),
+						rec2.header.c_str());
 
-			//Evaluate hit data and record for summary
-			printPair(rec1, rec2, score1, score2,
-					resSummary.updateSummaryData(hits1, hits2));
-		} else
-			break;
+				//Evaluate hit data and record for summary
+				printPair(rec1, rec2, score1, score2,
+						resSummary.updateSummaryData(hits1, hits2));
+			} else
+				break;
+		}
+		if (opt::checkpoint && !eof) {
+			saveCheckpoint(ckpt, inputFiles, resSummary, 0, pairReads,
+					totalReads, vector<Dynamicofstream*>());
+		}
 	}
 	kseq_destroy(kseq1);
 	kseq_destroy(kseq2);
@@ -298,8 +411,10 @@ void BioBloomClassifier::filterPair(const string &file1, const string &file2) {
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
 	summaryOutput.close();
 	cout.flush();
+	ckpt.remove();
 }
 
 /*
@@ -310,30 +425,44 @@ void BioBloomClassifier::filterPair(const string &file1, const string &file2) {
  */
 void BioBloomClassifier::filterPairPrint(const string &file1,
 		const string &file2, const string &outputType) {
+	if (opt::preserveOrder) {
+		filterPairOrdered(file1, file2, outputType);
+		return;
+	}
 
 	//results summary object
 	ResultsManager<unsigned> resSummary(m_filterOrder, m_inclusive);
 
 	size_t totalReads = 0;
 
+	//continue from last checkpoint if requested
+	vector<string> inputFiles;
+	inputFiles.push_back(file1);
+	inputFiles.push_back(file2);
+	Checkpoint ckpt(m_prefix);
+	unsigned startFile = 0;
+	size_t startRead = 0;
+	loadCheckpoint(ckpt, inputFiles, resSummary, startFile, startRead,
+			totalReads);
+
 	vector<Dynamicofstream*> outputFiles1(m_filterOrder.size() + 2, 0);
 	vector<Dynamicofstream*> outputFiles2(m_filterOrder.size() + 2, 0);
 	//initialize variables
 	unsigned index = 0;
 	for (vector<string>::const_iterator i = m_filterOrder.begin();
 			i != m_filterOrder.end(); ++i) {
-		outputFiles1[index] = new Dynamicofstream(
+		outputFiles1[index] = openOutput(
 				m_prefix + "_" + *i + "_1." + outputType + m_postfix);
-		outputFiles2[index++] = new Dynamicofstream(
+		outputFiles2[index++] = openOutput(
 				m_prefix + "_" + *i + "_2." + outputType + m_postfix);
 	}
-	outputFiles1[index] = new Dynamicofstream(
+	outputFiles1[index] = openOutput(
 			m_prefix + "_" + NO_MATCH + "_1." + outputType + m_postfix);
-	outputFiles2[index++] = new Dynamicofstream(
+	outputFiles2[index++] = openOutput(
 			m_prefix + "_" + NO_MATCH + "_2." + outputType + m_postfix);
-	outputFiles1[index] = new Dynamicofstream(
+	outputFiles1[index] = openOutput(
 			m_prefix + "_" + MULTI_MATCH + "_1." + outputType + m_postfix);
-	outputFiles2[index] = new Dynamicofstream(
+	outputFiles2[index] = openOutput(
 			m_prefix + "_" + MULTI_MATCH + "_2." + outputType + m_postfix);
 
 	cerr << "Filtering Start" << "\n";
@@ -349,39 +478,677 @@ void BioBloomClassifier::filterPairPrint(const string &file1,
 		cerr << "file " << file2.c_str() << " cannot be opened" << endl;
 		exit(1);
 	}
-	kseq_t *kseq1 = kseq_init(fp1);
-	kseq_t *kseq2 = kseq_init(fp2);
+	kseq_t *kseq1 = kseq_init(fp1);
+	kseq_t *kseq2 = kseq_init(fp2);
+	FaRec rec1;
+	FaRec rec2;
+	vector<double> scores1(m_filterNum, 0.0);
+	vector<double> scores2(m_filterNum, 0.0);
+	vector<unsigned> hits1;
+	hits1.reserve(m_filterNum);
+	vector<unsigned> hits2;
+	hits1.reserve(m_filterNum);
+	double score1 = 0;
+	double score2 = 0;
+
+	vector<Dynamicofstream*> outputFiles(outputFiles1);
+	outputFiles.insert(outputFiles.end(), outputFiles2.begin(),
+			outputFiles2.end());
+	size_t pairReads = skipReads(kseq1, startRead);
+	skipReads(kseq2, startRead);
+	for (bool eof = false; !eof;) {
+		//stop at the next checkpoint so all threads are idle when it is saved
+		size_t batchEnd =
+				opt::checkpoint ?
+						pairReads + opt::checkpoint :
+						numeric_limits<size_t>::max();
+#pragma omp parallel private(rec1, rec2, scores1, score1, hits1, scores2, score2, hits2)
+		for (int l1, l2;;) {
+#pragma omp critical(kseq)
+			{
+				l1 = l2 = -1;
+				if (pairReads < batchEnd) {
+					l1 = kseq_read(kseq1);
+					if (l1 >= 0) {
+						rec1.seq = string(kseq1->seq.s, l1);
+						rec1.header = string(kseq1->name.s, kseq1->name.l);
+						rec1.qual = string(kseq1->qual.s, kseq1->qual.l);
+						rec1.comment = string(kseq1->comment.s,
+								kseq1->comment.l);
+					}
+					l2 = kseq_read(kseq2);
+					if (l2 >= 0) {
+						rec2.seq = string(kseq2->seq.s, l2);
+						rec2.header = string(kseq2->name.s, kseq2->name.l);
+						rec2.qual = string(kseq2->qual.s, kseq2->qual.l);
+						rec2.comment = string(kseq2->comment.s,
+								kseq2->comment.l);
+					}
+					if (l1 >= 0 && l2 >= 0) {
+						++pairReads;
+					} else {
+						eof = true;
+					}
+				}
+			}
+			if (l1 >= 0 && l2 >= 0) {
+#pragma omp critical(totalReads)
+				{
+					++totalReads;
+					if (totalReads % opt::fileInterval == 0) {
+						cerr << "Currently Reading Read Number: " << totalReads
+								<< endl;
+					}
+				}
+				hits1.clear();
+				hits2.clear();
+				score1 = 0;
+				score2 = 0;
+				scores1.clear();
+				scores2.clear();
+
+				evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1,
+						score2, scores1, scores2, rec1.header.c_str(),
+						rec2.header.c_str());
+
+				unsigned outputFileIndex = resSummary.updateSummaryData(hits1,
+						hits2);
+
+				//Evaluate hit data and record for summary
+				printPair(rec1, rec2, score1, score2, outputFileIndex);
+				printPairToFile(outputFileIndex, rec1, rec2, outputFiles1,
+						outputFiles2, outputType, score1, score2, scores1,
+						scores2, resSummary);
+			} else
+				break;
+		}
+		if (opt::checkpoint && !eof) {
+			saveCheckpoint(ckpt, inputFiles, resSummary, 0, pairReads,
+					totalReads, outputFiles);
+		}
+	}
+	kseq_destroy(kseq1);
+	kseq_destroy(kseq2);
+
+	//close sorting files
+	for (unsigned i = 0; i < m_filterOrder.size(); ++i) {
+		outputFiles1[i]->close();
+		delete (outputFiles1[i]);
+		cerr << "File written to: "
+				<< m_prefix + "_" + m_filterOrder[i] + "_1." + outputType
+						+ m_postfix << endl;
+		outputFiles2[i]->close();
+		delete (outputFiles2[i]);
+		cerr << "File written to: "
+				<< m_prefix + "_" + m_filterOrder[i] + "_2." + outputType
+						+ m_postfix << endl;
+	}
+	outputFiles1[m_filterOrder.size()]->close();
+	delete (outputFiles1[m_filterOrder.size()]);
+	cerr << "File written to: "
+			<< m_prefix + "_" + NO_MATCH + "_1." + outputType + m_postfix
+			<< endl;
+	outputFiles2[m_filterOrder.size()]->close();
+	delete (outputFiles2[m_filterOrder.size()]);
+	cerr << "File written to: "
+			<< m_prefix + "_" + NO_MATCH + "_2." + outputType + m_postfix
+			<< endl;
+	outputFiles1[m_filterOrder.size() + 1]->close();
+	delete (outputFiles1[m_filterOrder.size() + 1]);
+	cerr << "File written to: "
+			<< m_prefix + "_" + MULTI_MATCH + "_1." + outputType + m_postfix
+			<< endl;
+	outputFiles2[m_filterOrder.size() + 1]->close();
+	delete (outputFiles2[m_filterOrder.size() + 1]);
+	cerr << "File written to: "
+			<< m_prefix + "_" + MULTI_MATCH + "_2." + outputType + m_postfix
+			<< endl;
+	cerr << "Total Reads:" << totalReads << endl;
+	cerr << "Writing file: " << m_prefix + "_summary.tsv" << endl;
+
+	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
+	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
+	summaryOutput.close();
+	cout.flush();
+	ckpt.remove();
+}
+
+/*
+ * Single end filtering for --preserve_order. Reads are classified in parallel
+ * in batches and written out through a reorder buffer so output is in input
+ * order regardless of the number of threads.
+ * No fa or fq files are written if outputType is empty.
+ */
+void BioBloomClassifier::filterOrdered(const vector<string> &inputFiles,
+		const string &outputType) {
+
+	//results summary object
+	ResultsManager<unsigned> resSummary(m_filterOrder, m_inclusive);
+
+	size_t totalReads = 0;
+
+	//continue from last checkpoint if requested
+	Checkpoint ckpt(m_prefix);
+	unsigned startFile = 0;
+	size_t startRead = 0;
+	loadCheckpoint(ckpt, inputFiles, resSummary, startFile, startRead,
+			totalReads);
+
+	vector<Dynamicofstream*> outputFiles;
+	if (!outputType.empty()) {
+		for (vector<string>::const_iterator i = m_filterOrder.begin();
+				i != m_filterOrder.end(); ++i) {
+			outputFiles.push_back(
+					openOutput(
+							m_prefix + "_" + *i + "." + outputType
+									+ m_postfix));
+		}
+		outputFiles.push_back(
+				openOutput(
+						m_prefix + "_" + NO_MATCH + "." + outputType
+								+ m_postfix));
+		outputFiles.push_back(
+				openOutput(
+						m_prefix + "_" + MULTI_MATCH + "." + outputType
+								+ m_postfix));
+	}
+
+	cerr << "Filtering Start" << endl;
+
+	OrderedBuffer<ReadBatch> buffer(
+			s_orderedBatchesPerThread * max(opt::threads, 1u));
+	ReadBatch batch;
+	const size_t batchSize =
+			opt::batchSize > 0 ? opt::batchSize : s_orderedBatchSize;
+	for (unsigned fileIndex = startFile; fileIndex < inputFiles.size();
+			++fileIndex) {
+		gzFile fp;
+		fp = gzopen(inputFiles[fileIndex].c_str(), "r");
+		if (fp == Z_NULL) {
+			cerr << "file " << inputFiles[fileIndex] << " cannot be opened"
+					<< endl;
+			exit(1);
+		}
+		kseq_t *kseq = kseq_init(fp);
+		size_t fileReads = skipReads(kseq,
+				fileIndex == startFile ? startRead : 0);
+		for (bool eof = false; !eof;) {
+			//stop at the next checkpoint so all threads are idle when it is saved
+			size_t batchEnd =
+					opt::checkpoint ?
+							fileReads + opt::checkpoint :
+							numeric_limits<size_t>::max();
+#pragma omp parallel private(batch)
+			for (;;) {
+				size_t batchNum;
+#pragma omp critical(kseq_read)
+				{
+					batchNum = buffer.nextBatch();
+					batch.resize(batchSize);
+					size_t count = 0;
+					while (count < batchSize && fileReads < batchEnd) {
+						int l = kseq_read(kseq);
+						if (l < 0) {
+							eof = true;
+							break;
+						}
+						FaRec &rec = batch[count++].rec;
+						rec.seq = string(kseq->seq.s, l);
+						rec.header = string(kseq->name.s, kseq->name.l);
+						rec.qual = string(kseq->qual.s, kseq->qual.l);
+						rec.comment = string(kseq->comment.s, kseq->comment.l);
+						++fileReads;
+					}
+					batch.resize(count);
+				}
+				bool done = batch.empty();
+				if (!done) {
+					updateReadCount(totalReads, batch.size());
+					evaluateBatch(batch, resSummary);
+				}
+				buffer.commit(batchNum, batch, [&](ReadBatch &out) {
+					for (ReadBatch::iterator r = out.begin(); r != out.end();
+							++r) {
+						printSingle(r->rec, r->score, r->filterID);
+						if (!outputFiles.empty()) {
+							printSingleToFile(r->filterID, r->rec, outputFiles,
+									outputType, r->score, r->scores,
+									resSummary);
+						}
+					}
+				});
+				if (done) {
+					break;
+				}
+			}
+			if (opt::checkpoint) {
+				saveCheckpoint(ckpt, inputFiles, resSummary,
+						eof ? fileIndex + 1 : fileIndex, eof ? 0 : fileReads,
+						totalReads, outputFiles);
+			}
+		}
+		kseq_destroy(kseq);
+		gzclose(fp);
+	}
+
+	//close sorting files
+	for (unsigned i = 0; i < outputFiles.size(); ++i) {
+		outputFiles[i]->close();
+		cerr << "File written to: " << outputFiles[i]->getFileName() << endl;
+		delete (outputFiles[i]);
+	}
+	cerr << "Total Reads:" << totalReads << endl;
+	cerr << "Writing file: " << m_prefix + "_summary.tsv" << endl;
+
+	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
+	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
+	summaryOutput.close();
+	cout.flush();
+	ckpt.remove();
+}
+
+/*
+ * Paired end counterpart of filterOrdered
+ */
+void BioBloomClassifier::filterPairOrdered(const string &file1,
+		const string &file2, const string &outputType) {
+
+	//results summary object
+	ResultsManager<unsigned> resSummary(m_filterOrder, m_inclusive);
+
+	size_t totalReads = 0;
+
+	//continue from last checkpoint if requested
+	vector<string> inputFiles;
+	inputFiles.push_back(file1);
+	inputFiles.push_back(file2);
+	Checkpoint ckpt(m_prefix);
+	unsigned startFile = 0;
+	size_t startRead = 0;
+	loadCheckpoint(ckpt, inputFiles, resSummary, startFile, startRead,
+			totalReads);
+
+	vector<Dynamicofstream*> outputFiles1;
+	vector<Dynamicofstream*> outputFiles2;
+	if (!outputType.empty()) {
+		vector<string> names(m_filterOrder);
+		names.push_back(NO_MATCH);
+		names.push_back(MULTI_MATCH);
+		for (vector<string>::const_iterator i = names.begin();
+				i != names.end(); ++i) {
+			outputFiles1.push_back(
+					openOutput(
+							m_prefix + "_" + *i + "_1." + outputType
+									+ m_postfix));
+			outputFiles2.push_back(
+					openOutput(
+							m_prefix + "_" + *i + "_2." + outputType
+									+ m_postfix));
+		}
+	}
+
+	cerr << "Filtering Start" << "\n";
+
+	gzFile fp1, fp2;
+	fp1 = gzopen(file1.c_str(), "r");
+	if (fp1 == Z_NULL) {
+		cerr << "file " << file1.c_str() << " cannot be opened" << endl;
+		exit(1);
+	}
+	fp2 = gzopen(file2.c_str(), "r");
+	if (fp2 == Z_NULL) {
+		cerr << "file " << file2.c_str() << " cannot be opened" << endl;
+		exit(1);
+	}
+	kseq_t *kseq1 = kseq_init(fp1);
+	kseq_t *kseq2 = kseq_init(fp2);
+
+	vector<Dynamicofstream*> outputFiles(outputFiles1);
+	outputFiles.insert(outputFiles.end(), outputFiles2.begin(),
+			outputFiles2.end());
+	OrderedBuffer<pair<ReadBatch, ReadBatch> > buffer(
+			s_orderedBatchesPerThread * max(opt::threads, 1u));
+	pair<ReadBatch, ReadBatch> batch;
+	const size_t batchSize =
+			opt::batchSize > 0 ? opt::batchSize : s_orderedBatchSize;
+	size_t pairReads = skipReads(kseq1, startRead);
+	skipReads(kseq2, startRead);
+	for (bool eof = false; !eof;) {
+		//stop at the next checkpoint so all threads are idle when it is saved
+		size_t batchEnd =
+				opt::checkpoint ?
+						pairReads + opt::checkpoint :
+						numeric_limits<size_t>::max();
+#pragma omp parallel private(batch)
+		for (;;) {
+			size_t batchNum;
+#pragma omp critical(kseq)
+			{
+				batchNum = buffer.nextBatch();
+				batch.first.resize(batchSize);
+				batch.second.resize(batchSize);
+				size_t count = 0;
+				while (count < batchSize && pairReads < batchEnd) {
+					int l1 = kseq_read(kseq1);
+					int l2 = kseq_read(kseq2);
+					if (l1 < 0 || l2 < 0) {
+						eof = true;
+						break;
+					}
+					FaRec &rec1 = batch.first[count].rec;
+					rec1.seq = string(kseq1->seq.s, l1);
+					rec1.header = string(kseq1->name.s, kseq1->name.l);
+					rec1.qual = string(kseq1->qual.s, kseq1->qual.l);
+					rec1.comment = string(kseq1->comment.s, kseq1->comment.l);
+					FaRec &rec2 = batch.second[count++].rec;
+					rec2.seq = string(kseq2->seq.s, l2);
+					rec2.header = string(kseq2->name.s, kseq2->name.l);
+					rec2.qual = string(kseq2->qual.s, kseq2->qual.l);
+					rec2.comment = string(kseq2->comment.s, kseq2->comment.l);
+					++pairReads;
+				}
+				batch.first.resize(count);
+				batch.second.resize(count);
+			}
+			bool done = batch.first.empty();
+			if (!done) {
+				updateReadCount(totalReads, batch.first.size());
+				evaluateBatch(batch.first, batch.second, resSummary);
+			}
+			buffer.commit(batchNum, batch,
+					[&](pair<ReadBatch, ReadBatch> &out) {
+						for (unsigned i = 0; i < out.first.size(); ++i) {
+							ClassifiedRead &r1 = out.first[i];
+							ClassifiedRead &r2 = out.second[i];
+							printPair(r1.rec, r2.rec, r1.score, r2.score,
+									r1.filterID);
+							if (!outputFiles.empty()) {
+								printPairToFile(r1.filterID, r1.rec, r2.rec,
+										outputFiles1, outputFiles2, outputType,
+										r1.score, r2.score, r1.scores,
+										r2.scores, resSummary);
+							}
+						}
+					});
+			if (done) {
+				break;
+			}
+		}
+		if (opt::checkpoint && !eof) {
+			saveCheckpoint(ckpt, inputFiles, resSummary, 0, pairReads,
+					totalReads, outputFiles);
+		}
+	}
+	kseq_destroy(kseq1);
+	kseq_destroy(kseq2);
+
+	//close sorting files
+	for (unsigned i = 0; i < outputFiles.size(); ++i) {
+		outputFiles[i]->close();
+		cerr << "File written to: " << outputFiles[i]->getFileName() << endl;
+		delete (outputFiles[i]);
+	}
+	cerr << "Total Reads:" << totalReads << endl;
+	cerr << "Writing file: " << m_prefix + "_summary.tsv" << endl;
+
+	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
+	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
+	summaryOutput.close();
+	cout.flush();
+	ckpt.remove();
+}
+
+/*
+ * Classifies every sample in a manifest (--manifest) with the filters loaded
+ * once. Threads take whole samples from a shared list so many small samples
+ * keep all cores busy. Each sample gets its own summary and output files.
+ */
+void BioBloomClassifier::filterManifest(const vector<SampleInfo> &samples,
+		const string &outputType) {
+	cerr << "Filtering Start" << endl;
+	size_t totalReads = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:totalReads)
+	for (size_t i = 0; i < samples.size(); ++i) {
+		totalReads += filterSample(samples[i], outputType);
+	}
+	cerr << "Samples: " << samples.size() << endl;
+	cerr << "Total Reads:" << totalReads << endl;
+}
+
+/*
+ * Classifies a single sample of a manifest on the calling thread.
+ * Returns the number of reads (or pairs) classified.
+ */
+size_t BioBloomClassifier::filterSample(const SampleInfo &sample,
+		const string &outputType) {
+	ResultsManager<unsigned> resSummary(m_filterOrder, m_inclusive);
+	bool paired = !sample.file2.empty();
+
+	vector<Dynamicofstream*> outputFiles1;
+	vector<Dynamicofstream*> outputFiles2;
+	if (!outputType.empty()) {
+		vector<string> names(m_filterOrder);
+		names.push_back(NO_MATCH);
+		names.push_back(MULTI_MATCH);
+		for (vector<string>::const_iterator i = names.begin();
+				i != names.end(); ++i) {
+			if (paired) {
+				outputFiles1.push_back(
+						new Dynamicofstream(
+								sample.prefix + "_" + *i + "_1." + outputType
+										+ m_postfix));
+				outputFiles2.push_back(
+						new Dynamicofstream(
+								sample.prefix + "_" + *i + "_2." + outputType
+										+ m_postfix));
+			} else {
+				outputFiles1.push_back(
+						new Dynamicofstream(
+								sample.prefix + "_" + *i + "." + outputType
+										+ m_postfix));
+			}
+		}
+	}
+
+	gzFile fp1 = gzopen(sample.file1.c_str(), "r");
+	if (fp1 == Z_NULL) {
+		cerr << "file " << sample.file1 << " cannot be opened" << endl;
+		exit(1);
+	}
+	gzFile fp2 = Z_NULL;
+	if (paired) {
+		fp2 = gzopen(sample.file2.c_str(), "r");
+		if (fp2 == Z_NULL) {
+			cerr << "file " << sample.file2 << " cannot be opened" << endl;
+			exit(1);
+		}
+	}
+	kseq_t *kseq1 = kseq_init(fp1);
+	kseq_t *kseq2 = paired ? kseq_init(fp2) : NULL;
+
+	FaRec rec1;
+	FaRec rec2;
+	vector<double> scores1;
+	vector<double> scores2;
+	vector<unsigned> hits1;
+	vector<unsigned> hits2;
+	hits1.reserve(m_filterNum);
+	hits2.reserve(m_filterNum);
+	size_t reads = 0;
+	for (int l1, l2 = 0; (l1 = kseq_read(kseq1)) >= 0
+			&& (!paired || (l2 = kseq_read(kseq2)) >= 0);) {
+		++reads;
+		rec1.seq = string(kseq1->seq.s, l1);
+		rec1.header = string(kseq1->name.s, kseq1->name.l);
+		rec1.qual = string(kseq1->qual.s, kseq1->qual.l);
+		rec1.comment = string(kseq1->comment.s, kseq1->comment.l);
+		hits1.clear();
+		scores1.clear();
+		double score1 = 0;
+		if (paired) {
+			rec2.seq = string(kseq2->seq.s, l2);
+			rec2.header = string(kseq2->name.s, kseq2->name.l);
+			rec2.qual = string(kseq2->qual.s, kseq2->qual.l);
+			rec2.comment = string(kseq2->comment.s, kseq2->comment.l);
+			hits2.clear();
+			scores2.clear();
+			double score2 = 0;
+			evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1, score2,
+					scores1, scores2, rec1.header.c_str(), rec2.header.c_str());
+			unsigned outputFileIndex = resSummary.updateSummaryData(hits1,
+					hits2);
+			if (!outputFiles1.empty()) {
+				printPairToFile(outputFileIndex, rec1, rec2, outputFiles1,
+						outputFiles2, outputType, score1, score2, scores1,
+						scores2, resSummary);
+			}
+		} else {
+			evaluateRead(rec1.seq, hits1, score1, scores1,
+					rec1.header.c_str());
+			unsigned outputFileIndex = resSummary.updateSummaryData(hits1);
+			if (!outputFiles1.empty()) {
+				printSingleToFile(outputFileIndex, rec1, outputFiles1,
+						outputType, score1, scores1, resSummary);
+			}
+		}
+	}
+	kseq_destroy(kseq1);
+	gzclose(fp1);
+	if (paired) {
+		kseq_destroy(kseq2);
+		gzclose(fp2);
+	}
+
+	for (unsigned i = 0; i < outputFiles1.size(); ++i) {
+		outputFiles1[i]->close();
+		delete (outputFiles1[i]);
+	}
+	for (unsigned i = 0; i < outputFiles2.size(); ++i) {
+		outputFiles2[i]->close();
+		delete (outputFiles2[i]);
+	}
+
+	Dynamicofstream summaryOutput(sample.prefix + "_summary.tsv");
+	summaryOutput << resSummary.getResultsSummary(reads);
+	summaryOutput.close();
+#pragma omp critical(cerr)
+	cerr << "Sample " << sample.name << ": " << reads << " reads, summary "
+			<< "written to " << sample.prefix + "_summary.tsv" << endl;
+	return reads;
+}
+
+/*
+ * Demultiplexes and classifies reads in a single pass (--barcodes). Each read
+ * is assigned to a sample by its barcode, taken from indexFile if given or
+ * from the read comment otherwise. Reads are written to per-sample, per-filter
+ * files and each sample gets its own summary file.
+ * inputFiles holds one file, or two files of mates in paired end mode.
+ */
+void BioBloomClassifier::filterDemux(const vector<string> &inputFiles,
+		const string &indexFile, const BarcodeTable &barcodes,
+		const string &outputType) {
+	const vector<string> &sampleNames = barcodes.getSampleNames();
+	bool paired = inputFiles.size() == 2;
+
+	//results summary objects, one per sample
+	vector<ResultsManager<unsigned>*> resSummaries;
+	vector<size_t> sampleReads(sampleNames.size(), 0);
+	vector<string> samplePrefixes;
+	for (vector<string>::const_iterator i = sampleNames.begin();
+			i != sampleNames.end(); ++i) {
+		resSummaries.push_back(
+				new ResultsManager<unsigned>(m_filterOrder, m_inclusive));
+		samplePrefixes.push_back(m_prefix.empty() ? *i : m_prefix + "_" + *i);
+	}
+
+	vector<vector<Dynamicofstream*> > outputFiles1(sampleNames.size());
+	vector<vector<Dynamicofstream*> > outputFiles2(sampleNames.size());
+	if (!outputType.empty()) {
+		vector<string> names(m_filterOrder);
+		names.push_back(NO_MATCH);
+		names.push_back(MULTI_MATCH);
+		for (unsigned s = 0; s < sampleNames.size(); ++s) {
+			for (vector<string>::const_iterator i = names.begin();
+					i != names.end(); ++i) {
+				if (paired) {
+					outputFiles1[s].push_back(
+							new Dynamicofstream(
+									samplePrefixes[s] + "_" + *i + "_1."
+											+ outputType + m_postfix));
+					outputFiles2[s].push_back(
+							new Dynamicofstream(
+									samplePrefixes[s] + "_" + *i + "_2."
+											+ outputType + m_postfix));
+				} else {
+					outputFiles1[s].push_back(
+							new Dynamicofstream(
+									samplePrefixes[s] + "_" + *i + "."
+											+ outputType + m_postfix));
+				}
+			}
+		}
+	}
+
+	cerr << "Filtering Start" << endl;
+
+	vector<kseq_t*> kseqs;
+	vector<gzFile> fps;
+	vector<string> files(inputFiles);
+	if (!indexFile.empty()) {
+		files.push_back(indexFile);
+	}
+	for (vector<string>::const_iterator i = files.begin(); i != files.end();
+			++i) {
+		gzFile fp = gzopen(i->c_str(), "r");
+		if (fp == Z_NULL) {
+			cerr << "file " << *i << " cannot be opened" << endl;
+			exit(1);
+		}
+		fps.push_back(fp);
+		kseqs.push_back(kseq_init(fp));
+	}
+	kseq_t *kseq1 = kseqs[0];
+	kseq_t *kseq2 = paired ? kseqs[1] : NULL;
+	kseq_t *kseqIndex = indexFile.empty() ? NULL : kseqs.back();
+
+	size_t totalReads = 0;
 	FaRec rec1;
 	FaRec rec2;
-	vector<double> scores1(m_filterNum, 0.0);
-	vector<double> scores2(m_filterNum, 0.0);
+	string barcode;
+	vector<double> scores1;
+	vector<double> scores2;
 	vector<unsigned> hits1;
-	hits1.reserve(m_filterNum);
 	vector<unsigned> hits2;
-	hits1.reserve(m_filterNum);
 	double score1 = 0;
 	double score2 = 0;
-
-#pragma omp parallel private(rec1, rec2, scores1, score1, hits1, scores2, score2, hits2)
-	for (int l1, l2;;) {
+#pragma omp parallel private(rec1, rec2, barcode, scores1, score1, hits1, scores2, score2, hits2)
+	for (bool good = true; good;) {
 #pragma omp critical(kseq)
 		{
-			l1 = kseq_read(kseq1);
-			if (l1 >= 0) {
-				rec1.seq = string(kseq1->seq.s, l1);
+			good = kseq_read(kseq1) >= 0
+					&& (!paired || kseq_read(kseq2) >= 0)
+					&& (kseqIndex == NULL || kseq_read(kseqIndex) >= 0);
+			if (good) {
+				rec1.seq = string(kseq1->seq.s, kseq1->seq.l);
 				rec1.header = string(kseq1->name.s, kseq1->name.l);
 				rec1.qual = string(kseq1->qual.s, kseq1->qual.l);
 				rec1.comment = string(kseq1->comment.s, kseq1->comment.l);
-			}
-			l2 = kseq_read(kseq2);
-			if (l2 >= 0) {
-				rec2.seq = string(kseq2->seq.s, l2);
-				rec2.header = string(kseq2->name.s, kseq2->name.l);
-				rec2.qual = string(kseq2->qual.s, kseq2->qual.l);
-				rec2.comment = string(kseq2->comment.s, kseq2->comment.l);
+				if (paired) {
+					rec2.seq = string(kseq2->seq.s, kseq2->seq.l);
+					rec2.header = string(kseq2->name.s, kseq2->name.l);
+					rec2.qual = string(kseq2->qual.s, kseq2->qual.l);
+					rec2.comment = string(kseq2->comment.s, kseq2->comment.l);
+				}
+				barcode =
+						kseqIndex == NULL ?
+								BarcodeTable::fromComment(rec1.comment) :
+								string(kseqIndex->seq.s, kseqIndex->seq.l);
 			}
 		}
-		if (l1 >= 0 && l2 >= 0) {
+		if (good) {
 #pragma omp critical(totalReads)
 			{
 				++totalReads;
@@ -390,69 +1157,70 @@ void BioBloomClassifier::filterPairPrint(const string &file1,
 							<< endl;
 				}
 			}
-
+			unsigned sample = barcodes.find(barcode);
+#pragma omp atomic
+			++sampleReads[sample];
+			ResultsManager<unsigned> &resSummary = *resSummaries[sample];
 			hits1.clear();
-			hits2.clear();
 			score1 = 0;
-			score2 = 0;
 			scores1.clear();
-			scores2.clear();
-
-			evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1, score2,
-					scores1, scores2);
-
-			unsigned outputFileIndex = resSummary.updateSummaryData(hits1,
-					hits2);
-
-			//Evaluate hit data and record for summary
-			printPair(rec1, rec2, score1, score2, outputFileIndex);
-			printPairToFile(outputFileIndex, rec1, rec2, outputFiles1,
-					outputFiles2, outputType, score1, score2, scores1, scores2, resSummary);
-		} else
-			break;
+			if (paired) {
+				hits2.clear();
+				score2 = 0;
+				scores2.clear();
+				evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1,
+						score2, scores1, scores2, rec1.header.c_str(),
+						rec2.header.c_str());
+				unsigned outputFileIndex = resSummary.updateSummaryData(hits1,
+						hits2);
+				if (!outputType.empty()) {
+					printPairToFile(outputFileIndex, rec1, rec2,
+							outputFiles1[sample], outputFiles2[sample],
+							outputType, score1, score2, scores1, scores2,
+							resSummary);
+				}
+			} else {
+				evaluateRead(rec1.seq, hits1, score1, scores1,
+						rec1.header.c_str());
+				unsigned outputFileIndex = resSummary.updateSummaryData(hits1);
+				if (!outputType.empty()) {
+					printSingleToFile(outputFileIndex, rec1,
+							outputFiles1[sample], outputType, score1, scores1,
+							resSummary);
+				}
+			}
+		}
+	}
+	for (unsigned i = 0; i < kseqs.size(); ++i) {
+		kseq_destroy(kseqs[i]);
+		gzclose(fps[i]);
 	}
-	kseq_destroy(kseq1);
-	kseq_destroy(kseq2);
 
-	//close sorting files
-	for (unsigned i = 0; i < m_filterOrder.size(); ++i) {
-		outputFiles1[i]->close();
-		delete (outputFiles1[i]);
-		cerr << "File written to: "
-				<< m_prefix + "_" + m_filterOrder[i] + "_1." + outputType
-						+ m_postfix << endl;
-		outputFiles2[i]->close();
-		delete (outputFiles2[i]);
-		cerr << "File written to: "
-				<< m_prefix + "_" + m_filterOrder[i] + "_2." + outputType
-						+ m_postfix << endl;
+	//close sorting files and write per sample summaries
+	Dynamicofstream barcodeOutput(m_prefix + "_barcodes.tsv");
+	barcodeOutput << "sample\treads\trate\n";
+	for (unsigned s = 0; s < sampleNames.size(); ++s) {
+		for (unsigned i = 0; i < outputFiles1[s].size(); ++i) {
+			outputFiles1[s][i]->close();
+			delete (outputFiles1[s][i]);
+		}
+		for (unsigned i = 0; i < outputFiles2[s].size(); ++i) {
+			outputFiles2[s][i]->close();
+			delete (outputFiles2[s][i]);
+		}
+		Dynamicofstream summaryOutput(samplePrefixes[s] + "_summary.tsv");
+		summaryOutput << resSummaries[s]->getResultsSummary(sampleReads[s]);
+		summaryOutput.close();
+		delete resSummaries[s];
+		barcodeOutput << sampleNames[s] << "\t" << sampleReads[s] << "\t"
+				<< double(sampleReads[s]) / double(totalReads) << "\n";
 	}
-	outputFiles1[m_filterOrder.size()]->close();
-	delete (outputFiles1[m_filterOrder.size()]);
-	cerr << "File written to: "
-			<< m_prefix + "_" + NO_MATCH + "_1." + outputType + m_postfix
-			<< endl;
-	outputFiles2[m_filterOrder.size()]->close();
-	delete (outputFiles2[m_filterOrder.size()]);
-	cerr << "File written to: "
-			<< m_prefix + "_" + NO_MATCH + "_2." + outputType + m_postfix
-			<< endl;
-	outputFiles1[m_filterOrder.size() + 1]->close();
-	delete (outputFiles1[m_filterOrder.size() + 1]);
-	cerr << "File written to: "
-			<< m_prefix + "_" + MULTI_MATCH + "_1." + outputType + m_postfix
-			<< endl;
-	outputFiles2[m_filterOrder.size() + 1]->close();
-	delete (outputFiles2[m_filterOrder.size() + 1]);
-	cerr << "File written to: "
-			<< m_prefix + "_" + MULTI_MATCH + "_2." + outputType + m_postfix
-			<< endl;
+	barcodeOutput.close();
 	cerr << "Total Reads:" << totalReads << endl;
-	cerr << "Writing file: " << m_prefix + "_summary.tsv" << endl;
-
-	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
-	summaryOutput << resSummary.getResultsSummary(totalReads);
-	summaryOutput.close();
+	cerr << "Undetermined Reads:"
+			<< sampleReads[barcodes.getUndeterminedIndex()] << endl;
+	cerr << "Barcode counts written to: " << m_prefix + "_barcodes.tsv"
+			<< endl;
 	cout.flush();
 }
 
@@ -539,7 +1307,8 @@ void BioBloomClassifier::filterPair(const string &file) {
 				scores2.clear();
 
 				evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1,
-						score2, scores1, scores2);
+						score2, scores1, scores2, rec1.header.c_str(),
+						rec2.header.c_str());
 
 				unsigned outputFileIndex = resSummary.updateSummaryData(hits1,
 						hits2);
@@ -559,6 +1328,7 @@ void BioBloomClassifier::filterPair(const string &file) {
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
 	summaryOutput.close();
 	cout.flush();
 }
@@ -666,7 +1436,8 @@ void BioBloomClassifier::filterPairPrint(const string &file,
 				scores2.clear();
 
 				evaluateReadPair(rec1.seq, rec2.seq, hits1, hits2, score1,
-						score2, scores1, scores2);
+						score2, scores1, scores2, rec1.header.c_str(),
+						rec2.header.c_str());
 
 				unsigned outputFileIndex = resSummary.updateSummaryData(hits1,
 						hits2);
@@ -721,6 +1492,7 @@ void BioBloomClassifier::filterPairPrint(const string &file,
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
 	summaryOutput.close();
 	cout.flush();
 }
@@ -785,7 +1557,8 @@ void BioBloomClassifier::filterPair(const vector<string> &inputFiles1,
 				scores1.clear();
 				scores2.clear();
 				evaluateReadPair(kseq1->seq.s, kseq2->seq.s, hits1, hits2,
-						score1, score2, scores1, scores2);
+						score1, score2, scores1, scores2,
+						kseq1->name.s, kseq2->name.s);
 
 				//Evaluate hit data and record for summary
 				printPair(kseq1, kseq2, score1, score2,
@@ -801,6 +1574,7 @@ void BioBloomClassifier::filterPair(const vector<string> &inputFiles1,
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
 	summaryOutput.close();
 	cout.flush();
 }
@@ -885,7 +1659,8 @@ void BioBloomClassifier::filterPairPrint(const vector<string> &inputFiles1,
 				scores1.clear();
 				scores2.clear();
 				evaluateReadPair(kseq1->seq.s, kseq2->seq.s, hits1, hits2,
-						score1, score2, scores1, scores2);
+						score1, score2, scores1, scores2,
+						kseq1->name.s, kseq2->name.s);
 
 				//Evaluate hit data and record for summary
 				unsigned outputFileIndex = resSummary.updateSummaryData(hits1,
@@ -937,6 +1712,7 @@ void BioBloomClassifier::filterPairPrint(const vector<string> &inputFiles1,
 
 	Dynamicofstream summaryOutput(m_prefix + "_summary.tsv");
 	summaryOutput << resSummary.getResultsSummary(totalReads);
+	printCacheSummary();
 	summaryOutput.close();
 	cout.flush();
 }
@@ -962,6 +1738,10 @@ void BioBloomClassifier::loadFilters(const vector<string> &filterFilePaths) {
 		m_filters.push_back(new BloomFilter(*it));
 		m_filterOrder.push_back(temp->getFilterID());
 		cerr << "Loaded Filter: " + temp->getFilterID();
+		if (temp->getSyncmerSize() > 0) {
+			m_sampled = true;
+			cerr << " Syncmer size: " << temp->getSyncmerSize();
+		}
 		if(opt::scoringMethod == opt::BINOMIAL){
 			cerr << " FPR: " << m_filters.back()->getFPR();
 		}
@@ -970,6 +1750,173 @@ void BioBloomClassifier::loadFilters(const vector<string> &filterFilePaths) {
 	cerr << "Filter Loading Complete." << endl;
 }
 
+/*
+ * Writes the duplicate read cache statistics to [prefix]_cache.tsv if the
+ * cache is used, so the summary file keeps one row per filter
+ */
+void BioBloomClassifier::printCacheSummary() {
+	if (m_readCache != NULL) {
+		cerr << "Duplicate reads reused from cache: "
+				<< m_readCache->getHits() << " Evaluated: "
+				<< m_readCache->getMisses() << " Evicted: "
+				<< m_readCache->getEvictions() << endl;
+		cerr << "Writing file: " << m_prefix + "_cache.tsv" << endl;
+		Dynamicofstream cacheOutput(m_prefix + "_cache.tsv");
+		cacheOutput << m_readCache->getCacheSummary();
+		cacheOutput.close();
+	}
+}
+
+/*
+ * Classifies every read in a batch and records it in the summary
+ */
+void BioBloomClassifier::evaluateBatch(ReadBatch &batch,
+		ResultsManager<unsigned> &rm) {
+	vector<unsigned> hits;
+	hits.reserve(m_filterNum);
+	if (opt::batchSize > 0 && !m_sampled) {
+		evaluateBatchLookups(batch, rm);
+		return;
+	}
+	for (ReadBatch::iterator r = batch.begin(); r != batch.end(); ++r) {
+		hits.clear();
+		r->score = 0;
+		r->scores.clear();
+		evaluateRead(r->rec.seq, hits, r->score, r->scores,
+				r->rec.header.c_str());
+		r->filterID = rm.updateSummaryData(hits);
+	}
+}
+
+void BioBloomClassifier::evaluateBatch(ReadBatch &batch1, ReadBatch &batch2,
+		ResultsManager<unsigned> &rm) {
+	vector<unsigned> hits1;
+	vector<unsigned> hits2;
+	hits1.reserve(m_filterNum);
+	hits2.reserve(m_filterNum);
+	if (opt::batchSize > 0 && !m_sampled) {
+		evaluateBatchLookups(batch1, batch2, rm);
+		return;
+	}
+	for (unsigned i = 0; i < batch1.size(); ++i) {
+		ClassifiedRead &r1 = batch1[i];
+		ClassifiedRead &r2 = batch2[i];
+		hits1.clear();
+		hits2.clear();
+		r1.score = r2.score = 0;
+		r1.scores.clear();
+		r2.scores.clear();
+		evaluateReadPair(r1.rec.seq, r2.rec.seq, hits1, hits2, r1.score,
+				r2.score, r1.scores, r2.scores,
+				r1.rec.header.c_str(), r2.rec.header.c_str());
+		r1.filterID = r2.filterID = rm.updateSummaryData(hits1, hits2);
+	}
+}
+
+/*
+ * Adds count reads to the total, reporting progress every opt::fileInterval
+ */
+void BioBloomClassifier::updateReadCount(size_t &totalReads, size_t count) {
+#pragma omp critical(totalReads)
+	{
+		size_t prevReads = totalReads;
+		totalReads += count;
+		if (prevReads / opt::fileInterval != totalReads / opt::fileInterval) {
+			cerr << "Currently Reading Read Number: "
+					<< totalReads / opt::fileInterval * opt::fileInterval
+					<< endl;
+		}
+	}
+}
+
+/*
+ * Restores summary counts and file positions from a checkpoint when running
+ * with --resume. Returns false if there is nothing to resume from.
+ */
+bool BioBloomClassifier::loadCheckpoint(Checkpoint &ckpt,
+		const vector<string> &inputFiles, ResultsManager<unsigned> &rm,
+		unsigned &fileIndex, size_t &fileReads, size_t &totalReads) {
+	if (!opt::resume || !ckpt.load()) {
+		return false;
+	}
+	if (ckpt.getList<string>("input_files") != inputFiles
+			|| ckpt.getList<string>("filters") != m_filterOrder) {
+		cerr << "Error: Checkpoint " << ckpt.getFileName()
+				<< " was created with different input or filter files."
+				<< endl;
+		exit(1);
+	}
+	fileIndex = ckpt.get<unsigned>("file_index");
+	fileReads = ckpt.get<size_t>("file_reads");
+	totalReads = ckpt.get<size_t>("total_reads");
+	rm.setState(ckpt.get<string>("summary"));
+
+	vector<string> outputNames = ckpt.getList<string>("output_files");
+	vector<size_t> outputSizes = ckpt.getList<size_t>("output_sizes");
+	assert(outputNames.size() == outputSizes.size());
+	for (unsigned i = 0; i < outputNames.size(); ++i) {
+		m_resumeSizes[outputNames[i]] = outputSizes[i];
+	}
+	cerr << "Resuming from checkpoint at read " << totalReads << endl;
+	return true;
+}
+
+/*
+ * Must be called outside of any parallel region
+ */
+void BioBloomClassifier::saveCheckpoint(Checkpoint &ckpt,
+		const vector<string> &inputFiles, const ResultsManager<unsigned> &rm,
+		unsigned fileIndex, size_t fileReads, size_t totalReads,
+		const vector<Dynamicofstream*> &outputFiles) {
+	vector<string> outputNames;
+	vector<size_t> outputSizes;
+	for (vector<Dynamicofstream*>::const_iterator i = outputFiles.begin();
+			i != outputFiles.end(); ++i) {
+		(*i)->sync();
+		outputNames.push_back((*i)->getFileName());
+		outputSizes.push_back(Checkpoint::getFileSize((*i)->getFileName()));
+	}
+	ckpt.setList("input_files", inputFiles);
+	ckpt.setList("filters", m_filterOrder);
+	ckpt.set("file_index", fileIndex);
+	ckpt.set("file_reads", fileReads);
+	ckpt.set("total_reads", totalReads);
+	ckpt.set("summary", rm.getState());
+	ckpt.setList("output_files", outputNames);
+	ckpt.setList("output_sizes", outputSizes);
+	ckpt.save();
+	if (opt::verbose) {
+		cerr << "Checkpoint saved at read " << totalReads << endl;
+	}
+}
+
+/*
+ * Opens an output file. When resuming, output written after the last
+ * checkpoint is discarded and the file is appended to.
+ */
+Dynamicofstream *BioBloomClassifier::openOutput(const string &fileName) {
+	if (m_resumeSizes.find(fileName) != m_resumeSizes.end()) {
+		Checkpoint::truncateFile(fileName, m_resumeSizes[fileName]);
+		return new Dynamicofstream(fileName, true);
+	}
+	return new Dynamicofstream(fileName);
+}
+
+/*
+ * Skips over reads already processed before a checkpoint
+ */
+size_t BioBloomClassifier::skipReads(kseq_t *kseq, size_t count) {
+	size_t skipped = 0;
+	while (skipped < count && kseq_read(kseq) >= 0) {
+		++skipped;
+	}
+	if (skipped < count) {
+		cerr << "Error: Input is shorter than recorded in checkpoint." << endl;
+		exit(1);
+	}
+	return skipped;
+}
+
 ///*
 // * Collaborative filtering method
 // * Assume filters use the same k-mer size
@@ -1144,8 +2091,23 @@ void BioBloomClassifier::loadFilters(const vector<string> &filterFilePaths) {
  */
 void BioBloomClassifier::evaluateReadOrdered(const string &rec,
 		vector<unsigned> &hits) {
+	if (m_adaptiveOrder != NULL) {
+		const vector<unsigned> &order = m_adaptiveOrder->getOrder();
+		for (vector<unsigned>::const_iterator i = order.begin();
+				i != order.end(); ++i) {
+			double start = omp_get_wtime();
+			bool hit = evalRead(rec, *i);
+			m_adaptiveOrder->record(*i, hit, omp_get_wtime() - start);
+			if (hit) {
+				hits.push_back(*i);
+				break;
+			}
+		}
+		m_adaptiveOrder->readDone();
+		return;
+	}
 	for (unsigned i = 0; i != m_filters.size(); ++i) {
-		if (SeqEval::evalRead(rec, *m_filters[i], m_scoreThreshold)) {
+		if (evalRead(rec, i)) {
 			hits.push_back(i);
 			break;
 		}
@@ -1158,31 +2120,63 @@ void BioBloomClassifier::evaluateReadOrdered(const string &rec,
  */
 void BioBloomClassifier::evaluateReadOrderedPair(const string &rec1,
 		const string &rec2, vector<unsigned> &hits1, vector<unsigned> &hits2) {
-	for (unsigned i = 0; i != m_filters.size(); ++i) {
-		if (m_inclusive) {
-			if (SeqEval::evalRead(rec1, *m_filters[i], m_scoreThreshold)
-					|| SeqEval::evalRead(rec2, *m_filters[i],
-							m_scoreThreshold)) {
-				hits1.push_back(i);
-				hits2.push_back(i);
-				break;
-			}
-		} else {
-			if (SeqEval::evalRead(rec1, *m_filters[i], m_scoreThreshold)
-					&& SeqEval::evalRead(rec2, *m_filters[i],
-							m_scoreThreshold)) {
-				hits1.push_back(i);
-				hits2.push_back(i);
+	if (m_adaptiveOrder != NULL) {
+		const vector<unsigned> &order = m_adaptiveOrder->getOrder();
+		for (vector<unsigned>::const_iterator i = order.begin();
+				i != order.end(); ++i) {
+			double start = omp_get_wtime();
+			bool hit = evalPair(rec1, rec2, *i);
+			m_adaptiveOrder->record(*i, hit, omp_get_wtime() - start);
+			if (hit) {
+				hits1.push_back(*i);
+				hits2.push_back(*i);
 				break;
 			}
 		}
+		m_adaptiveOrder->readDone();
+		return;
+	}
+	for (unsigned i = 0; i != m_filters.size(); ++i) {
+		if (evalPair(rec1, rec2, i)) {
+			hits1.push_back(i);
+			hits2.push_back(i);
+			break;
+		}
+	}
+}
+
+/*
+ * Pairs are summarized by the filters either mate (inclusive) or both mates
+ * hit, so a filter is recorded for both mates once the pair hits it
+ */
+void BioBloomClassifier::evaluateReadStdPair(const string &rec1,
+		const string &rec2, vector<unsigned> &hits1, vector<unsigned> &hits2) {
+	for (unsigned i = 0; i != m_filters.size(); ++i) {
+		if (evalPair(rec1, rec2, i)) {
+			hits1.push_back(i);
+			hits2.push_back(i);
+		}
 	}
 }
 
+/*
+ * Evaluates a pair against filter i, skipping the second mate when the first
+ * decides the outcome. The shorter mate is evaluated first as it is cheaper.
+ */
+bool BioBloomClassifier::evalPair(const string &rec1, const string &rec2,
+		unsigned i) const {
+	const string &first = rec1.size() <= rec2.size() ? rec1 : rec2;
+	const string &second = rec1.size() <= rec2.size() ? rec2 : rec1;
+	if (m_inclusive) {
+		return evalRead(first, i) || evalRead(second, i);
+	}
+	return evalRead(first, i) && evalRead(second, i);
+}
+
 void BioBloomClassifier::evaluateReadStd(const string &rec,
 		vector<unsigned> &hits) {
 	for (unsigned i = 0; i != m_filters.size(); ++i) {
-		if (SeqEval::evalRead(rec, *m_filters[i], m_scoreThreshold)) {
+		if (evalRead(rec, i)) {
 			hits.push_back(i);
 		}
 	}
@@ -1198,7 +2192,7 @@ double BioBloomClassifier::evaluateReadBestHit(const string &rec,
 	double maxScore = 0;
 
 	for (unsigned i = 0; i < m_filters.size(); ++i) {
-		double score = SeqEval::evalScore(rec, *m_filters[i]);
+		double score = evalScore(rec, i);
 		if (maxScore < score) {
 			maxScore = score;
 			bestFilters.clear();
@@ -1224,18 +2218,306 @@ double BioBloomClassifier::evaluateReadBestHit(const string &rec,
 void BioBloomClassifier::evaluateReadScore(const string &rec,
 		vector<unsigned> &hits, vector<double> &scores) {
 	for (unsigned i = 0; i < m_filters.size(); ++i) {
-		bool hit = SeqEval::evalRead(rec, *m_filters[i], m_scoreThreshold);
+		bool hit = evalRead(rec, i);
 		if (hit) {
 			hits.emplace_back(i);
 		}
 	}
 	//compute score for multimatches
 	for (unsigned i = 0; i < m_filters.size(); ++i) {
-		double score = SeqEval::evalScore(rec, *m_filters[i]);
+		double score = evalScore(rec, i);
 		scores.emplace_back(score);
 	}
 }
 
+/*
+ * Long reads are split into windows of opt::windowSize k-mers that are looked
+ * up as OpenMP tasks, so threads that run out of reads help to finish them.
+ * Results are the same as evaluating the whole read.
+ */
+void BioBloomClassifier::evaluateReadWindowed(const string &rec,
+		const char *name, vector<unsigned> &hits, double &score,
+		vector<double> &scores) {
+	vector<vector<unsigned char> > flags(m_filters.size());
+	if (opt::mode == opt::ORDERED && m_windowOutput == NULL) {
+		//filters after the first hit are not needed
+		for (unsigned i = 0; i != m_filters.size(); ++i) {
+			scanWindows(rec, i, i + 1, flags);
+			if (SeqEval::replayRead(flags[i], *m_filters[i], rec.size(),
+					m_scoreThreshold)) {
+				hits.push_back(i);
+				break;
+			}
+		}
+		return;
+	}
+	scanWindows(rec, 0, m_filters.size(), flags);
+	classifyFlags(rec, flags, hits, score, scores);
+	if (m_windowOutput != NULL) {
+		printWindows(name, flags);
+	}
+}
+
+/*
+ * Classifies rec from the flags of its k-mers in every filter (see
+ * SeqEval::scanWindows), as evaluateRead would
+ */
+void BioBloomClassifier::classifyFlags(const string &rec,
+		const vector<vector<unsigned char> > &flags, vector<unsigned> &hits,
+		double &score, vector<double> &scores) const {
+	switch (opt::mode) {
+	case opt::ORDERED: {
+		for (unsigned i = 0; i != m_filters.size(); ++i) {
+			if (SeqEval::replayRead(flags[i], *m_filters[i], rec.size(),
+					m_scoreThreshold)) {
+				hits.push_back(i);
+				break;
+			}
+		}
+		break;
+	}
+	case opt::BESTHIT: {
+		vector<unsigned> bestFilters;
+		double maxScore = 0;
+		for (unsigned i = 0; i < m_filters.size(); ++i) {
+			double filterScore = SeqEval::replayScore(flags[i], *m_filters[i],
+					rec.size());
+			if (maxScore < filterScore) {
+				maxScore = filterScore;
+				bestFilters.clear();
+				bestFilters.push_back(i);
+			} else if (maxScore == filterScore) {
+				bestFilters.push_back(i);
+			}
+		}
+		if (maxScore > 0) {
+			for (vector<unsigned>::iterator i = bestFilters.begin();
+					i != bestFilters.end(); ++i) {
+				hits.push_back(*i);
+				scores.push_back(maxScore);
+			}
+		}
+		score = maxScore;
+		break;
+	}
+	case opt::SCORES: {
+		for (unsigned i = 0; i < m_filters.size(); ++i) {
+			if (SeqEval::replayRead(flags[i], *m_filters[i], rec.size(),
+					m_scoreThreshold)) {
+				hits.emplace_back(i);
+			}
+		}
+		for (unsigned i = 0; i < m_filters.size(); ++i) {
+			scores.emplace_back(
+					SeqEval::replayScore(flags[i], *m_filters[i], rec.size()));
+		}
+		break;
+	}
+	default: {
+		for (unsigned i = 0; i != m_filters.size(); ++i) {
+			if (SeqEval::replayRead(flags[i], *m_filters[i], rec.size(),
+					m_scoreThreshold)) {
+				hits.push_back(i);
+			}
+		}
+		break;
+	}
+	}
+}
+
+/*
+ * Looks up the k-mers of rec in filters [first, last) and waits for the lookups
+ */
+void BioBloomClassifier::scanWindows(const string &rec, unsigned first,
+		unsigned last, vector<vector<unsigned char> > &flags) {
+	for (unsigned i = first; i < last; ++i) {
+		SeqEval::scanWindows(rec, *m_filters[i], NULL, opt::windowSize,
+				flags[i]);
+	}
+#pragma omp taskwait
+	if (opt::dust) {
+		for (unsigned i = first; i < last; ++i) {
+			SeqEval::maskLowComp(rec, flags[i]);
+		}
+	}
+}
+
+/*
+ * Looks up the k-mers of every read in a batch in each filter with
+ * SeqEval::scanBatch, setting flags[filter][read]
+ */
+void BioBloomClassifier::scanBatch(const ReadBatch &batch,
+		vector<vector<vector<unsigned char> > > &flags) const {
+	vector<const string*> recs(batch.size());
+	for (unsigned r = 0; r < batch.size(); ++r) {
+		recs[r] = &batch[r].rec.seq;
+	}
+	flags.resize(m_filterNum);
+	for (unsigned i = 0; i < m_filterNum; ++i) {
+		SeqEval::scanBatch(recs, *m_filters[i], flags[i]);
+		if (opt::dust) {
+			for (unsigned r = 0; r < batch.size(); ++r) {
+				SeqEval::maskLowComp(*recs[r], flags[i][r]);
+			}
+		}
+	}
+}
+
+/*
+ * Classifies a batch for --batch, looking up the k-mers of all its reads
+ * together
+ */
+void BioBloomClassifier::evaluateBatchLookups(ReadBatch &batch,
+		ResultsManager<unsigned> &rm) {
+	vector<vector<vector<unsigned char> > > flags;
+	scanBatch(batch, flags);
+	vector<vector<unsigned char> > readFlags(m_filterNum);
+	vector<unsigned> hits;
+	for (unsigned r = 0; r < batch.size(); ++r) {
+		ClassifiedRead &read = batch[r];
+		for (unsigned i = 0; i < m_filterNum; ++i) {
+			readFlags[i].swap(flags[i][r]);
+		}
+		hits.clear();
+		read.score = 0;
+		read.scores.clear();
+		classifyFlags(read.rec.seq, readFlags, hits, read.score, read.scores);
+		read.filterID = rm.updateSummaryData(hits);
+	}
+}
+
+/*
+ * Paired counterpart of evaluateBatchLookups. Pairs are classified as by
+ * evaluateReadPair.
+ */
+void BioBloomClassifier::evaluateBatchLookups(ReadBatch &batch1,
+		ReadBatch &batch2, ResultsManager<unsigned> &rm) {
+	vector<vector<vector<unsigned char> > > flags1, flags2;
+	scanBatch(batch1, flags1);
+	scanBatch(batch2, flags2);
+	vector<vector<unsigned char> > readFlags1(m_filterNum);
+	vector<vector<unsigned char> > readFlags2(m_filterNum);
+	vector<unsigned> hits1;
+	vector<unsigned> hits2;
+	for (unsigned r = 0; r < batch1.size(); ++r) {
+		ClassifiedRead &r1 = batch1[r];
+		ClassifiedRead &r2 = batch2[r];
+		for (unsigned i = 0; i < m_filterNum; ++i) {
+			readFlags1[i].swap(flags1[i][r]);
+			readFlags2[i].swap(flags2[i][r]);
+		}
+		hits1.clear();
+		hits2.clear();
+		r1.score = r2.score = 0;
+		r1.scores.clear();
+		r2.scores.clear();
+		if (opt::mode == opt::ORDERED || opt::mode == opt::STD) {
+			for (unsigned i = 0; i < m_filterNum; ++i) {
+				bool hit1 = SeqEval::replayRead(readFlags1[i], *m_filters[i],
+						r1.rec.seq.size(), m_scoreThreshold);
+				bool hit2 = SeqEval::replayRead(readFlags2[i], *m_filters[i],
+						r2.rec.seq.size(), m_scoreThreshold);
+				if (m_inclusive ? hit1 || hit2 : hit1 && hit2) {
+					hits1.push_back(i);
+					hits2.push_back(i);
+					if (opt::mode == opt::ORDERED) {
+						break;
+					}
+				}
+			}
+		} else {
+			classifyFlags(r1.rec.seq, readFlags1, hits1, r1.score, r1.scores);
+			classifyFlags(r2.rec.seq, readFlags2, hits2, r2.score, r2.scores);
+		}
+		r1.filterID = r2.filterID = rm.updateSummaryData(hits1, hits2);
+	}
+}
+
+void BioBloomClassifier::setPrescreen(const vector<string> &filterFilePaths,
+		unsigned minHits) {
+	m_prescreenHits = minHits;
+	for (unsigned i = 0; i < filterFilePaths.size(); ++i) {
+		const string prefix = filterFilePaths[i].substr(0,
+				filterFilePaths[i].length() - 3);
+		ifstream test((prefix + "_prescreen.bf").c_str());
+		if (!test.good()) {
+			cerr << "Error: No prescreen filter " << prefix
+					<< "_prescreen.bf (make one with biobloommaker --prescreen)"
+					<< endl;
+			exit(1);
+		}
+		BloomFilterInfo info(prefix + "_prescreen.txt");
+		if (info.getSampleRate() == 0
+				|| info.getKmerSize() != m_infoFiles[i]->getKmerSize()) {
+			cerr << "Error: " << prefix << "_prescreen.bf is not a prescreen"
+					<< " filter with the k-mer size of " << filterFilePaths[i]
+					<< endl;
+			exit(1);
+		}
+		m_prescreens.push_back(new BloomFilter(prefix + "_prescreen.bf"));
+		m_prescreenRates.push_back(info.getSampleRate());
+		cerr << "Loaded Prescreen Filter: " << info.getFilterID()
+				<< " Sample rate: 1 in " << info.getSampleRate() << endl;
+	}
+}
+
+void BioBloomClassifier::setWindowOutput() {
+	delete m_windowOutput;
+	cerr << "Writing file: " << m_prefix + "_windows.tsv" << endl;
+	m_windowOutput = new Dynamicofstream(m_prefix + "_windows.tsv");
+	(*m_windowOutput) << "read\tstart\tend";
+	for (vector<string>::const_iterator i = m_filterOrder.begin();
+			i != m_filterOrder.end(); ++i) {
+		(*m_windowOutput) << "\t" << *i;
+	}
+	(*m_windowOutput) << "\n";
+}
+
+/*
+ * One row per window: the k-mer positions [start, end) it covers and the
+ * fraction of its k-mers found in each filter (low complexity k-mers count as
+ * misses with opt::dust)
+ */
+void BioBloomClassifier::printWindows(const char *name,
+		const vector<vector<unsigned char> > &flags) {
+	size_t kmerCount = 0;
+	for (unsigned i = 0; i < flags.size(); ++i) {
+		kmerCount = max(kmerCount, flags[i].size());
+	}
+	stringstream ss;
+	for (size_t start = 0; start < kmerCount; start += opt::windowSize) {
+		size_t end = min(start + opt::windowSize, kmerCount);
+		ss << name << "\t" << start << "\t" << end;
+		for (unsigned i = 0; i < flags.size(); ++i) {
+			unsigned valid = 0;
+			unsigned hit = 0;
+			for (size_t pos = start; pos < min(end, flags[i].size()); ++pos) {
+				if (flags[i][pos] & SeqEval::KMER_VALID) {
+					++valid;
+					if ((flags[i][pos] & (SeqEval::KMER_HIT
+							| SeqEval::KMER_LOWCOMP)) == SeqEval::KMER_HIT) {
+						++hit;
+					}
+				}
+			}
+			ss << "\t" << (valid > 0 ? double(hit) / double(valid) : 0.0);
+		}
+		ss << "\n";
+	}
+#pragma omp critical(windowOutput)
+	(*m_windowOutput) << ss.str();
+}
+
 BioBloomClassifier::~BioBloomClassifier() {
+	delete m_readCache;
+	delete m_windowOutput;
+	for (vector<BloomFilter*>::iterator i = m_prescreens.begin();
+			i != m_prescreens.end(); ++i) {
+		delete *i;
+	}
+	if (m_adaptiveOrder != NULL) {
+		m_adaptiveOrder->printStats(m_filterOrder);
+		delete m_adaptiveOrder;
+	}
 }
 
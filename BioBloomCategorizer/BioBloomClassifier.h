@@ -13,9 +13,16 @@
 #include "Common/BloomFilterInfo.h"
 #include "Common/Dynamicofstream.h"
 #include "Common/SeqEval.h"
+#include "Common/Checkpoint.h"
 #include <zlib.h>
 #include <iostream>
+#include <unordered_map>
 #include "ResultsManager.hpp"
+#include "ReadCache.hpp"
+#include "AdaptiveOrder.hpp"
+#include "OrderedBuffer.hpp"
+#include "Manifest.hpp"
+#include "BarcodeTable.hpp"
 #include "BioBloomCategorizer/Options.h"
 #ifndef KSEQ_INIT_NEW
 #define KSEQ_INIT_NEW
@@ -32,6 +39,17 @@ struct FaRec {
 	string comment;
 };
 
+/*
+ * A read and its classification, kept until it can be written in input order
+ */
+struct ClassifiedRead {
+	FaRec rec;
+	unsigned filterID;
+	double score;
+	vector<double> scores;
+};
+typedef vector<ClassifiedRead> ReadBatch;
+
 ///** for modes of printing out files */
 //enum printMode {FASTA, FASTQ, BEST_FASTA, BEST_FASTQ};
 //enum printMode {NORMAL, WITH_SCORE};
@@ -64,6 +82,15 @@ public:
 	void filterPairPrint(const vector<string> &inputFiles1,
 			const vector<string> &inputFiles2, const string &outputType);
 
+	//manifest (multi-sample) functions
+	void filterManifest(const vector<SampleInfo> &samples,
+			const string &outputType);
+
+	//barcode demultiplexing functions
+	void filterDemux(const vector<string> &inputFiles,
+			const string &indexFile, const BarcodeTable &barcodes,
+			const string &outputType);
+
 	void setOrderedFilter() {
 		if (opt::mode == opt::BESTHIT) {
 			cerr
@@ -74,6 +101,15 @@ public:
 		opt::mode = opt::ORDERED;
 	}
 
+	/*
+	 * In ordered mode, evaluate filters in the order that is cheapest for the
+	 * reads seen so far rather than in priority order
+	 */
+	void setAdaptiveOrder() {
+		delete m_adaptiveOrder;
+		m_adaptiveOrder = new AdaptiveOrder(m_filterNum);
+	}
+
 	void setInclusive() {
 		m_inclusive = true;
 	}
@@ -82,6 +118,27 @@ public:
 		m_stdout = true;
 	}
 
+	/*
+	 * Reuse results for exact duplicate reads, storing up to size reads
+	 */
+	void setReadCache(size_t size) {
+		delete m_readCache;
+		m_readCache = size > 0 ? new ReadCache<unsigned>(size) : NULL;
+	}
+
+	/*
+	 * Load the prescreen filter made with biobloommaker --prescreen next to
+	 * each filter. Reads with fewer than minHits sampled k-mers found in it
+	 * skip full evaluation against the filter.
+	 */
+	void setPrescreen(const vector<string> &filterFilePaths, unsigned minHits);
+
+	/*
+	 * Write the hit rate of each filter in every window of long reads
+	 * (opt::windowSize) to [prefix]_windows.tsv
+	 */
+	void setWindowOutput();
+
 	virtual ~BioBloomClassifier();
 
 private:
@@ -97,7 +154,47 @@ private:
 	bool m_stdout;
 	bool m_inclusive;
 
+	ReadCache<unsigned> *m_readCache;
+	Dynamicofstream *m_windowOutput;
+	//true if any filter holds only syncmers
+	bool m_sampled;
+	AdaptiveOrder *m_adaptiveOrder;
+	//kernels specialized for the scoring options, chosen once
+	SeqEval::ReadEvaluator<BloomFilter> m_evalRead;
+	SeqEval::ScoreEvaluator m_evalScore;
+	//prescreen filter and its sample rate for each filter, if used
+	vector<BloomFilter*> m_prescreens;
+	vector<unsigned> m_prescreenRates;
+	unsigned m_prescreenHits;
+
+	//output file sizes to resume from
+	unordered_map<string, size_t> m_resumeSizes;
+
 	void loadFilters(const vector<string> &filterFilePaths);
+	void filterOrdered(const vector<string> &inputFiles,
+			const string &outputType);
+	void filterPairOrdered(const string &file1, const string &file2,
+			const string &outputType);
+	size_t filterSample(const SampleInfo &sample, const string &outputType);
+	void evaluateBatch(ReadBatch &batch, ResultsManager<unsigned> &rm);
+	void evaluateBatch(ReadBatch &batch1, ReadBatch &batch2,
+			ResultsManager<unsigned> &rm);
+	void evaluateBatchLookups(ReadBatch &batch, ResultsManager<unsigned> &rm);
+	void evaluateBatchLookups(ReadBatch &batch1, ReadBatch &batch2,
+			ResultsManager<unsigned> &rm);
+	void scanBatch(const ReadBatch &batch,
+			vector<vector<vector<unsigned char> > > &flags) const;
+	bool loadCheckpoint(Checkpoint &ckpt, const vector<string> &inputFiles,
+			ResultsManager<unsigned> &rm, unsigned &fileIndex,
+			size_t &fileReads, size_t &totalReads);
+	void saveCheckpoint(Checkpoint &ckpt, const vector<string> &inputFiles,
+			const ResultsManager<unsigned> &rm, unsigned fileIndex,
+			size_t fileReads, size_t totalReads,
+			const vector<Dynamicofstream*> &outputFiles);
+	Dynamicofstream *openOutput(const string &fileName);
+	void printCacheSummary();
+	void updateReadCount(size_t &totalReads, size_t count);
+	size_t skipReads(kseq_t *kseq, size_t count);
 	void evaluateReadStd(const string &rec, vector<unsigned> &hits);
 //	void evaluateReadMin(const string &rec, vector<unsigned> &hits);
 //	void evaluateReadCollab(const string &rec, vector<unsigned> &hits);
@@ -111,6 +208,45 @@ private:
 //			vector<unsigned> &hits1, vector<unsigned> &hits2);
 	void evaluateReadOrderedPair(const string &rec1, const string &rec2,
 			vector<unsigned> &hits1, vector<unsigned> &hits2);
+	void evaluateReadStdPair(const string &rec1, const string &rec2,
+			vector<unsigned> &hits1, vector<unsigned> &hits2);
+	bool evalPair(const string &rec1, const string &rec2, unsigned i) const;
+	void evaluateReadWindowed(const string &rec, const char *name,
+			vector<unsigned> &hits, double &score, vector<double> &scores);
+	void scanWindows(const string &rec, unsigned first, unsigned last,
+			vector<vector<unsigned char> > &flags);
+	void classifyFlags(const string &rec,
+			const vector<vector<unsigned char> > &flags,
+			vector<unsigned> &hits, double &score,
+			vector<double> &scores) const;
+	void printWindows(const char *name,
+			const vector<vector<unsigned char> > &flags);
+
+	/*
+	 * Evaluates rec against filter i, only looking up syncmers if the filter
+	 * was built from syncmers. Reads failing the prescreen are not evaluated.
+	 */
+	inline bool evalRead(const string &rec, unsigned i) const {
+		if (!m_prescreens.empty()
+				&& !SeqEval::prescreen(rec, *m_prescreens[i],
+						m_prescreenRates[i], m_prescreenHits)) {
+			return false;
+		}
+		unsigned syncmerSize = m_infoFiles[i]->getSyncmerSize();
+		if (syncmerSize > 0) {
+			return SeqEval::evalSampledRead(rec, *m_filters[i],
+					m_scoreThreshold, syncmerSize);
+		}
+		return m_evalRead(rec, *m_filters[i], m_scoreThreshold, NULL);
+	}
+
+	inline double evalScore(const string &rec, unsigned i) const {
+		unsigned syncmerSize = m_infoFiles[i]->getSyncmerSize();
+		if (syncmerSize > 0) {
+			return SeqEval::evalSampledScore(rec, *m_filters[i], syncmerSize);
+		}
+		return m_evalScore(rec, *m_filters[i], NULL);
+	}
 
 	inline void printSingle(const FaRec &rec, double score, unsigned filterID) {
 		if (m_stdout) {
@@ -529,7 +665,16 @@ private:
 	}
 
 	inline void evaluateRead(const string &rec, vector<unsigned> &hits,
-			double &score, vector<double> &scores) {
+			double &score, vector<double> &scores, const char *name) {
+		if (opt::windowSize > 0 && rec.size() > 2 * opt::windowSize
+				&& !m_sampled && m_adaptiveOrder == NULL) {
+			evaluateReadWindowed(rec, name, hits, score, scores);
+			return;
+		}
+		if (m_readCache != NULL
+				&& m_readCache->find(rec, hits, score, scores)) {
+			return;
+		}
 		switch (opt::mode) {
 		case opt::ORDERED: {
 			evaluateReadOrdered(rec, hits);
@@ -552,19 +697,38 @@ private:
 			break;
 		}
 		}
+		if (m_readCache != NULL) {
+			m_readCache->insert(rec, hits, score, scores);
+		}
 	}
 
 	inline void evaluateReadPair(const string &rec1, const string &rec2,
 			vector<unsigned> &hits1, vector<unsigned> &hits2, double &score1,
-			double &score2, vector<double> &scores1, vector<double> &scores2) {
+			double &score2, vector<double> &scores1, vector<double> &scores2,
+			const char *name1, const char *name2) {
 		switch (opt::mode) {
 		case opt::ORDERED: {
 			evaluateReadOrderedPair(rec1, rec2, hits1, hits2);
 			break;
 		}
+		case opt::STD: {
+			//only the outcome of the pair is needed unless the mates are
+			//cached or windowed separately
+			if (m_readCache == NULL
+					&& (opt::windowSize == 0 || m_sampled
+							|| m_adaptiveOrder != NULL
+							|| max(rec1.size(), rec2.size())
+									<= 2 * opt::windowSize)) {
+				evaluateReadStdPair(rec1, rec2, hits1, hits2);
+				break;
+			}
+			evaluateRead(rec1, hits1, score1, scores1, name1);
+			evaluateRead(rec2, hits2, score2, scores2, name2);
+			break;
+		}
 		default: {
-			evaluateRead(rec1, hits1, score1, scores1);
-			evaluateRead(rec2, hits2, score2, scores2);
+			evaluateRead(rec1, hits1, score1, scores1, name1);
+			evaluateRead(rec2, hits2, score2, scores2, name2);
 			break;
 		}
 		}
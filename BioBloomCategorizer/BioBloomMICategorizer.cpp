@@ -100,6 +100,11 @@ void printHelpDialog()
 	"  -h, --help             Display this dialog.\n"
 	"  -v, --verbose          Display verbose output\n"
 	"  -I, --interval         the interval to report file processing status [10000000]\n"
+	"      --preserve_order   Output reads in input order when using multiple threads.\n"
+	"      --manifest=N       Classify every sample listed in file N, loading the\n"
+	"                         filter once. Each line is a sample name followed by\n"
+	"                         its read file (two files with -e). Reads of each sample\n"
+	"                         are written to [-p]_[name]_reads.[tsv|fq|fa].\n"
 	"Advanced options:\n"
 	"  -a, --frameMatches=N   Min number seed matches needed in a frame to match [1]\n"
 	"                         Ignored if k-mers used when indexing.\n"
@@ -128,6 +133,10 @@ int main(int argc, char *argv[])
 	int FASTA = 0;
 	int TSV = 0;
 	int OPT_VERSION = 0;
+	int PRESERVE_ORDER = 0;
+	enum {
+		OPT_MANIFEST = 1
+	};
 
 	opt::score = pow(10.0,-10.0);
 //	opt::streakThreshold = 10;
@@ -149,6 +158,8 @@ int main(int argc, char *argv[])
 		"tsv", no_argument, &TSV, 1 }, {
 		"hitOnly", no_argument, NULL, 'i' }, {
 		"version", no_argument, &OPT_VERSION, 1 }, {
+		"preserve_order", no_argument, &PRESERVE_ORDER, 1 }, {
+		"manifest", required_argument, NULL, OPT_MANIFEST }, {
 		"multi", required_argument, NULL, 'm' }, {
 		"streak", required_argument, NULL, 'r' }, {
 		"minNoSat", required_argument, NULL, 'c' }, {
@@ -256,6 +267,10 @@ int main(int argc, char *argv[])
 			opt::hitOnly = true;
 			break;
 		}
+		case OPT_MANIFEST: {
+			opt::manifestFile = optarg;
+			break;
+		}
 		case '?': {
 			die = true;
 			break;
@@ -271,14 +286,21 @@ int main(int argc, char *argv[])
 	if (OPT_VERSION) {
 		printVersion();
 	}
+	opt::preserveOrder = PRESERVE_ORDER;
 
 	while (optind < argc) {
 		inputFiles.push_back(argv[optind]);
 		optind++;
 	}
 
+	if (!opt::manifestFile.empty() && inputFiles.size() > 0) {
+		cerr << "--manifest cannot be used with read files specified in arguments"
+				<< endl;
+		exit(1);
+	}
+
 	//check validity of inputs for paired end mode
-	if (opt::paired && inputFiles.size() != 2) {
+	if (opt::paired && inputFiles.size() != 2 && opt::manifestFile.empty()) {
 		cerr << "Usage of paired end mode:\n"
 				<< "BioBloomCategorizer [OPTION]... -f \"[FILTER1]...\" [FILEPAIR1] [FILEPAIR2]\n"
 				<< endl;
@@ -292,7 +314,7 @@ int main(int argc, char *argv[])
 	}
 
 	//Check needed options
-	if (inputFiles.size() == 0) {
+	if (inputFiles.size() == 0 && opt::manifestFile.empty()) {
 		cerr << "Error: Need Input File" << endl;
 		die = true;
 	}
@@ -330,7 +352,9 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 	MIBFClassifier BMC(opt::filtersFile);
-	if (opt::paired) {
+	if (!opt::manifestFile.empty()) {
+		BMC.filterManifest(loadManifest(opt::manifestFile, opt::paired));
+	} else if (opt::paired) {
 		BMC.filterPair(inputFiles[0], inputFiles[1]);
 	} else if (opt::debug) {
 		BMC.filterDebug(inputFiles);
@@ -17,10 +17,13 @@
 #include "btl_bloomfilter/MIBloomFilter.hpp"
 #include "btl_bloomfilter/vendor/stHashIterator.hpp"
 #include "btl_bloomfilter/vendor/ntHashIterator.hpp"
+#include "Common/ntHashJumpIterator.hpp"
 #include "btl_bloomfilter/MIBFQuerySupport.hpp"
 #include <iostream>
 #include "Common/Options.h"
 #include "ResultsManager.hpp"
+#include "OrderedBuffer.hpp"
+#include "Manifest.hpp"
 //#include <BioBloomClassifier.h>
 #include <tuple>
 #include "Common/concurrentqueue.h"
@@ -226,6 +229,8 @@ public:
 				while (kseq_read(seq) >= 0) {
 					filterSingleRead(*seq, support, resSummary, outBuffer);
 				}
+			} else if (opt::preserveOrder) {
+				filterOrdered(*it, resSummary);
 			} else {
 				moodycamel::ConcurrentQueue<kseq_t> workQueue(
 						opt::threads * s_bulkSize);
@@ -437,6 +442,8 @@ public:
 						resSummary, outBuffer);
 				//------------------------WORK CODE END-----------------------------------------
 			}
+		} else if (opt::preserveOrder) {
+			filterPairOrdered(file1, file2, resSummary);
 		} else {
 			bool good = true;
 			moodycamel::ConcurrentQueue<pair<kseq_t, kseq_t>> workQueue(
@@ -616,6 +623,33 @@ public:
 		cout.flush();
 	}
 
+	/*
+	 * Classifies every sample in a manifest (--manifest) with the filter loaded
+	 * once. Threads take whole samples from a shared list so many small samples
+	 * keep all cores busy. Reads of each sample are written to
+	 * [prefix]_reads.[tsv|fq|fa] rather than stdout.
+	 */
+	void filterManifest(const vector<SampleInfo> &samples) {
+		cerr << "Filtering Start" << endl;
+		double startTime = omp_get_wtime();
+		size_t totalReads = 0;
+#pragma omp parallel reduction(+:totalReads)
+		{
+			MIBFQuerySupport<ID> support = MIBFQuerySupport<ID>(m_filter,
+					m_perFrameProb, opt::multiThresh, opt::streakThreshold,
+					m_allowedMiss, opt::minCountNonSatCount,
+					opt::bestHitCountAgree);
+#pragma omp for schedule(dynamic)
+			for (size_t i = 0; i < samples.size(); ++i) {
+				totalReads += filterSample(samples[i], support);
+			}
+		}
+		cerr << "Classification time (s): " << (omp_get_wtime() - startTime)
+				<< endl;
+		cerr << "Samples: " << samples.size() << endl;
+		cerr << "Total Reads:" << totalReads << endl;
+	}
+
 private:
 	MIBloomFilter<ID> m_filter;
 	size_t m_numRead;
@@ -735,8 +769,196 @@ private:
 		outStr += "\n";
 	}
 
+	/*
+	 * Classifies a single sample of a manifest on the calling thread.
+	 * Returns the number of reads (or pairs) classified.
+	 */
+	size_t filterSample(const SampleInfo &sample,
+			MIBFQuerySupport<ID> &support) {
+		string outputName = sample.prefix + "_reads.tsv";
+		if (opt::outputType == opt::FASTQ) {
+			outputName = sample.prefix + "_reads.fq";
+		} else if (opt::outputType == opt::FASTA) {
+			outputName = sample.prefix + "_reads.fa";
+		}
+		ofstream readsOutput(outputName.c_str());
+		ResultsManager<ID> resSummary(m_fullIDs, false);
+		bool paired = !sample.file2.empty();
+
+		gzFile fp1 = gzopen(sample.file1.c_str(), "r");
+		if (fp1 == Z_NULL) {
+			cerr << "file " << sample.file1 << " cannot be opened" << endl;
+			exit(1);
+		}
+		gzFile fp2 = Z_NULL;
+		if (paired) {
+			fp2 = gzopen(sample.file2.c_str(), "r");
+			if (fp2 == Z_NULL) {
+				cerr << "file " << sample.file2 << " cannot be opened" << endl;
+				exit(1);
+			}
+		}
+		kseq_t *seq1 = kseq_init(fp1);
+		kseq_t *seq2 = paired ? kseq_init(fp2) : NULL;
+		string outBuffer;
+		size_t reads = 0;
+		while (kseq_read(seq1) >= 0 && (!paired || kseq_read(seq2) >= 0)) {
+			++reads;
+			outBuffer.clear();
+			if (paired) {
+				formatPairedRead(*seq1, *seq2, support, resSummary, outBuffer);
+			} else {
+				formatSingleRead(*seq1, support, resSummary, outBuffer);
+			}
+			readsOutput << outBuffer;
+		}
+		kseq_destroy(seq1);
+		gzclose(fp1);
+		if (paired) {
+			kseq_destroy(seq2);
+			gzclose(fp2);
+		}
+		readsOutput.close();
+
+		ofstream summaryOutput(sample.prefix + "_summary.tsv");
+		summaryOutput << resSummary.getResultsSummary(reads);
+		summaryOutput.close();
+#pragma omp critical(cerr)
+		cerr << "Sample " << sample.name << ": " << reads << " reads, written "
+				<< "to " << outputName << endl;
+		return reads;
+	}
+
+	/*
+	 * Used with --preserve_order when running multithreaded. Reads are
+	 * classified in parallel in batches and written to stdout through a reorder
+	 * buffer so output is in the same order as with a single thread.
+	 */
+	void filterOrdered(const string &file, ResultsManager<ID> &resSummary) {
+		gzFile fp = gzopen(file.c_str(), "r");
+		kseq_t *seq = kseq_init(fp);
+		OrderedBuffer<string> buffer(s_orderedBatchesPerThread * opt::threads);
+		bool eof = false;
+#pragma omp parallel
+		{
+			vector<kseq_t> readBuffer(s_bulkSize, kseq_t());
+			string outBuffer;
+			MIBFQuerySupport<ID> support = MIBFQuerySupport<ID>(m_filter,
+					m_perFrameProb, opt::multiThresh, opt::streakThreshold,
+					m_allowedMiss, opt::minCountNonSatCount,
+					opt::bestHitCountAgree);
+			for (unsigned size = 1; size > 0;) {
+				size_t batchNum;
+				size = 0;
+#pragma omp critical(kseq_read)
+				{
+					batchNum = buffer.nextBatch();
+					while (!eof && size < s_bulkSize) {
+						if (kseq_read(seq) >= 0) {
+							cpy_kseq(&readBuffer[size++], seq);
+							if (++m_numRead % opt::fileInterval == 0) {
+								cerr << "Currently Reading Read Number: "
+										<< m_numRead << endl;
+							}
+						} else {
+							eof = true;
+						}
+					}
+				}
+				outBuffer.clear();
+				for (unsigned i = 0; i < size; ++i) {
+					formatSingleRead(readBuffer[i], support, resSummary,
+							outBuffer);
+				}
+				buffer.commit(batchNum, outBuffer, [](string &out) {
+					cout << out;
+				});
+			}
+			freeReadBuffer(readBuffer);
+		}
+		kseq_destroy(seq);
+		gzclose(fp);
+	}
+
+	/*
+	 * Paired end counterpart of filterOrdered
+	 */
+	void filterPairOrdered(const string &file1, const string &file2,
+			ResultsManager<ID> &resSummary) {
+		gzFile fp1 = gzopen(file1.c_str(), "r");
+		gzFile fp2 = gzopen(file2.c_str(), "r");
+		kseq_t *seq1 = kseq_init(fp1);
+		kseq_t *seq2 = kseq_init(fp2);
+		OrderedBuffer<string> buffer(s_orderedBatchesPerThread * opt::threads);
+		bool eof = false;
+#pragma omp parallel
+		{
+			vector<kseq_t> readBuffer1(s_bulkSize, kseq_t());
+			vector<kseq_t> readBuffer2(s_bulkSize, kseq_t());
+			string outBuffer;
+			MIBFQuerySupport<ID> support = MIBFQuerySupport<ID>(m_filter,
+					m_perFrameProb, opt::multiThresh, opt::streakThreshold,
+					m_allowedMiss, opt::minCountNonSatCount,
+					opt::bestHitCountAgree);
+			for (unsigned size = 1; size > 0;) {
+				size_t batchNum;
+				size = 0;
+#pragma omp critical(kseq_read)
+				{
+					batchNum = buffer.nextBatch();
+					while (!eof && size < s_bulkSize) {
+						if (kseq_read(seq1) >= 0 && kseq_read(seq2) >= 0) {
+							cpy_kseq(&readBuffer1[size], seq1);
+							cpy_kseq(&readBuffer2[size++], seq2);
+							if (++m_numRead % opt::fileInterval == 0) {
+								cerr << "Currently Reading Read Number: "
+										<< m_numRead << endl;
+							}
+						} else {
+							eof = true;
+						}
+					}
+				}
+				outBuffer.clear();
+				for (unsigned i = 0; i < size; ++i) {
+					formatPairedRead(readBuffer1[i], readBuffer2[i], support,
+							resSummary, outBuffer);
+				}
+				buffer.commit(batchNum, outBuffer, [](string &out) {
+					cout << out;
+				});
+			}
+			freeReadBuffer(readBuffer1);
+			freeReadBuffer(readBuffer2);
+		}
+		kseq_destroy(seq1);
+		kseq_destroy(seq2);
+		gzclose(fp1);
+		gzclose(fp2);
+	}
+
+	void freeReadBuffer(vector<kseq_t> &readBuffer) {
+		for (vector<kseq_t>::iterator i = readBuffer.begin();
+				i != readBuffer.end(); ++i) {
+			free(i->name.s);
+			free(i->comment.s);
+			free(i->seq.s);
+			free(i->qual.s);
+		}
+	}
+
 	void filterSingleRead(const kseq_t &read, MIBFQuerySupport<ID> &support,
 			ResultsManager<ID> &resSummary, string &outStr) {
+		outStr.clear();
+		formatSingleRead(read, support, resSummary, outStr);
+		cout << outStr;
+	}
+
+	/*
+	 * Classifies a read and appends its output to outStr
+	 */
+	void formatSingleRead(const kseq_t &read, MIBFQuerySupport<ID> &support,
+			ResultsManager<ID> &resSummary, string &outStr) {
 		const vector<MIBFQuerySupport<ID>::QueryResult> &signifResults =
 				classify(support, read.seq.s);
 #pragma omp atomic
@@ -745,13 +967,18 @@ private:
 		if(opt::hitOnly && signifResults.empty()){
 			return;
 		}
-		outStr.clear();
 		formatOutStr(read, outStr, support, signifResults);
-		cout << outStr;
 	}
 
 	void filterPairedRead(const kseq_t &read1, const kseq_t &read2, MIBFQuerySupport<ID> &support,
 			ResultsManager<ID> &resSummary, string &outStr) {
+		outStr.clear();
+		formatPairedRead(read1, read2, support, resSummary, outStr);
+		cout << outStr;
+	}
+
+	void formatPairedRead(const kseq_t &read1, const kseq_t &read2, MIBFQuerySupport<ID> &support,
+			ResultsManager<ID> &resSummary, string &outStr) {
 		const vector<MIBFQuerySupport<ID>::QueryResult> &signifResults =
 				classify(support, read1.seq.s, read2.seq.s);
 #pragma omp atomic
@@ -759,11 +986,9 @@ private:
 		if(opt::hitOnly && signifResults.empty()) {
 			return;
 		}
-		outStr.clear();
 		resSummary.updateSummaryData(signifResults);
 		formatOutStr(read1, outStr, support, signifResults);
 		formatOutStr(read2, outStr, support, signifResults);
-		cout << outStr;
 	}
 
 	/*
@@ -789,7 +1014,7 @@ private:
 					m_filter.getHashNum(), 1, m_filter.getKmerSize());
 			return support.query(itr, *m_minCount[frameCount]);
 		} else {
-			ntHashIterator itr(seq, m_filter.getHashNum(),
+			ntHashJumpIterator itr(seq, m_filter.getHashNum(),
 					m_filter.getKmerSize());
 			return support.query(itr, *m_minCount[frameCount]);
 		}
@@ -825,9 +1050,9 @@ private:
 					m_filter.getKmerSize());
 			return support.query(itr1, itr2, *m_minCount[frameCount]);
 		} else {
-			ntHashIterator itr1(seq1, m_filter.getHashNum(),
+			ntHashJumpIterator itr1(seq1, m_filter.getHashNum(),
 					m_filter.getKmerSize());
-			ntHashIterator itr2(seq2, m_filter.getHashNum(),
+			ntHashJumpIterator itr2(seq2, m_filter.getHashNum(),
 					m_filter.getKmerSize());
 			return support.query(itr1, itr2, *m_minCount[frameCount]);
 		}
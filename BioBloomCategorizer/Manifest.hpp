@@ -0,0 +1,70 @@
+/*
+ * Manifest.hpp
+ *
+ * Sample manifest for classifying many samples in one process (--manifest).
+ * Each non-empty line holds a sample name followed by its read file, or two
+ * read files in paired end mode (-e). Lines starting with '#' are ignored.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef MANIFEST_HPP_
+#define MANIFEST_HPP_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include "Options.h"
+
+using namespace std;
+
+struct SampleInfo {
+	string name;
+	//output prefix of this sample, derived from -p and name
+	string prefix;
+	string file1;
+	//empty unless paired
+	string file2;
+};
+
+static inline vector<SampleInfo> loadManifest(const string &fileName,
+		bool paired) {
+	vector<SampleInfo> samples;
+	ifstream manifest(fileName.c_str());
+	if (!manifest.is_open()) {
+		cerr << "Error: manifest " << fileName << " cannot be opened" << endl;
+		exit(1);
+	}
+	string line;
+	for (unsigned lineNum = 1; getline(manifest, line); ++lineNum) {
+		stringstream ss(line);
+		SampleInfo sample;
+		if (!(ss >> sample.name) || sample.name[0] == '#') {
+			continue;
+		}
+		ss >> sample.file1 >> sample.file2;
+		string extra;
+		if (sample.file1.empty() || sample.file2.empty() == paired
+				|| ss >> extra) {
+			cerr << "Error: line " << lineNum << " of manifest " << fileName
+					<< " should contain a sample name and "
+					<< (paired ? "two read files" : "one read file") << endl;
+			exit(1);
+		}
+		sample.prefix =
+				opt::outputPrefix.empty() ?
+						sample.name : opt::outputPrefix + "_" + sample.name;
+		samples.push_back(sample);
+	}
+	if (samples.empty()) {
+		cerr << "Error: manifest " << fileName << " contains no samples"
+				<< endl;
+		exit(1);
+	}
+	return samples;
+}
+
+#endif /* MANIFEST_HPP_ */
@@ -34,6 +34,18 @@ unsigned minCountNonSatCount = 0;
 unsigned frameMatches = 1;
 
 bool hitOnly = false;
+
+size_t dupCacheSize = 0;
+bool preserveOrder = false;
+string manifestFile = "";
+string barcodeFile = "";
+string indexReadFile = "";
+unsigned barcodeMismatches = 1;
+size_t windowSize = 0;
+bool windowOutput = false;
+bool adaptiveOrder = false;
+unsigned prescreen = 0;
+size_t batchSize = 0;
 }
 
 
@@ -46,5 +46,17 @@ extern unsigned minCountNonSatCount;
 extern unsigned frameMatches;
 
 extern bool hitOnly;
+
+extern size_t dupCacheSize;
+extern bool preserveOrder;
+extern std::string manifestFile;
+extern std::string barcodeFile;
+extern std::string indexReadFile;
+extern unsigned barcodeMismatches;
+extern size_t windowSize;
+extern bool windowOutput;
+extern bool adaptiveOrder;
+extern unsigned prescreen;
+extern size_t batchSize;
 }
 #endif
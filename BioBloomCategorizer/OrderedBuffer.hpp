@@ -0,0 +1,83 @@
+/*
+ * OrderedBuffer.hpp
+ *
+ * Reorder buffer used to write output in input order while reads are
+ * classified in parallel. Input is read in numbered batches; finished batches
+ * are held until every earlier batch has been written.
+ *
+ * At most maxPending batches may be in flight (read but not yet written), so
+ * memory stays bounded even if one thread falls behind.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef ORDEREDBUFFER_HPP_
+#define ORDEREDBUFFER_HPP_
+
+#include <map>
+#include <algorithm>
+#include <sched.h>
+#include <omp.h>
+
+using namespace std;
+
+//batches in flight per thread, enough to keep threads busy while one is slow
+static const unsigned s_orderedBatchesPerThread = 4;
+
+template<typename T>
+class OrderedBuffer {
+public:
+	explicit OrderedBuffer(size_t maxPending) :
+			m_maxPending(maxPending), m_nextBatch(0), m_nextWrite(0) {
+		omp_init_lock(&m_lock);
+	}
+
+	/*
+	 * Returns the number of the next batch to be read. Call while holding the
+	 * input lock. Waits while the buffer is full.
+	 */
+	size_t nextBatch() {
+		for (;;) {
+			size_t nextWrite;
+#pragma omp atomic read
+			nextWrite = m_nextWrite;
+			if (m_nextBatch < nextWrite + m_maxPending) {
+				break;
+			}
+			sched_yield();
+		}
+		return m_nextBatch++;
+	}
+
+	/*
+	 * Hands over a finished batch and writes out all batches that are next in
+	 * order using write(T&). Every number from nextBatch() must be committed,
+	 * even if the batch is empty. batch is left in an unspecified state.
+	 */
+	template<typename F>
+	void commit(size_t batchNum, T &batch, F write) {
+		omp_set_lock(&m_lock);
+		swap(m_pending[batchNum], batch);
+		typename map<size_t, T>::iterator it = m_pending.begin();
+		while (it != m_pending.end() && it->first == m_nextWrite) {
+			write(it->second);
+			it = m_pending.erase(it);
+#pragma omp atomic
+			++m_nextWrite;
+		}
+		omp_unset_lock(&m_lock);
+	}
+
+	virtual ~OrderedBuffer() {
+		omp_destroy_lock(&m_lock);
+	}
+
+private:
+	const size_t m_maxPending;
+	size_t m_nextBatch;
+	size_t m_nextWrite;
+	map<size_t, T> m_pending;
+	omp_lock_t m_lock;
+};
+
+#endif /* ORDEREDBUFFER_HPP_ */
@@ -0,0 +1,180 @@
+/*
+ * ReadCache.hpp
+ *
+ * Bounded cache of classification results keyed by read sequence. Used to
+ * avoid re-evaluating exact duplicate reads (e.g. amplicon libraries).
+ *
+ * The cache is set associative (s_ways entries per set). A full set evicts
+ * using a second chance policy: entries that were hit since the last eviction
+ * scan are skipped once. Sets are protected by a fixed pool of striped locks
+ * so threads only contend when they touch the same stripe.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef READCACHE_HPP_
+#define READCACHE_HPP_
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+#include <omp.h>
+
+using namespace std;
+
+template<typename T>
+class ReadCache {
+public:
+	explicit ReadCache(size_t size) :
+			m_setNum(size / s_ways + (size % s_ways != 0)), m_entries(
+					m_setNum * s_ways), m_locks(s_lockNum), m_hits(0), m_misses(
+					0), m_evictions(0) {
+		for (vector<omp_lock_t>::iterator i = m_locks.begin();
+				i != m_locks.end(); ++i) {
+			omp_init_lock(&(*i));
+		}
+	}
+
+	/*
+	 * Returns true and copies the stored results if seq is in the cache
+	 */
+	bool find(const string &seq, vector<T> &hits, double &score,
+			vector<double> &scores) {
+		size_t hashVal = m_hasher(seq);
+		size_t set = hashVal % m_setNum;
+		bool found = false;
+		omp_set_lock(&m_locks[set % s_lockNum]);
+		for (size_t i = set * s_ways; i < (set + 1) * s_ways; ++i) {
+			Entry &entry = m_entries[i];
+			if (entry.used && entry.hashVal == hashVal && entry.seq == seq) {
+				hits = entry.hits;
+				score = entry.score;
+				scores = entry.scores;
+				entry.referenced = true;
+				found = true;
+				break;
+			}
+		}
+		omp_unset_lock(&m_locks[set % s_lockNum]);
+		if (found) {
+#pragma omp atomic
+			++m_hits;
+		} else {
+#pragma omp atomic
+			++m_misses;
+		}
+		return found;
+	}
+
+	void insert(const string &seq, const vector<T> &hits, double score,
+			const vector<double> &scores) {
+		size_t hashVal = m_hasher(seq);
+		size_t set = hashVal % m_setNum;
+		bool evicted = false;
+		omp_set_lock(&m_locks[set % s_lockNum]);
+		size_t slot = set * s_ways;
+		size_t end = slot + s_ways;
+		for (size_t i = slot; i < end; ++i) {
+			//another thread may have inserted the same read already
+			if (m_entries[i].used && m_entries[i].hashVal == hashVal
+					&& m_entries[i].seq == seq) {
+				omp_unset_lock(&m_locks[set % s_lockNum]);
+				return;
+			}
+		}
+		for (; slot < end && m_entries[slot].used; ++slot) {
+		}
+		if (slot == end) {
+			//second chance eviction
+			evicted = true;
+			slot = set * s_ways;
+			for (size_t i = slot; i < end; ++i) {
+				if (!m_entries[i].referenced) {
+					slot = i;
+					break;
+				}
+				m_entries[i].referenced = false;
+			}
+		}
+		Entry &entry = m_entries[slot];
+		entry.used = true;
+		entry.referenced = false;
+		entry.hashVal = hashVal;
+		entry.seq = seq;
+		entry.hits = hits;
+		entry.score = score;
+		entry.scores = scores;
+		omp_unset_lock(&m_locks[set % s_lockNum]);
+		if (evicted) {
+#pragma omp atomic
+			++m_evictions;
+		}
+	}
+
+	size_t getHits() const {
+		return m_hits;
+	}
+
+	size_t getMisses() const {
+		return m_misses;
+	}
+
+	size_t getEvictions() const {
+		return m_evictions;
+	}
+
+	/*
+	 * Table of the cache statistics, written to [prefix]_cache.tsv. Hits are
+	 * reads answered from the cache, misses are reads evaluated. The hit rate
+	 * is 0 when no reads were looked up.
+	 */
+	const string getCacheSummary() const {
+		stringstream summaryOutput;
+		size_t lookups = max(m_hits + m_misses, size_t(1));
+		summaryOutput << "cache_size\thits\tmisses\tevictions\trate_hit\n";
+		summaryOutput << m_entries.size();
+		summaryOutput << "\t" << m_hits;
+		summaryOutput << "\t" << m_misses;
+		summaryOutput << "\t" << m_evictions;
+		summaryOutput << "\t" << double(m_hits) / double(lookups);
+		summaryOutput << "\n";
+		return summaryOutput.str();
+	}
+
+	virtual ~ReadCache() {
+		for (vector<omp_lock_t>::iterator i = m_locks.begin();
+				i != m_locks.end(); ++i) {
+			omp_destroy_lock(&(*i));
+		}
+	}
+
+private:
+	static const unsigned s_ways = 4;
+	static const unsigned s_lockNum = 1024;
+
+	struct Entry {
+		bool used;
+		bool referenced;
+		size_t hashVal;
+		string seq;
+		vector<T> hits;
+		double score;
+		vector<double> scores;
+		Entry() :
+				used(false), referenced(false), hashVal(0), score(0) {
+		}
+	};
+
+	const size_t m_setNum;
+	vector<Entry> m_entries;
+	vector<omp_lock_t> m_locks;
+	std::hash<string> m_hasher;
+
+	size_t m_hits;
+	size_t m_misses;
+	size_t m_evictions;
+};
+
+#endif /* READCACHE_HPP_ */
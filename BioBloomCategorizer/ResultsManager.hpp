@@ -236,6 +236,34 @@ public:
 		return summaryOutput.str();
 	}
 
+	/*
+	 * Serializes counts for checkpointing
+	 */
+	const string getState() const {
+		stringstream ss;
+		for (unsigned i = 0; i < m_aboveThreshold.size(); ++i) {
+			ss << m_aboveThreshold[i] << " " << m_unique[i] << " ";
+		}
+		ss << m_multiMatch << " " << m_noMatch;
+		return ss.str();
+	}
+
+	/*
+	 * Restores counts from a checkpoint
+	 */
+	void setState(const string &state) {
+		stringstream ss(state);
+		for (unsigned i = 0; i < m_aboveThreshold.size(); ++i) {
+			ss >> m_aboveThreshold[i] >> m_unique[i];
+		}
+		ss >> m_multiMatch >> m_noMatch;
+		if (ss.fail()) {
+			cerr << "Error: Summary data in checkpoint does not match filters"
+					<< endl;
+			exit(1);
+		}
+	}
+
 	T getNoMatchIndex() const {
 		return m_noMatchIndex;
 	}
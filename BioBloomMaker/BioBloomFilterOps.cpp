@@ -0,0 +1,292 @@
+/*
+ * BioBloomFilterOps.cpp
+ *
+ * Combines filters made by biobloommaker with the same size, k-mer size and
+ * number of hash functions by OR, AND or AND-NOT of their bit arrays, without
+ * going back to the sequences. Filters are streamed in blocks so memory use
+ * does not depend on the filter size.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <getopt.h>
+#include "config.h"
+#include "Common/BloomFilterInfo.h"
+#include "btl_bloomfilter/BloomFilter.hpp"
+#include "FilterOps.hpp"
+#if _OPENMP
+# include <omp.h>
+#endif
+
+using namespace std;
+using namespace FilterOps;
+
+#define PROGRAM "biobloomfilterops"
+
+//largest expected fraction of k-mers -s may lose without --force
+static const double s_maxSubtractLoss = 0.01;
+
+void printVersion() {
+	const char VERSION_MESSAGE[] =
+	PROGRAM " (" PACKAGE_NAME ") " GIT_REVISION "\n"
+	"Written by Justin Chu.\n"
+	"\n"
+	"Copyright 2013 Canada's Michael Smith Genome Science Centre\n";
+	cerr << VERSION_MESSAGE << endl;
+	exit(EXIT_SUCCESS);
+}
+
+void printHelpDialog() {
+	static const char dialog[] =
+		"Usage: biobloomfilterops -p [FILTERID] [OPERATION] [FILTER.bf]...\n"
+		"Combines filters made by biobloommaker into a new bf and txt file. All\n"
+		"filters must have the same size, k-mer size and number of hash functions,\n"
+		"and each must have its txt file next to it.\n"
+		"\n"
+		"  -p, --file_prefix=N    Filter prefix and filter ID. Required option.\n"
+		"  -o, --output_dir=N     Output location of the filter and filter info files.\n"
+		"  -t, --threads=N        The number of threads to use.\n"
+		"  -h, --help             Display this dialog.\n"
+		"      --version          Display version information.\n"
+		"\nOperations (one is required):\n"
+		"  -u, --union            K-mers in any of the filters.\n"
+		"  -i, --intersect        K-mers in all of the filters. The false positive rate\n"
+		"                         is higher than for a filter of only those k-mers.\n"
+		"  -s, --subtract         Clear the bits of the first filter set in any of the\n"
+		"                         others. This removes the k-mers of the others, but\n"
+		"                         also every k-mer of the first filter that shares a\n"
+		"                         bit with them. The expected fraction lost is printed,\n"
+		"                         and -s stops if it is above 1%. Use biobloommaker -s\n"
+		"                         to build a filter without the k-mers of another.\n"
+		"      --force            Subtract even if more than 1% of k-mers are lost.\n"
+		"\n"
+		"Report bugs to <cjustin@bcgsc.ca>.";
+	cerr << dialog << endl;
+	exit(0);
+}
+
+int main(int argc, char *argv[]) {
+
+	bool die = false;
+
+	//switch statement variable
+	int c;
+
+	//command line variables
+	string filterPrefix = "";
+	string outputDir = "";
+	Operation op = NO_OP;
+	unsigned threads = 0;
+	bool force = false;
+
+	enum {
+		OPT_VERSION, OPT_FORCE
+	};
+
+	//long form arguments
+	static struct option long_options[] = {
+		{
+			"file_prefix", required_argument, NULL, 'p' }, {
+			"output_dir", required_argument, NULL, 'o' }, {
+			"threads", required_argument, NULL, 't' }, {
+			"union", no_argument, NULL, 'u' }, {
+			"intersect", no_argument, NULL, 'i' }, {
+			"subtract", no_argument, NULL, 's' }, {
+			"force", no_argument, NULL, OPT_FORCE }, {
+			"help", no_argument, NULL, 'h' }, {
+			"version", no_argument, NULL, OPT_VERSION }, {
+			NULL, 0, NULL, 0 } };
+
+	//actual checking step
+	int option_index = 0;
+	while ((c = getopt_long(argc, argv, "p:o:t:uish", long_options,
+			&option_index)) != -1) {
+		switch (c) {
+		case 'p': {
+			filterPrefix = optarg;
+			break;
+		}
+		case 'o': {
+			outputDir = optarg;
+			if (outputDir.at(outputDir.length() - 1) != '/') {
+				outputDir = outputDir + '/';
+			}
+			break;
+		}
+		case 't': {
+			stringstream convert(optarg);
+			if (!(convert >> threads)) {
+				cerr << "Error - Invalid parameter! t: " << optarg << endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case 'u':
+		case 'i':
+		case 's': {
+			Operation chosen = c == 'u' ? UNION : c == 'i' ? INTERSECT : SUBTRACT;
+			if (op != NO_OP && op != chosen) {
+				cerr << "Only one of -u, -i and -s may be used" << endl;
+				die = true;
+			}
+			op = chosen;
+			break;
+		}
+		case 'h': {
+			printHelpDialog();
+			break;
+		}
+		case OPT_VERSION: {
+			printVersion();
+			break;
+		}
+		case OPT_FORCE: {
+			force = true;
+			break;
+		}
+		default: {
+			die = true;
+			break;
+		}
+		}
+	}
+
+#if defined(_OPENMP)
+	if (threads > 0)
+	omp_set_num_threads(threads);
+#endif
+
+	vector<string> filterFiles;
+	while (optind < argc) {
+		filterFiles.push_back(argv[optind]);
+		optind++;
+	}
+
+	//Check needed options
+	if (filterFiles.size() < 2) {
+		cerr << "Need at least two filters" << endl;
+		die = true;
+	}
+	if (op == NO_OP) {
+		cerr << "Need an operation (-u, -i or -s)" << endl;
+		die = true;
+	}
+	if (filterPrefix.size() == 0) {
+		cerr << "Need Filter Prefix ID" << endl;
+		die = true;
+	}
+	if (filterPrefix.find('/') != string::npos) {
+		cerr << "Prefix ID cannot have '/' characters" << endl;
+		die = true;
+	}
+	const string outputName = outputDir + filterPrefix + ".bf";
+	for (vector<string>::const_iterator i = filterFiles.begin();
+			i != filterFiles.end(); ++i) {
+		if (*i == outputName) {
+			cerr << "Output would overwrite input filter " << *i << endl;
+			die = true;
+		}
+	}
+	if (die) {
+		cerr << "Try '--help' for more information.\n";
+		exit(EXIT_FAILURE);
+	}
+
+	//check filters are compatible
+	vector<FILE*> files(filterFiles.size());
+	vector<BloomFilter::FileHeader> headers(filterFiles.size());
+	vector<BloomFilterInfo*> infos(filterFiles.size());
+	vector<string> seqSrcs;
+	for (unsigned i = 0; i < filterFiles.size(); ++i) {
+		files[i] = openFilter(filterFiles[i], headers[i]);
+		const string infoFileName = filterFiles[i].substr(0,
+				filterFiles[i].length() - 2) + "txt";
+		infos[i] = new BloomFilterInfo(infoFileName);
+		seqSrcs.push_back(filterFiles[i]);
+		if (memcmp(headers[i].magic, headers[0].magic,
+				sizeof(headers[0].magic)) != 0
+				|| headers[i].size != headers[0].size
+				|| headers[i].nhash != headers[0].nhash
+				|| headers[i].kmer != headers[0].kmer
+				|| infos[i]->getSyncmerSize() != infos[0]->getSyncmerSize()) {
+			cerr << "Error: " << filterFiles[i] << " and " << filterFiles[0]
+					<< " differ in size, k-mer size, number of hash functions"
+					<< " or syncmer size" << endl;
+			exit(1);
+		}
+	}
+
+	const size_t filterBytes = headers[0].size / 8;
+	if (op == SUBTRACT) {
+		size_t subtractPop = unionPopcount(files, filterFiles, 1,
+				filterBytes);
+		double loss = subtractLoss(subtractPop, headers[0].size,
+				headers[0].nhash);
+		cerr << "Bits set in the filters to subtract: " << subtractPop
+				<< " of " << headers[0].size << ". Expected fraction of the"
+				<< " k-mers of " << filterFiles[0] << " lost: " << loss
+				<< endl;
+		if (loss > s_maxSubtractLoss && !force) {
+			cerr << "Error: Subtracting would lose more than "
+					<< s_maxSubtractLoss * 100 << "% of the k-mers of "
+					<< filterFiles[0] << ". Build the filter with"
+					<< " biobloommaker -s instead, or use --force." << endl;
+			exit(1);
+		}
+	}
+	cerr << "Combining " << filterFiles.size() << " filters of "
+			<< headers[0].size << " bits" << endl;
+
+	FILE *output = fopen(outputName.c_str(), "wb");
+	if (output == NULL) {
+		cerr << "Error: Could not open " << outputName << endl;
+		exit(1);
+	}
+	//header is written again once the population is known
+	BloomFilter::FileHeader header = headers[0];
+	fwrite(&header, sizeof(BloomFilter::FileHeader), 1, output);
+
+	size_t pop = combineFilters(op, files, filterFiles, filterBytes, output,
+			outputName);
+	for (vector<FILE*>::iterator i = files.begin(); i != files.end(); ++i) {
+		fclose(*i);
+	}
+
+	if (pop == 0 || pop == header.size) {
+		cerr << "Error: The resulting filter is "
+				<< (pop == 0 ? "empty" : "full") << endl;
+		fclose(output);
+		remove(outputName.c_str());
+		exit(1);
+	}
+
+	size_t entries = BloomFilterInfo::calcEntriesFromPop(header.size, pop,
+			header.nhash);
+	BloomFilterInfo info(filterPrefix, header.kmer, header.nhash,
+			infos[0]->getFPR(), entries, seqSrcs);
+	info.setSyncmerSize(infos[0]->getSyncmerSize());
+	info.setPopcount(header.size, pop);
+	header.dFPR = info.getFPR();
+	header.nEntry = entries;
+	header.tEntry = entries;
+	fseek(output, 0, SEEK_SET);
+	fwrite(&header, sizeof(BloomFilter::FileHeader), 1, output);
+	fclose(output);
+
+	info.printInfoFile(outputDir + filterPrefix + ".txt");
+	cerr << "Bits set: " << pop << " Approximate entries: " << entries
+			<< " FPR: " << info.getFPR() << endl;
+	for (vector<BloomFilterInfo*>::iterator i = infos.begin();
+			i != infos.end(); ++i) {
+		delete *i;
+	}
+	cerr << "Filter Creation Complete." << endl;
+	return 0;
+}
@@ -9,7 +9,9 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <algorithm>
 #include "BloomFilterGenerator.h"
+#include "ManifestBuilder.hpp"
 #include "Common/BloomFilterInfo.h"
 #include "Common/SeqEval.h"
 #include <getopt.h>
@@ -73,6 +75,35 @@ void printHelpDialog() {
 		"                         progressive mode.\n"
 		"  -n, --num_ele=N        Set the number of expected elements. If set to 0 number\n"
 		"                         is determined from sequences sizes within files. [0]\n"
+		"      --syncmer=N        Insert only open syncmers with s-mer length N, about\n"
+		"                         1 in k-N+1 k-mers. The filter is smaller and reads are\n"
+		"                         classified with fewer lookups. k-N must be even. Not\n"
+		"                         supported in progressive mode. [0]\n"
+		"      --prescreen=N      Also write [prefix]_prescreen.bf, a small filter of 1\n"
+		"                         in N k-mers (chosen by hash value) that lets\n"
+		"                         biobloomcategorizer --prescreen skip reads unlikely\n"
+		"                         to match. Not supported with -r or --syncmer. [0]\n"
+		"      --single_pass      Read the input files once. The filter is built with a\n"
+		"                         size estimated from the file sizes (or -n), then\n"
+		"                         folded to the size needed for the number of k-mers\n"
+		"                         inserted. Uses more memory while building. Not\n"
+		"                         supported in progressive mode.\n"
+		"      --append=N         Insert the k-mers of the files into the existing\n"
+		"                         filter N (.bf) in place and update its info file,\n"
+		"                         instead of building a new filter. Warns if the FPR\n"
+		"                         becomes higher than the filter was built for.\n"
+		"      --max_fpr=N        With --append, refuse to update the filter if its\n"
+		"                         projected FPR is higher than N. [0 = no limit]\n"
+		"      --manifest=N       Build every filter listed in file N in one run. Each\n"
+		"                         line holds a filter ID, a filter to subtract (or -)\n"
+		"                         and its sequence files. Filters with the same files\n"
+		"                         share reading and hashing.\n"
+		"      --max_mem=N        Use at most N GB for the filter and subtract filter\n"
+		"                         (-s) while building. Larger filters are built one\n"
+		"                         region at a time from bit positions written to disk.\n"
+		"                         Not supported in progressive mode. [0 = no limit]\n"
+		"      --tmp_dir=N        Directory for the bit positions written with\n"
+		"                         --max_mem. [output directory]\n"
 		"\nOptions for progressive filters:\n"
 		"  -r, --progressive=N    Progressive filter creation. The score threshold is\n"
 		"                         specified by N, which may be either a floating point\n"
@@ -86,16 +117,31 @@ void printHelpDialog() {
 		"                         wish to create.\n"
 		"  -d, --no_rep_kmer      Remove all repeat k-mers from the resulting filter in\n"
 		"                         progressive mode.\n"
+		"      --fuse_subtract    Keep a copy of the filter with the subtract filter (-s)\n"
+		"                         fused into it, so reads are checked against both with\n"
+		"                         one memory access per hash. The filter is made the same\n"
+		"                         size as the subtract filter. The filter being built\n"
+		"                         takes three times its size in memory, plus the\n"
+		"                         subtract filter. Not used with -b.\n"
 		"  -a, --streak=N         The number of hits tiling in second pass needed to jump\n"
 		"                         Several tiles upon a miss. Progressive mode only. [3]\n"
 		"  -l, --file_list=N      A file of list of file pairs to run in parallel.\n"
 		"  -b, --baitScore=N      Score threshold when considering only bait. [r]\n"
 		"  -e, --iterations=N     Pass through files N times if threshold is not met.\n"
+		"                         Pairs recruited in a pass are not recruited, printed\n"
+		"                         (-P) or counted again in later passes, unless -l or\n"
+		"                         --checkpoint is used.\n"
 		"  -i, --inclusive        If one paired read matches, both reads will be included\n"
 		"                         in the filter. Only active with the (-r) option.\n"
 		"  -I, --interval         the interval to report file processing status [10000000]\n"
 		"  -P, --print_reads      During progressive filter creation, print tagged reads\n"
 		"                         to STDOUT in FASTQ format for debugging [disabled]\n"
+		"      --deterministic    Recruit the same reads for any number of threads, as\n"
+		"                         if pairs were read one at a time in input order.\n"
+		"      --checkpoint=N     Save the partially built filter every N read pairs so\n"
+		"                         an interrupted run can be continued with --resume. [0]\n"
+		"      --resume           Continue from the checkpoint saved for this filter.\n"
+		"                         Requires --deterministic or -t 1.\n"
 		"\n"
 		"Report bugs to <cjustin@bcgsc.ca>.";
 	cerr << dialog << endl;
@@ -103,9 +149,109 @@ void printHelpDialog() {
 }
 
 enum {
-	OPT_VERSION
+	OPT_VERSION, OPT_CHECKPOINT, OPT_RESUME, OPT_SYNCMER, OPT_FUSE_SUBTRACT,
+	OPT_PRESCREEN, OPT_SINGLE_PASS, OPT_DETERMINISTIC, OPT_APPEND, OPT_MAX_FPR,
+	OPT_MANIFEST, OPT_MAX_MEM, OPT_TMP_DIR
 };
 
+//size unit of filters built to be folded (--single_pass), so they can be
+//folded by any factor up to 10
+static const size_t s_foldableSizeUnit = 64 * 2520;
+
+
+/*
+ * Writes info to the info file infoFile next to it, then renames it over
+ * infoFile
+ */
+static void replaceInfoFile(const BloomFilterInfo &info,
+		const string &infoFile) {
+	string tempName = infoFile + ".tmp";
+	info.printInfoFile(tempName);
+	if (rename(tempName.c_str(), infoFile.c_str()) != 0) {
+		cerr << "Error: Could not replace " << infoFile << endl;
+		exit(1);
+	}
+}
+
+/*
+ * Inserts the k-mers of inputFiles into an existing filter and updates its
+ * info file. Only the new files are read, and the bits of the filter are set
+ * in place. Refuses if the FPR projected from the estimated number of k-mers
+ * not yet in the filter exceeds maxFPR (if set), and warns if it exceeds the
+ * FPR the filter was built for.
+ */
+int appendToFilter(const string &filterFile, const vector<string> &inputFiles,
+		double maxFPR) {
+	if (filterFile.length() < 3
+			|| filterFile.substr(filterFile.length() - 3) != ".bf") {
+		cerr << "Error: --append needs a filter file ending in .bf" << endl;
+		exit(1);
+	}
+	string infoFile = filterFile.substr(0, filterFile.length() - 2) + "txt";
+	BloomFilterInfo info(infoFile);
+	if (info.getSampleRate() > 0) {
+		cerr << "Error: Cannot append to a prescreen filter" << endl;
+		exit(1);
+	}
+	//new k-mers must be chosen and hashed as the filter's were
+	opt::kmerSize = info.getKmerSize();
+	opt::hashNum = info.getHashNum();
+	opt::syncmerSize = info.getSyncmerSize();
+
+	//the number of entries is not used, so the files are not counted here
+	BloomFilterGenerator filterGen(inputFiles, opt::kmerSize, opt::hashNum,
+			1);
+	MappedFilter filter(filterFile);
+	size_t newEntries = filterGen.estimateNewEntries(filter);
+	double projectedFPR = info.projectFPR(newEntries);
+	cerr << "Estimated " << newEntries
+			<< " k-mers not yet in the filter. Projected FPR " << projectedFPR
+			<< endl;
+	if (maxFPR > 0 && projectedFPR > maxFPR) {
+		cerr << "Error: Projected FPR is above --max_fpr " << maxFPR
+				<< ". Rebuild the filter with all files instead." << endl;
+		exit(1);
+	}
+	if (projectedFPR > info.getDesiredFPR()) {
+		cerr << "Warning: Projected FPR is above the FPR the filter was built"
+				<< " for (" << info.getDesiredFPR() << ")" << endl;
+	}
+
+	//a prescreen filter next to the filter is updated with the same k-mers
+	string prescreenPrefix = filterFile.substr(0, filterFile.length() - 3)
+			+ "_prescreen";
+	MappedFilter *prescreen = NULL;
+	if (ifstream((prescreenPrefix + ".bf").c_str()).good()) {
+		BloomFilterInfo prescreenInfo(prescreenPrefix + ".txt");
+		if (prescreenInfo.getSampleRate() == 0) {
+			cerr << "Error: " << prescreenPrefix
+					<< ".bf is not a prescreen filter" << endl;
+			exit(1);
+		}
+		filterGen.setPrescreen(prescreenInfo.getSampleRate(), 0);
+		prescreen = new MappedFilter(prescreenPrefix + ".bf");
+	}
+
+	size_t redundNum = filterGen.append(filter, prescreen);
+	info.addEntries(filterGen.getTotalEntries(), redundNum, inputFiles);
+	filter.setStats(info.getFPR(), info.getTotalNum());
+	filter.close();
+	replaceInfoFile(info, infoFile);
+	cerr << "FPR of updated filter " << info.getFPR() << endl;
+	if (prescreen != NULL) {
+		BloomFilterInfo prescreenInfo(prescreenPrefix + ".txt");
+		prescreenInfo.addEntries(filterGen.getPrescreenEntries(), 0,
+				inputFiles);
+		prescreen->setStats(prescreenInfo.getFPR(),
+				prescreenInfo.getTotalNum());
+		delete prescreen;
+		replaceInfoFile(prescreenInfo, prescreenPrefix + ".txt");
+		cerr << "FPR of updated prescreen filter " << prescreenInfo.getFPR()
+				<< endl;
+	}
+	cerr << "Filter Update Complete." << endl;
+	return 0;
+}
 
 int main(int argc, char *argv[]) {
 
@@ -123,6 +269,13 @@ int main(int argc, char *argv[]) {
 	double progressive = -1;
 	bool inclusive = false;
 	string fileListFilename = "";
+	unsigned prescreenRate = 0;
+	bool singlePass = false;
+	string appendFilter = "";
+	double maxFPR = 0;
+	string manifestFile = "";
+	double maxMem = 0;
+	string tmpDir = "";
 
 	//long form arguments
 	static struct option long_options[] = {
@@ -147,6 +300,18 @@ int main(int argc, char *argv[]) {
 			"interval",	required_argument, NULL, 'I' }, {
 			"verbose", no_argument, NULL, 'v' }, {
 			"version", no_argument, NULL, OPT_VERSION }, {
+			"checkpoint", required_argument, NULL, OPT_CHECKPOINT }, {
+			"resume", no_argument, NULL, OPT_RESUME }, {
+			"syncmer", required_argument, NULL, OPT_SYNCMER }, {
+			"fuse_subtract", no_argument, NULL, OPT_FUSE_SUBTRACT }, {
+			"prescreen", required_argument, NULL, OPT_PRESCREEN }, {
+			"single_pass", no_argument, NULL, OPT_SINGLE_PASS }, {
+			"deterministic", no_argument, NULL, OPT_DETERMINISTIC }, {
+			"append", required_argument, NULL, OPT_APPEND }, {
+			"max_fpr", required_argument, NULL, OPT_MAX_FPR }, {
+			"manifest", required_argument, NULL, OPT_MANIFEST }, {
+			"max_mem", required_argument, NULL, OPT_MAX_MEM }, {
+			"tmp_dir", required_argument, NULL, OPT_TMP_DIR }, {
 			NULL, 0, NULL, 0 } };
 
 	//actual checking step
@@ -319,6 +484,82 @@ int main(int argc, char *argv[]) {
 			printVersion();
 			exit(EXIT_SUCCESS);
 		}
+		case OPT_CHECKPOINT: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::checkpoint)) {
+				cerr << "Error - Invalid parameter! checkpoint: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_RESUME: {
+			opt::resume = true;
+			break;
+		}
+		case OPT_FUSE_SUBTRACT: {
+			opt::fuseSubtract = true;
+			break;
+		}
+		case OPT_SYNCMER: {
+			stringstream convert(optarg);
+			if (!(convert >> opt::syncmerSize)) {
+				cerr << "Error - Invalid parameter! syncmer: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_SINGLE_PASS: {
+			singlePass = true;
+			break;
+		}
+		case OPT_DETERMINISTIC: {
+			opt::deterministic = true;
+			break;
+		}
+		case OPT_APPEND: {
+			appendFilter = optarg;
+			break;
+		}
+		case OPT_MAX_FPR: {
+			stringstream convert(optarg);
+			if (!(convert >> maxFPR) || maxFPR <= 0 || maxFPR > 1) {
+				cerr << "Error - Invalid parameter! max_fpr: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_MANIFEST: {
+			manifestFile = optarg;
+			break;
+		}
+		case OPT_MAX_MEM: {
+			stringstream convert(optarg);
+			if (!(convert >> maxMem) || maxMem <= 0) {
+				cerr << "Error - Invalid parameter! max_mem: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		case OPT_TMP_DIR: {
+			tmpDir = optarg;
+			if (tmpDir.at(tmpDir.length() - 1) != '/') {
+				tmpDir = tmpDir + '/';
+			}
+			break;
+		}
+		case OPT_PRESCREEN: {
+			stringstream convert(optarg);
+			if (!(convert >> prescreenRate)) {
+				cerr << "Error - Invalid parameter! prescreen: " << optarg
+						<< endl;
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
 		default: {
 			die = true;
 			break;
@@ -340,11 +581,12 @@ int main(int argc, char *argv[]) {
 	}
 
 	//Check needed options
-	if (inputFiles.size() == 0) {
+	if (inputFiles.size() == 0 && manifestFile.empty()) {
 		cerr << "Need Input File" << endl;
 		die = true;
 	}
-	if (filterPrefix.size() == 0) {
+	if (filterPrefix.size() == 0 && appendFilter.empty()
+			&& manifestFile.empty()) {
 		cerr << "Need Filter Prefix ID" << endl;
 		die = true;
 	}
@@ -352,11 +594,93 @@ int main(int argc, char *argv[]) {
 		cerr << "Prefix ID cannot have '/' characters" << endl;
 		die = true;
 	}
+	if (opt::syncmerSize > 0) {
+		if (!Syncmers::validSize(opt::kmerSize, opt::syncmerSize)) {
+			cerr << "--syncmer must be less than the k-mer size (-k) and "
+					<< "differ from it by an even number" << endl;
+			die = true;
+		}
+		if (progressive != -1) {
+			cerr << "--syncmer is not supported in progressive mode (-r)"
+					<< endl;
+			die = true;
+		}
+	}
+	if (prescreenRate > 0 && (progressive != -1 || opt::syncmerSize > 0)) {
+		cerr << "--prescreen is not supported in progressive mode (-r) or"
+				<< " with --syncmer" << endl;
+		die = true;
+	}
+	if (singlePass && progressive != -1) {
+		cerr << "--single_pass is not supported in progressive mode (-r)"
+				<< endl;
+		die = true;
+	}
+	if (opt::deterministic
+			&& (progressive == -1 || !fileListFilename.empty()
+					|| (opt::baitThreshold != -1
+							&& opt::baitThreshold != progressive))) {
+		cerr << "--deterministic requires progressive mode (-r) with one pair"
+				<< " of read files, without -l or -b" << endl;
+		die = true;
+	}
+	if (opt::fuseSubtract && (progressive == -1 || subtractFilter.empty())) {
+		cerr << "--fuse_subtract requires progressive mode (-r) and a subtract"
+				<< " filter (-s)" << endl;
+		die = true;
+	}
+	//the bait filter is not fused with the subtract filter
+	if (opt::fuseSubtract && opt::baitThreshold != -1
+			&& opt::baitThreshold != progressive) {
+		cerr << "--fuse_subtract cannot be used with a bait score (-b)"
+				<< endl;
+		die = true;
+	}
+	if (!appendFilter.empty()
+			&& (!filterPrefix.empty() || progressive != -1 || singlePass
+					|| prescreenRate > 0 || opt::syncmerSize > 0
+					|| entryNum > 0 || !subtractFilter.empty())) {
+		cerr << "--append updates the filter in place and takes its settings"
+				<< " from it, so it cannot be used with -p, -r, -n, -s,"
+				<< " --syncmer, --prescreen or --single_pass" << endl;
+		die = true;
+	}
+	if (!manifestFile.empty()
+			&& (!inputFiles.empty() || !filterPrefix.empty()
+					|| progressive != -1 || singlePass || prescreenRate > 0
+					|| !subtractFilter.empty() || !appendFilter.empty())) {
+		cerr << "--manifest lists the filters to build with their files and"
+				<< " subtract filters, so it cannot be used with input files,"
+				<< " -p, -r, -s, --prescreen, --single_pass or --append"
+				<< endl;
+		die = true;
+	}
+	if (maxMem > 0
+			&& (progressive != -1 || singlePass || prescreenRate > 0
+					|| opt::fuseSubtract || !appendFilter.empty()
+					|| !manifestFile.empty())) {
+		cerr << "--max_mem is not supported in progressive mode (-r) or with"
+				<< " --single_pass, --prescreen, --append or --manifest"
+				<< endl;
+		die = true;
+	}
+	if (!tmpDir.empty() && maxMem == 0) {
+		cerr << "--tmp_dir requires --max_mem" << endl;
+		die = true;
+	}
+	if (maxFPR > 0 && appendFilter.empty()) {
+		cerr << "--max_fpr requires --append" << endl;
+		die = true;
+	}
 	if (die) {
 		cerr << "Try '--help' for more information.\n";
 		exit(EXIT_FAILURE);
 	}
 
+	if (!appendFilter.empty()) {
+		return appendToFilter(appendFilter, inputFiles, maxFPR);
+	}
+
 	//set number of hash functions used
 	if (opt::hashNum == 0) {
 		if (opt::filterType == BLOOMMAP) {
@@ -372,6 +696,14 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
+	if (!manifestFile.empty()) {
+		ManifestBuilder builder(loadBuildManifest(manifestFile), outputDir,
+				opt::kmerSize, opt::hashNum, opt::fpr, entryNum);
+		builder.build();
+		cerr << "Filter Creation Complete." << endl;
+		return 0;
+	}
+
 	string file1 = "";
 	string file2 = "";
 
@@ -398,6 +730,20 @@ int main(int argc, char *argv[]) {
 					<< endl;
 			exit(1);
 		}
+		if ((opt::checkpoint || opt::resume)
+				&& (fileListFilename != ""
+						|| opt::baitThreshold != progressive)) {
+			cerr
+					<< "--checkpoint and --resume are not supported with file lists (-l) or bait scores (-b)"
+					<< endl;
+			exit(1);
+		}
+		//threads recruit pairs in a different order after resuming
+		if (opt::resume && !opt::deterministic && opt::threads != 1) {
+			cerr << "--resume requires --deterministic or one thread (-t 1)"
+					<< " to give the filter of an uninterrupted run" << endl;
+			exit(1);
+		}
 		cerr << "Building Bloom filter in progressive mode. ";
 		switch (opt::scoringMethod) {
 		case opt::LENGTH:
@@ -416,6 +762,13 @@ int main(int argc, char *argv[]) {
 		exit(0);
 	}
 
+	if (singlePass && entryNum == 0) {
+		entryNum = BloomFilterGenerator::estimateMaxEntries(inputFiles,
+				opt::kmerSize);
+		cerr << "Estimated at most " << entryNum << " k-mers from file sizes"
+				<< endl;
+	}
+
 	//create filter
 	BloomFilterGenerator filterGen(inputFiles, opt::kmerSize, opt::hashNum, entryNum);
 
@@ -426,14 +779,60 @@ int main(int argc, char *argv[]) {
 
 	BloomFilterInfo info(filterPrefix, opt::kmerSize, opt::hashNum, opt::fpr, entryNum,
 			inputFiles);
+	info.setSyncmerSize(opt::syncmerSize);
+	double distinctError = 0;
+	size_t distinctEstimate = filterGen.getDistinctEstimate(distinctError);
+	if (distinctEstimate > 0) {
+		info.setDistinctEstimate(distinctEstimate, distinctError);
+	}
 
 	//get calculated size of Filter
 	size_t filterSize = info.getCalcuatedFilterSize();
+	if (opt::fuseSubtract) {
+		//fused filters must have the same size
+		size_t subtractSize = FusedSubtractFilter::fileFilterSize(
+				subtractFilter);
+		if (subtractSize == 0) {
+			cerr << "Error: Could not read filter " << subtractFilter << endl;
+			exit(1);
+		}
+		if (subtractSize < filterSize) {
+			cerr << "Warning: Subtract filter is smaller than needed for the"
+					<< " desired false positive rate" << endl;
+		}
+		if (subtractSize != filterSize) {
+			cerr << "Filter size changed from " << filterSize << " to "
+					<< subtractSize << " bits, the size of the subtract filter"
+					<< " (--fuse_subtract)" << endl;
+		}
+		filterSize = subtractSize;
+		info.setFilterSize(filterSize);
+	}
+	if (singlePass) {
+		filterSize += s_foldableSizeUnit - 1;
+		filterSize -= filterSize % s_foldableSizeUnit;
+	}
 	cerr << "Allocating " << filterSize
 			<< " bits of space for filter and will output filter this size (plus header)"
 			<< endl;
 	filterGen.setFilterSize(filterSize);
 
+	//prescreen filter has the same FPR for its 1 in prescreenRate k-mers
+	BloomFilterInfo prescreenInfo(filterPrefix + "_prescreen", opt::kmerSize,
+			opt::hashNum, opt::fpr, max(entryNum / max(prescreenRate, 1u),
+					size_t(1)), inputFiles);
+	prescreenInfo.setSampleRate(prescreenRate);
+	size_t prescreenSize = prescreenInfo.getCalcuatedFilterSize();
+	if (singlePass) {
+		prescreenSize += s_foldableSizeUnit - 1;
+		prescreenSize -= prescreenSize % s_foldableSizeUnit;
+	}
+	if (prescreenRate > 0) {
+		cerr << "Allocating " << prescreenSize
+				<< " bits of space for prescreen filter" << endl;
+		filterGen.setPrescreen(prescreenRate, prescreenSize);
+	}
+
 	size_t redundNum = 0;
 	//output filter
 	if (progressive != -1) {
@@ -515,14 +914,62 @@ int main(int argc, char *argv[]) {
 						file2, mode, printReads, subtractFilter);
 			}
 		}
+	} else if (maxMem > 0
+			&& filterSize / 8
+					+ (subtractFilter.empty() ?
+							0 :
+							FusedSubtractFilter::fileFilterSize(subtractFilter)
+									/ 8) > size_t(maxMem * (1 << 30))) {
+		redundNum = filterGen.generateExternal(
+				outputDir + filterPrefix + ".bf", subtractFilter,
+				size_t(maxMem * (1 << 30)),
+				(tmpDir.empty() ? outputDir : tmpDir) + filterPrefix);
 	} else if (!subtractFilter.empty()) {
 		redundNum = filterGen.generate(outputDir + filterPrefix + ".bf",
 				subtractFilter);
 	} else {
 		redundNum = filterGen.generate(outputDir + filterPrefix + ".bf");
 	}
+	if (singlePass) {
+		//fold to the size for the number of k-mers actually inserted
+		size_t entries = max(filterGen.getTotalEntries(), size_t(1));
+		size_t neededSize = BloomFilterInfo::calcOptimalSize(entries, opt::fpr,
+				opt::hashNum);
+		if (neededSize > filterSize) {
+			cerr << "Warning: The files hold more k-mers than estimated, so"
+					<< " the false positive rate is higher than requested. Set"
+					<< " the number of k-mers with -n." << endl;
+		}
+		filterSize = BloomFilterGenerator::foldFilter(
+				outputDir + filterPrefix + ".bf", neededSize);
+		cerr << "Folded filter to " << filterSize << " bits" << endl;
+		info = BloomFilterInfo(filterPrefix, opt::kmerSize, opt::hashNum,
+				opt::fpr, entries, inputFiles);
+		info.setSyncmerSize(opt::syncmerSize);
+		info.setFilterSize(filterSize);
+		if (distinctEstimate > 0) {
+			info.setDistinctEstimate(distinctEstimate, distinctError);
+		}
+		if (prescreenRate > 0) {
+			entries = max(filterGen.getPrescreenEntries(), size_t(1));
+			prescreenSize = BloomFilterGenerator::foldFilter(
+					outputDir + filterPrefix + "_prescreen.bf",
+					BloomFilterInfo::calcOptimalSize(entries, opt::fpr,
+							opt::hashNum));
+			prescreenInfo = BloomFilterInfo(filterPrefix + "_prescreen",
+					opt::kmerSize, opt::hashNum, opt::fpr, entries,
+					inputFiles);
+			prescreenInfo.setSampleRate(prescreenRate);
+			prescreenInfo.setFilterSize(prescreenSize);
+		}
+	}
 	info.setTotalNum(filterGen.getTotalEntries());
 	info.setRedundancy(redundNum);
+	if (singlePass) {
+		//the header still holds the stats of the unfolded filter
+		MappedFilter(outputDir + filterPrefix + ".bf").setStats(info.getFPR(),
+				filterGen.getTotalEntries());
+	}
 
 	//code for redundancy checking
 	//calculate redundancy rate
@@ -541,6 +988,17 @@ int main(int argc, char *argv[]) {
 
 	//output info
 	info.printInfoFile(outputDir + filterPrefix + ".txt");
+	if (prescreenRate > 0) {
+		prescreenInfo.setTotalNum(max(filterGen.getPrescreenEntries(),
+				size_t(1)));
+		prescreenInfo.setRedundancy(0);
+		if (singlePass) {
+			MappedFilter(outputDir + filterPrefix + "_prescreen.bf").setStats(
+					prescreenInfo.getFPR(), filterGen.getPrescreenEntries());
+		}
+		prescreenInfo.printInfoFile(
+				outputDir + filterPrefix + "_prescreen.txt");
+	}
 	cerr << "Filter Creation Complete." << endl;
 
 	return 0;
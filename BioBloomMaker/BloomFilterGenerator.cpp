@@ -19,6 +19,21 @@
 #include <cmath>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/lexical_cast.hpp>
+#include <limits>
+#include <sys/stat.h>
+
+//upper bound on the compression ratio of gzipped sequence files
+static const size_t s_maxGzipRatio = 5;
+//64-bit words of a filter read at once when folding it
+static const size_t s_foldBlockWords = 1 << 23;
+//read pairs evaluated together in deterministic progressive builds
+static const size_t s_recruitBatchSize = 8192;
+//memory for the bucket buffers of all threads, as a fraction of --max_mem,
+//and the smallest buffer for one bucket of a thread
+static const size_t s_bucketBufferFraction = 4;
+static const size_t s_minBucketBuffer = 1024;
+//largest region, so offsets within it fit in 32 bits
+static const size_t s_maxRegionBytes = size_t(1) << 29;
 
 /*
  * Constructor:
@@ -28,7 +43,12 @@
 BloomFilterGenerator::BloomFilterGenerator(vector<string> const &filenames,
 		unsigned kmerSize, unsigned hashNum) :
 		m_fileNames(filenames), m_kmerSize(kmerSize), m_hashNum(hashNum), m_expectedEntries(
-				0), m_filterSize(0), m_totalEntries(0) {
+				0), m_distinctEstimate(0), m_distinctError(0), m_filterSize(0), m_totalEntries(
+				0), m_fused(NULL), m_prescreen(NULL), m_mappedPrescreen(NULL), m_prescreenRate(0), m_prescreenSize(
+				0), m_prescreenEntries(0), m_evalRead(
+				SeqEval::readEvaluator<BloomFilter>(false)), m_evalReadSub(
+				SeqEval::readEvaluator<BloomFilter>(true)), m_evalFused(
+				SeqEval::readEvaluator<FusedSubtractFilter>(false)) {
 	m_expectedEntries = calcExpectedEntries();
 }
 
@@ -41,7 +61,12 @@ BloomFilterGenerator::BloomFilterGenerator(vector<string> const &filenames,
 BloomFilterGenerator::BloomFilterGenerator(vector<string> const &filenames,
 		unsigned kmerSize, unsigned hashNum, size_t numElements) :
 		m_fileNames(filenames), m_kmerSize(kmerSize), m_hashNum(hashNum), m_expectedEntries(
-				numElements), m_filterSize(0), m_totalEntries(0) {
+				numElements), m_distinctEstimate(0), m_distinctError(0), m_filterSize(
+				0), m_totalEntries(0), m_fused(NULL), m_prescreen(
+				NULL), m_mappedPrescreen(NULL), m_prescreenRate(0), m_prescreenSize(0), m_prescreenEntries(
+				0), m_evalRead(SeqEval::readEvaluator<BloomFilter>(false)), m_evalReadSub(
+				SeqEval::readEvaluator<BloomFilter>(true)), m_evalFused(
+				SeqEval::readEvaluator<FusedSubtractFilter>(false)) {
 }
 
 /*
@@ -62,6 +87,8 @@ size_t BloomFilterGenerator::generate(const string &filename) {
 	//setup bloom filter
 	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize);
 
+	createPrescreen();
+
 	size_t redundancy = 0;
 	redundancy += loadFilter(filter, m_totalEntries);
 	cerr
@@ -69,6 +96,7 @@ size_t BloomFilterGenerator::generate(const string &filename) {
 			<< m_totalEntries << endl;
 
 	filter.storeFilter(filename);
+	storePrescreen(filename);
 	return redundancy;
 }
 
@@ -92,186 +120,265 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	//need the filter to be greater than the size of the number of expected entries
 	assert(m_filterSize > m_expectedEntries);
 
+	//continue from last checkpoint if requested
+	vector<string> inputFiles(m_fileNames);
+	inputFiles.push_back(file1);
+	inputFiles.push_back(file2);
+	Checkpoint ckpt(filename.substr(0, filename.length() - 3));
+	bool resumed = opt::resume && ckpt.load();
+
 	//setup bloom filter
-	BloomFilter filter(m_filterSize, m_hashNum, m_kmerSize);
+	BloomFilter *filterPtr =
+			resumed ?
+					new BloomFilter(ckpt.getPrefix() + "_checkpoint.bf") :
+					new BloomFilter(m_filterSize, m_hashNum, m_kmerSize);
+	BloomFilter &filter = *filterPtr;
 
 	BloomFilter* filterSub = NULL;
 
 	if (subtractFilter != "") {
 		filterSub = new BloomFilter(subtractFilter);
 		checkFilters(filter, *filterSub);
+		if (opt::fuseSubtract) {
+			m_fused = new FusedSubtractFilter(filter, subtractFilter,
+					resumed ? ckpt.getPrefix() + "_checkpoint.bf" : "");
+		}
 	}
 	//for each file loop over all headers and obtain seq
 	//load input file + make filter
 	size_t redundancy = 0;
-
-	if (opt::noRep && filterSub != NULL) {
-		redundancy += loadFilterSubtract(filter, *filterSub, m_totalEntries);
+	size_t totalReads = 0;
+	size_t taggedReads = 0;
+	unsigned startItr = 0;
+	size_t startRead = 0;
+
+	if (resumed) {
+		if (ckpt.getList<string>("input_files") != inputFiles
+				|| filter.getFilterSize() != m_filterSize) {
+			cerr << "Error: Checkpoint " << ckpt.getFileName()
+					<< " was created with different inputs or filter size."
+					<< endl;
+			exit(1);
+		}
+		startItr = ckpt.get<unsigned>("iteration");
+		startRead = ckpt.get<size_t>("pair_reads");
+		totalReads = ckpt.get<size_t>("total_reads");
+		taggedReads = ckpt.get<size_t>("tagged_reads");
+		redundancy = ckpt.get<size_t>("redundancy");
+		m_totalEntries = ckpt.get<size_t>("total_entries");
+		cerr << "Resuming from checkpoint at iteration " << startItr + 1
+				<< " read " << startRead << endl;
 	} else {
-		redundancy += loadFilter(filter, m_totalEntries);
+		if (opt::noRep && filterSub != NULL) {
+			redundancy += loadFilterSubtract(filter, *filterSub,
+					m_totalEntries);
+		} else {
+			redundancy += loadFilter(filter, m_totalEntries);
+		}
+		cerr
+				<< "Approximated (due to false positives) total unique k-mers in reference files "
+				<< m_totalEntries << endl;
 	}
-	cerr
-			<< "Approximated (due to false positives) total unique k-mers in reference files "
-			<< m_totalEntries << endl;
 
-	size_t totalReads = 0;
-	size_t taggedReads = 0;
-	for (unsigned i = 0; i < opt::progItrns; ++i) {
+	//later iterations read the pairs not recruited from a spill file, so a
+	//pair is recruited, printed and counted in one iteration at most
+	const bool spill = opt::progItrns > 1 && !opt::checkpoint && !resumed;
+	ReadSpillReader *spillIn = NULL;
+	ReadSpillWriter *spillOut = NULL;
+	for (unsigned i = startItr; i < opt::progItrns; ++i) {
 		cerr << "Iteration " << i + 1 << endl;
 
-		gzFile fp1;
-		gzFile fp2;
-
-		fp1 = gzopen(file1.c_str(), "r");
-		if (fp1 == Z_NULL) {
+		gzFile fp1 = NULL;
+		gzFile fp2 = NULL;
+		kseq_t *seq1 = NULL;
+		kseq_t *seq2 = NULL;
+		if (spillIn == NULL) {
+			fp1 = gzopen(file1.c_str(), "r");
+			if (fp1 == Z_NULL) {
 #pragma omp critical(cerr)
-			cerr << "file " << file1.c_str() << " cannot be opened" << endl;
-			exit(1);
-		} else {
+				cerr << "file " << file1.c_str() << " cannot be opened" << endl;
+				exit(1);
+			} else {
 #pragma omp critical(cerr)
-			cerr << "Reading file " << file1.c_str() << endl;
-		}
-		fp2 = gzopen(file2.c_str(), "r");
-		if (fp2 == Z_NULL) {
+				cerr << "Reading file " << file1.c_str() << endl;
+			}
+			fp2 = gzopen(file2.c_str(), "r");
+			if (fp2 == Z_NULL) {
 #pragma omp critical(cerr)
-			cerr << "file " << file2.c_str() << " cannot be opened" << endl;
-			exit(1);
-		} else {
+				cerr << "file " << file2.c_str() << " cannot be opened" << endl;
+				exit(1);
+			} else {
 #pragma omp critical(cerr)
-			cerr << "Reading file " << file2.c_str() << endl;
+				cerr << "Reading file " << file2.c_str() << endl;
+			}
+			seq1 = kseq_init(fp1);
+			seq2 = kseq_init(fp2);
+		} else {
+			cerr << "Reading reads not yet recruited" << endl;
+		}
+		if (spill && i + 1 < opt::progItrns) {
+			spillOut = new ReadSpillWriter(spillName(filename, i), printReads);
 		}
-		kseq_t *seq1 = kseq_init(fp1);
-		kseq_t *seq2 = kseq_init(fp2);
 		int l1;
 		FqRec rec1;
 		int l2;
 		FqRec rec2;
+		size_t pairReads = 0;
+		if (spillIn == NULL) {
+			pairReads = skipReads(seq1, i == startItr ? startRead : 0);
+			skipReads(seq2, i == startItr ? startRead : 0);
+		}
+		for (bool eof = false; !eof && m_totalEntries < m_expectedEntries;) {
+			//stop at the next checkpoint so all threads are idle when it is saved
+			size_t batchEnd =
+					opt::checkpoint ?
+							pairReads + opt::checkpoint :
+							numeric_limits<size_t>::max();
+			if (opt::deterministic) {
+				eof = recruitBatches(seq1, seq2, spillIn, spillOut, filter,
+						filterSub, score, mode, printReads, batchEnd,
+						pairReads, totalReads, taggedReads);
+			} else
 #pragma omp parallel private(l1, l2, rec1, rec2)
-		for (;;) {
+			for (;;) {
 #pragma omp critical(kseq_read)
-			{
-				l1 = kseq_read(seq1);
-				if (l1 >= 0) {
-					rec1.seq = string(seq1->seq.s, l1);
-					rec1.header = string(seq1->name.s, seq1->name.l);
-					rec1.qual = string(seq1->qual.s, seq1->qual.l);
-				}
-				l2 = kseq_read(seq2);
-				if (l2 >= 0) {
-					rec2.seq = string(seq2->seq.s, l2);
-					rec2.header = string(seq2->name.s, seq2->name.l);
-					rec2.qual = string(seq2->qual.s, seq2->qual.l);
-				}
-				if (l1 >= 0 && l2 >= 0) {
-					++totalReads;
-					if (totalReads % opt::fileInterval == 0) {
-						cerr << "Currently Reading Read Number: " << totalReads
-								<< "\tUnique k-mers Added: " << m_totalEntries
-								<< "\tReads Used in Tagging: " << taggedReads
-								<< endl;
+				{
+					l1 = l2 = -1;
+					if (pairReads < batchEnd) {
+						readPair(seq1, seq2, spillIn, rec1, rec2, l1, l2);
+						if (l1 >= 0 && l2 >= 0) {
+							++pairReads;
+							++totalReads;
+							if (totalReads % opt::fileInterval == 0) {
+								cerr << "Currently Reading Read Number: "
+										<< totalReads
+										<< "\tUnique k-mers Added: "
+										<< m_totalEntries
+										<< "\tReads Used in Tagging: "
+										<< taggedReads << endl;
+							}
+						} else {
+							eof = true;
+						}
 					}
 				}
-			}
 
-			if (l1 >= 0 && l2 >= 0 && m_totalEntries < m_expectedEntries) {
-				size_t numKmers1 =
-						rec1.seq.length() > m_kmerSize ?
-								l1 - m_kmerSize + 1 : 0;
-				size_t numKmers2 =
-						rec2.seq.length() > m_kmerSize ?
-								l2 - m_kmerSize + 1 : 0;
-				switch (mode) {
-				case PROG_INC: {
-					if (numKmers1 > score
-							&& (SeqEval::evalRead(rec1.seq, filter, score,
-									filterSub))) {
+				if (l1 >= 0 && l2 >= 0 && m_totalEntries < m_expectedEntries) {
+					bool tagged = false;
+					size_t numKmers1 =
+							rec1.seq.length() > m_kmerSize ?
+									l1 - m_kmerSize + 1 : 0;
+					size_t numKmers2 =
+							rec2.seq.length() > m_kmerSize ?
+									l2 - m_kmerSize + 1 : 0;
+					switch (mode) {
+					case PROG_INC: {
+						if (numKmers1 > score
+								&& (evalRead(rec1.seq, filter, score,
+										filterSub))) {
 #pragma omp atomic
-						++taggedReads;
-						if (printReads) {
-							unsigned taggedKmers1 = loadFilter(filter,
-									rec1.seq);
-							unsigned taggedKmers2 = loadFilter(filter,
-									rec2.seq);
-							unsigned repCount1 = checkFilter(filterSub,
-									rec1.seq);
-							unsigned repCount2 = checkFilter(filterSub,
-									rec2.seq);
+							++taggedReads;
+							tagged = true;
+							if (printReads) {
+								unsigned taggedKmers1 = loadFilter(filter,
+										rec1.seq);
+								unsigned taggedKmers2 = loadFilter(filter,
+										rec2.seq);
+								unsigned repCount1 = checkFilter(filterSub,
+										rec1.seq);
+								unsigned repCount2 = checkFilter(filterSub,
+										rec2.seq);
 #pragma omp critical(debugPrint)
-							{
-								printDebug(rec1, taggedKmers1, repCount1,
-										taggedReads, totalReads);
-								printDebug(rec2, taggedKmers2, repCount2,
-										taggedReads, totalReads);
+								{
+									printDebug(rec1, taggedKmers1, repCount1,
+											taggedReads, totalReads);
+									printDebug(rec2, taggedKmers2, repCount2,
+											taggedReads, totalReads);
+								}
+							} else {
+								loadFilter(filter, rec1.seq);
+								loadFilter(filter, rec2.seq);
 							}
-						} else {
-							loadFilter(filter, rec1.seq);
-							loadFilter(filter, rec2.seq);
-						}
-					} else if (numKmers2 > score
-							&& (SeqEval::evalRead(rec2.seq, filter, score,
-									filterSub))) {
+						} else if (numKmers2 > score
+								&& (evalRead(rec2.seq, filter, score,
+										filterSub))) {
 #pragma omp atomic
-						++taggedReads;
-						if (printReads) {
-							unsigned taggedKmers1 = loadFilter(filter,
-									rec1.seq);
-							unsigned taggedKmers2 = loadFilter(filter,
-									rec2.seq);
-							unsigned repCount1 = checkFilter(filterSub,
-									rec1.seq);
-							unsigned repCount2 = checkFilter(filterSub,
-									rec2.seq);
+							++taggedReads;
+							tagged = true;
+							if (printReads) {
+								unsigned taggedKmers1 = loadFilter(filter,
+										rec1.seq);
+								unsigned taggedKmers2 = loadFilter(filter,
+										rec2.seq);
+								unsigned repCount1 = checkFilter(filterSub,
+										rec1.seq);
+								unsigned repCount2 = checkFilter(filterSub,
+										rec2.seq);
 #pragma omp critical(debugPrint)
-							{
-								printDebug(rec1, taggedKmers1, repCount1,
-										taggedReads, totalReads);
-								printDebug(rec2, taggedKmers2, repCount2,
-										taggedReads, totalReads);
+								{
+									printDebug(rec1, taggedKmers1, repCount1,
+											taggedReads, totalReads);
+									printDebug(rec2, taggedKmers2, repCount2,
+											taggedReads, totalReads);
+								}
+							} else {
+								loadFilter(filter, rec1.seq);
+								loadFilter(filter, rec2.seq);
 							}
-						} else {
-							loadFilter(filter, rec1.seq);
-							loadFilter(filter, rec2.seq);
 						}
+						break;
 					}
-					break;
-				}
-				case PROG_STD: {
-					if (SeqEval::evalRead(rec1.seq, filter, score, filterSub)
-							&& SeqEval::evalRead(rec2.seq, filter, score,
-									filterSub)) {
+					case PROG_STD: {
+						if (evalRead(rec1.seq, filter, score, filterSub)
+								&& evalRead(rec2.seq, filter, score,
+										filterSub)) {
 #pragma omp atomic
-						++taggedReads;
-						if (printReads) {
-							unsigned taggedKmers1 = loadFilter(filter,
-									rec1.seq);
-							unsigned taggedKmers2 = loadFilter(filter,
-									rec2.seq);
-							unsigned repCount1 = checkFilter(filterSub,
-									rec1.seq);
-							unsigned repCount2 = checkFilter(filterSub,
-									rec2.seq);
+							++taggedReads;
+							tagged = true;
+							if (printReads) {
+								unsigned taggedKmers1 = loadFilter(filter,
+										rec1.seq);
+								unsigned taggedKmers2 = loadFilter(filter,
+										rec2.seq);
+								unsigned repCount1 = checkFilter(filterSub,
+										rec1.seq);
+								unsigned repCount2 = checkFilter(filterSub,
+										rec2.seq);
 #pragma omp critical(debugPrint)
-							{
-								printDebug(rec1, taggedKmers1, repCount1,
-										taggedReads, totalReads);
-								printDebug(rec2, taggedKmers2, repCount2,
-										taggedReads, totalReads);
+								{
+									printDebug(rec1, taggedKmers1, repCount1,
+											taggedReads, totalReads);
+									printDebug(rec2, taggedKmers2, repCount2,
+											taggedReads, totalReads);
+								}
+							} else {
+								loadFilter(filter, rec1.seq);
+								loadFilter(filter, rec2.seq);
 							}
-						} else {
-							loadFilter(filter, rec1.seq);
-							loadFilter(filter, rec2.seq);
 						}
+						break;
+					}
+					}
+					if (!tagged && spillOut != NULL) {
+						spillOut->writePair(rec1.header, rec1.seq, rec1.qual,
+								rec2.header, rec2.seq, rec2.qual);
 					}
-					break;
-				}
-				}
 			} else
-				break;
+					break;
+			}
+			if (opt::checkpoint) {
+				saveCheckpoint(ckpt, filter, inputFiles,
+						eof ? i + 1 : i, eof ? 0 : pairReads, totalReads,
+						taggedReads, redundancy);
+			}
 		}
-		kseq_destroy(seq1);
-		kseq_destroy(seq2);
-		gzclose(fp1);
-		gzclose(fp2);
+		if (seq1 != NULL) {
+			kseq_destroy(seq1);
+			kseq_destroy(seq2);
+			gzclose(fp1);
+			gzclose(fp2);
+		}
+		nextSpill(filename, i, printReads, spillIn, spillOut);
 	}
 	if (m_totalEntries >= m_expectedEntries) {
 		cerr << "K-mer threshold reached at read " << totalReads << endl;
@@ -281,9 +388,14 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	}
 
 	filter.storeFilter(filename);
+	delete (filterPtr);
+	delete m_fused;
+	m_fused = NULL;
 	if (filterSub != NULL) {
 		delete (filterSub);
 	}
+	ckpt.remove();
+	remove((ckpt.getPrefix() + "_checkpoint.bf").c_str());
 	return redundancy;
 }
 
@@ -297,6 +409,106 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
  *
  * Outputs to fileName path
  */
+
+/*
+ * Recruits read pairs until batchEnd pairs are read or the k-mer threshold is
+ * reached, with the same result for any number of threads: the pairs
+ * recruited are those recruited when pairs are evaluated one at a time in
+ * input order. Returns true at the end of the reads.
+ *
+ * Pairs in a batch are evaluated in parallel against the filter as it was
+ * before the batch, recording for each k-mer not found a bit that is not set
+ * (its witness). Recruited pairs are then inserted in input order. Inserting
+ * k-mers can make a pair match or stop matching (e.g. a new hit can make a
+ * later miss skip ahead when scoring with -a), but only if one of its
+ * witnesses is set. The bits of inserted k-mers are kept, and once a pair
+ * reached in input order has a witness among them, it and the later pairs
+ * with one are evaluated again, in parallel, against the current filter.
+ */
+bool BloomFilterGenerator::recruitBatches(kseq_t *seq1, kseq_t *seq2,
+		ReadSpillReader *spillIn, ReadSpillWriter *spillOut,
+		BloomFilter &filter, BloomFilter *filterSub, double score,
+		createMode mode, bool printReads, size_t batchEnd, size_t &pairReads,
+		size_t &totalReads, size_t &taggedReads) {
+	vector<FqRec> recs1(s_recruitBatchSize);
+	vector<FqRec> recs2(s_recruitBatchSize);
+	vector<vector<uint64_t> > witnesses(s_recruitBatchSize);
+	vector<unsigned char> recruited;
+	//bits set since the pairs not yet inserted were evaluated
+	vector<uint64_t> setPositions;
+	boost::unordered_set<uint64_t> setBits;
+	while (m_totalEntries < m_expectedEntries) {
+		const size_t batchStart = totalReads;
+		long count = 0;
+		bool eof = false;
+		for (; count < long(s_recruitBatchSize) && pairReads < batchEnd;
+				++count) {
+			int l1, l2;
+			readPair(seq1, seq2, spillIn, recs1[count], recs2[count], l1, l2);
+			if (l1 < 0 || l2 < 0) {
+				eof = true;
+				break;
+			}
+			++pairReads;
+			if (++totalReads % opt::fileInterval == 0) {
+				cerr << "Currently Reading Read Number: " << totalReads
+						<< "\tUnique k-mers Added: " << m_totalEntries
+						<< "\tReads Used in Tagging: " << taggedReads << endl;
+			}
+		}
+		recruited.resize(count);
+		//evaluates a pair against the current filter
+		auto evaluate = [&](long i) {
+			recruited[i] = isRecruited(recs1[i], recs2[i], filter, filterSub,
+					score, mode);
+			witnesses[i].clear();
+			addWitnesses(recs1[i].seq, filter, witnesses[i]);
+			addWitnesses(recs2[i].seq, filter, witnesses[i]);
+		};
+#pragma omp parallel for schedule(dynamic, 64)
+		for (long i = 0; i < count; ++i) {
+			evaluate(i);
+		}
+		setBits.clear();
+		for (long j = 0; j < count && m_totalEntries < m_expectedEntries;
+				++j) {
+			if (hasSetWitness(witnesses[j], setBits)) {
+#pragma omp parallel for schedule(dynamic, 64)
+				for (long i = j; i < count; ++i) {
+					if (hasSetWitness(witnesses[i], setBits)) {
+						evaluate(i);
+					}
+				}
+				setBits.clear();
+			}
+			if (recruited[j]) {
+				++taggedReads;
+				setPositions.clear();
+				insertPair(filter, filterSub, recs1[j], recs2[j], printReads,
+						taggedReads, batchStart + j + 1, &setPositions);
+				setBits.insert(setPositions.begin(), setPositions.end());
+			}
+		}
+		if (spillOut != NULL) {
+			for (long j = 0; j < count; ++j) {
+				if (!recruited[j]) {
+					spillOut->writePair(recs1[j].header, recs1[j].seq,
+							recs1[j].qual, recs2[j].header, recs2[j].seq,
+							recs2[j].qual);
+				}
+			}
+		}
+		if (eof) {
+			return true;
+		}
+		if (pairReads >= batchEnd) {
+			return false;
+		}
+	}
+	return false;
+}
+
+
 size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 		double score, const string &file1, const string &file2, createMode mode,
 		bool printReads, const string &subtractFilter) {
@@ -315,6 +527,9 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 	if (subtractFilter != "") {
 		filterSub = new BloomFilter(subtractFilter);
 		checkFilters(filter, *filterSub);
+		if (opt::fuseSubtract) {
+			m_fused = new FusedSubtractFilter(filter, subtractFilter);
+		}
 	}
 
 	size_t baitFilterElements = calcExpectedEntries();
@@ -342,32 +557,45 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 
 	size_t totalReads = 0;
 	size_t taggedReads = 0;
+	//later iterations read the pairs not recruited from a spill file, so a
+	//pair is recruited, printed and counted in one iteration at most
+	const bool spill = opt::progItrns > 1 && !opt::checkpoint;
+	ReadSpillReader *spillIn = NULL;
+	ReadSpillWriter *spillOut = NULL;
 	for (unsigned i = 0; i < opt::progItrns; ++i) {
 		cerr << "Iteration " << i + 1 << endl;
 
-		gzFile fp1;
-		gzFile fp2;
-
-		fp1 = gzopen(file1.c_str(), "r");
-		if (fp1 == Z_NULL) {
+		gzFile fp1 = NULL;
+		gzFile fp2 = NULL;
+		kseq_t *seq1 = NULL;
+		kseq_t *seq2 = NULL;
+		if (spillIn == NULL) {
+			fp1 = gzopen(file1.c_str(), "r");
+			if (fp1 == Z_NULL) {
 #pragma omp critical(cerr)
-			cerr << "file " << file1.c_str() << " cannot be opened" << endl;
-			exit(1);
-		} else {
+				cerr << "file " << file1.c_str() << " cannot be opened" << endl;
+				exit(1);
+			} else {
 #pragma omp critical(cerr)
-			cerr << "Reading file " << file1.c_str() << endl;
-		}
-		fp2 = gzopen(file2.c_str(), "r");
-		if (fp2 == Z_NULL) {
+				cerr << "Reading file " << file1.c_str() << endl;
+			}
+			fp2 = gzopen(file2.c_str(), "r");
+			if (fp2 == Z_NULL) {
 #pragma omp critical(cerr)
-			cerr << "file " << file2.c_str() << " cannot be opened" << endl;
-			exit(1);
-		} else {
+				cerr << "file " << file2.c_str() << " cannot be opened" << endl;
+				exit(1);
+			} else {
 #pragma omp critical(cerr)
-			cerr << "Reading file " << file2.c_str() << endl;
+				cerr << "Reading file " << file2.c_str() << endl;
+			}
+			seq1 = kseq_init(fp1);
+			seq2 = kseq_init(fp2);
+		} else {
+			cerr << "Reading reads not yet recruited" << endl;
+		}
+		if (spill && i + 1 < opt::progItrns) {
+			spillOut = new ReadSpillWriter(spillName(filename, i), printReads);
 		}
-		kseq_t *seq1 = kseq_init(fp1);
-		kseq_t *seq2 = kseq_init(fp2);
 		int l1;
 		FqRec rec1;
 		int l2;
@@ -376,18 +604,7 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 		for (;;) {
 #pragma omp critical(kseq_read)
 			{
-				l1 = kseq_read(seq1);
-				if (l1 >= 0) {
-					rec1.seq = string(seq1->seq.s, l1);
-					rec1.header = string(seq1->name.s, seq1->name.l);
-					rec1.qual = string(seq1->qual.s, seq1->qual.l);
-				}
-				l2 = kseq_read(seq2);
-				if (l2 >= 0) {
-					rec2.seq = string(seq2->seq.s, l2);
-					rec2.header = string(seq2->name.s, seq2->name.l);
-					rec2.qual = string(seq2->qual.s, seq2->qual.l);
-				}
+				readPair(seq1, seq2, spillIn, rec1, rec2, l1, l2);
 				if (l1 >= 0 && l2 >= 0) {
 					++totalReads;
 					if (totalReads % opt::fileInterval == 0) {
@@ -400,6 +617,7 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 			}
 
 			if (l1 >= 0 && l2 >= 0 && m_totalEntries < m_expectedEntries) {
+				bool tagged = false;
 				size_t numKmers1 =
 						rec1.seq.length() > m_kmerSize ?
 								l1 - m_kmerSize + 1 : 0;
@@ -409,12 +627,13 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 				switch (mode) {
 				case PROG_INC: {
 					if (numKmers1 > score
-							&& (SeqEval::evalRead(rec1.seq, filter, score,
+							&& (evalRead(rec1.seq, filter, score,
 									filterSub)
-									|| SeqEval::evalRead(rec1.seq, baitFilter,
+									|| evalBait(rec1.seq, baitFilter,
 											opt::baitThreshold, filterSub))) {
 #pragma omp atomic
 						++taggedReads;
+						tagged = true;
 						if (printReads) {
 							unsigned taggedKmers1 = loadFilter(filter,
 									rec1.seq);
@@ -436,12 +655,13 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 							loadFilter(filter, rec2.seq);
 						}
 					} else if (numKmers2 > score
-							&& (SeqEval::evalRead(rec2.seq, filter, score,
+							&& (evalRead(rec2.seq, filter, score,
 									filterSub)
-									|| SeqEval::evalRead(rec2.seq, baitFilter,
+									|| evalBait(rec2.seq, baitFilter,
 											opt::baitThreshold, filterSub))) {
 #pragma omp atomic
 						++taggedReads;
+						tagged = true;
 						if (printReads) {
 							unsigned taggedKmers1 = loadFilter(filter,
 									rec1.seq);
@@ -466,15 +686,16 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 					break;
 				}
 				case PROG_STD: {
-					if ((SeqEval::evalRead(rec1.seq, filter, score, filterSub)
-							|| SeqEval::evalRead(rec1.seq, baitFilter,
+					if ((evalRead(rec1.seq, filter, score, filterSub)
+							|| evalBait(rec1.seq, baitFilter,
 									opt::baitThreshold, filterSub))
-							&& (SeqEval::evalRead(rec2.seq, filter, score,
+							&& (evalRead(rec2.seq, filter, score,
 									filterSub)
-									|| SeqEval::evalRead(rec2.seq, baitFilter,
+									|| evalBait(rec2.seq, baitFilter,
 											opt::baitThreshold, filterSub))) {
 #pragma omp atomic
 						++taggedReads;
+						tagged = true;
 						if (printReads) {
 							unsigned taggedKmers1 = loadFilter(filter,
 									rec1.seq);
@@ -499,13 +720,20 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 					break;
 				}
 				}
+				if (!tagged && spillOut != NULL) {
+					spillOut->writePair(rec1.header, rec1.seq, rec1.qual,
+							rec2.header, rec2.seq, rec2.qual);
+				}
 			} else
 				break;
 		}
-		kseq_destroy(seq1);
-		kseq_destroy(seq2);
-		gzclose(fp1);
-		gzclose(fp2);
+		if (seq1 != NULL) {
+			kseq_destroy(seq1);
+			kseq_destroy(seq2);
+			gzclose(fp1);
+			gzclose(fp2);
+		}
+		nextSpill(filename, i, printReads, spillIn, spillOut);
 	}
 	if (m_totalEntries >= m_expectedEntries) {
 		cerr << "K-mer threshold reached at read " << totalReads << endl;
@@ -515,6 +743,8 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 	}
 
 	filter.storeFilter(filename);
+	delete m_fused;
+	m_fused = NULL;
 	if (filterSub != NULL) {
 		delete (filterSub);
 	}
@@ -540,6 +770,9 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 	if (subtractFilter != "") {
 		filterSub = new BloomFilter(subtractFilter);
 		checkFilters(filter, *filterSub);
+		if (opt::fuseSubtract) {
+			m_fused = new FusedSubtractFilter(filter, subtractFilter);
+		}
 	}
 
 	size_t baitFilterElements = calcExpectedEntries();
@@ -630,9 +863,9 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 						switch (mode) {
 						case PROG_INC: {
 							if (numKmers1 > score
-									&& (SeqEval::evalRead(seq1->seq.s, filter,
+									&& (evalRead(seq1->seq.s, filter,
 											score, filterSub)
-											|| SeqEval::evalRead(seq1->seq.s,
+											|| evalBait(seq1->seq.s,
 													baitFilter,
 													opt::baitThreshold,
 													filterSub))) {
@@ -672,9 +905,9 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 									loadFilter(filter, seq2->seq.s);
 								}
 							} else if (numKmers2 > score
-									&& (SeqEval::evalRead(seq2->seq.s, filter,
+									&& (evalRead(seq2->seq.s, filter,
 											score, filterSub)
-											|| SeqEval::evalRead(seq2->seq.s,
+											|| evalBait(seq2->seq.s,
 													baitFilter,
 													opt::baitThreshold,
 													filterSub))) {
@@ -717,14 +950,14 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 							break;
 						}
 						case PROG_STD: {
-							if ((SeqEval::evalRead(seq1->seq.s, filter, score,
+							if ((evalRead(seq1->seq.s, filter, score,
 									filterSub)
-									|| SeqEval::evalRead(seq1->seq.s,
+									|| evalBait(seq1->seq.s,
 											baitFilter, opt::baitThreshold,
 											filterSub))
-									&& (SeqEval::evalRead(seq2->seq.s, filter,
+									&& (evalRead(seq2->seq.s, filter,
 											score, filterSub)
-											|| SeqEval::evalRead(seq2->seq.s,
+											|| evalBait(seq2->seq.s,
 													baitFilter,
 													opt::baitThreshold,
 													filterSub))) {
@@ -785,6 +1018,8 @@ size_t BloomFilterGenerator::generateProgressiveBait(const string &filename,
 	}
 
 	filter.storeFilter(filename);
+	delete m_fused;
+	m_fused = NULL;
 	if (filterSub != NULL) {
 		delete (filterSub);
 	}
@@ -810,6 +1045,9 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	if (subtractFilter != "") {
 		filterSub = new BloomFilter(subtractFilter);
 		checkFilters(filter, *filterSub);
+		if (opt::fuseSubtract) {
+			m_fused = new FusedSubtractFilter(filter, subtractFilter);
+		}
 	}
 
 	//for each file loop over all headers and obtain seq
@@ -889,7 +1127,7 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 						switch (mode) {
 						case PROG_INC: {
 							if (numKmers1 > score
-									&& (SeqEval::evalRead(seq1->seq.s, filter,
+									&& (evalRead(seq1->seq.s, filter,
 											score, filterSub))) {
 #pragma omp atomic
 								++taggedReads;
@@ -927,7 +1165,7 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 									loadFilter(filter, seq2->seq.s);
 								}
 							} else if (numKmers2 > score
-									&& (SeqEval::evalRead(seq2->seq.s, filter,
+									&& (evalRead(seq2->seq.s, filter,
 											score, filterSub))) {
 #pragma omp atomic
 								++taggedReads;
@@ -968,9 +1206,9 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 							break;
 						}
 						case PROG_STD: {
-							if (SeqEval::evalRead(seq1->seq.s, filter, score,
+							if (evalRead(seq1->seq.s, filter, score,
 									filterSub)
-									&& SeqEval::evalRead(seq2->seq.s, filter,
+									&& evalRead(seq2->seq.s, filter,
 											score, filterSub)) {
 #pragma omp atomic
 								++taggedReads;
@@ -1029,6 +1267,8 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	}
 
 	filter.storeFilter(filename);
+	delete m_fused;
+	m_fused = NULL;
 	if (filterSub != NULL) {
 		delete (filterSub);
 	}
@@ -1053,6 +1293,9 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	if (subtractFilter != "") {
 		filterSub = new BloomFilter(subtractFilter);
 		checkFilters(filter, *filterSub);
+		if (opt::fuseSubtract) {
+			m_fused = new FusedSubtractFilter(filter, subtractFilter);
+		}
 	}
 
 	size_t baitFilterElements = calcExpectedEntries();
@@ -1119,7 +1362,7 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 								seq->seq.l > m_kmerSize ?
 										seq->seq.l - m_kmerSize + 1 : 0;
 						if (numKmers > score
-								&& (SeqEval::evalRead(seq->seq.s, filter, score,
+								&& (evalRead(seq->seq.s, filter, score,
 										filterSub))) {
 #pragma omp atomic
 							++taggedReads;
@@ -1158,6 +1401,8 @@ size_t BloomFilterGenerator::generateProgressive(const string &filename,
 	}
 
 	filter.storeFilter(filename);
+	delete m_fused;
+	m_fused = NULL;
 	if (filterSub != NULL) {
 		delete (filterSub);
 	}
@@ -1192,17 +1437,308 @@ size_t BloomFilterGenerator::generate(const string &filename,
 	//load other bloomfilter
 	BloomFilter filterSub(subtractFilter);
 
+	createPrescreen();
+
 	size_t redundancy = loadFilterSubtract(filter, filterSub, m_totalEntries);
 
 	filter.storeFilter(filename);
+	storePrescreen(filename);
 	return redundancy;
 }
 
+/*
+ * Estimates the number of distinct k-mers of the files not already in filter,
+ * which is the number that --append would add. Only the syncmers are counted
+ * if the filter holds syncmers.
+ */
+size_t BloomFilterGenerator::estimateNewEntries(const MappedFilter &filter) {
+	checkAppendFilter(filter);
+	HyperLogLog distinct;
+	for (unsigned i = 0; i < m_fileNames.size(); ++i) {
+		gzFile fp = gzopen(m_fileNames[i].c_str(), "r");
+		if (fp == Z_NULL) {
+			cerr << "file " << m_fileNames[i] << " cannot be opened" << endl;
+			exit(1);
+		}
+		kseq_t *seq = kseq_init(fp);
+		ChunkedSeqReader reader(seq, m_kmerSize);
+#pragma omp parallel
+		{
+			vector<string> buffers;
+			vector<uint64_t> hashes(size_t(KmerLoader::s_hashBatch) * m_hashNum);
+			HyperLogLog localDistinct;
+			for (;;) {
+				unsigned count;
+#pragma omp critical(kseq_read)
+				count = KmerLoader::readBatch(reader, buffers);
+				if (count == 0) {
+					break;
+				}
+				for (unsigned j = 0; j < count; ++j) {
+					KmerLoader::hashBatches(buffers[j], m_kmerSize, m_hashNum,
+							opt::syncmerSize, hashes,
+							[&](const uint64_t *batch, unsigned batched) {
+								for (unsigned k = 0; k < batched; ++k) {
+									const uint64_t *kmerHashes =
+											&batch[k * m_hashNum];
+									if (!filter.contains(kmerHashes)) {
+										localDistinct.add(kmerHashes[0]);
+									}
+								}
+							});
+				}
+			}
+#pragma omp critical(distinct)
+			distinct.merge(localDistinct);
+		}
+		kseq_destroy(seq);
+		gzclose(fp);
+	}
+	return size_t(distinct.estimate() + 0.5);
+}
+
+/*
+ * Inserts the k-mers of the files into the existing filter, setting its bits
+ * in place. If a prescreen rate was set (setPrescreen), the sampled k-mers
+ * are also inserted into prescreen. Returns the m_redundancy of the inserted
+ * k-mers.
+ */
+size_t BloomFilterGenerator::append(MappedFilter &filter,
+		MappedFilter *prescreen) {
+	checkAppendFilter(filter);
+	if (prescreen != NULL) {
+		checkAppendFilter(*prescreen);
+		m_mappedPrescreen = prescreen;
+	}
+
+	size_t redundancy = loadFilter(filter, m_totalEntries);
+	cerr
+			<< "Approximated (due to false positives) new unique k-mers in reference files "
+			<< m_totalEntries << endl;
+	m_mappedPrescreen = NULL;
+	return redundancy;
+}
+
+/*
+ * Generates a bloom filter outputting it to a filename, using at most
+ * maxMemBytes for a region of it, the bucket buffers and the subtract filter
+ * (--max_mem). The bit positions of every k-mer are written to bucket files
+ * by filter region, then the bits of each region are set from its bucket and
+ * written out in turn. The bits are the same as those of generate(). Bucket
+ * files are named from tmpPrefix.
+ *
+ * As the k-mers that set each bit are not known once they are bucketed, the
+ * number of entries is estimated from the bits set. Returns the number of
+ * k-mers not counted as entries.
+ */
+size_t BloomFilterGenerator::generateExternal(const string &filename,
+		const string &subtractFilter, size_t maxMemBytes,
+		const string &tmpPrefix) {
+
+	//need the number of hash functions used to be greater than 0
+	assert(m_hashNum > 0);
+
+	//regions are written as 64-bit words
+	assert(m_filterSize % 64 == 0);
+
+	size_t subtractBytes = 0;
+	if (!subtractFilter.empty()) {
+		subtractBytes = FusedSubtractFilter::fileFilterSize(subtractFilter)
+				/ 8;
+	}
+
+	unsigned threads = 1;
+#if defined(_OPENMP)
+	threads = omp_get_max_threads();
+#endif
+	//the buffers take a share of the memory, but at least s_minBucketBuffer
+	//offsets for each region and thread, and regions get what is left
+	size_t bufferBytes = maxMemBytes / s_bucketBufferFraction;
+	size_t regionBytes = 0;
+	size_t regions = 0;
+	for (;;) {
+		if (bufferBytes + subtractBytes >= maxMemBytes) {
+			cerr << "Error: --max_mem is too small to hold the subtract filter"
+					<< " (" << subtractBytes << " bytes) and the bucket buffers ("
+					<< bufferBytes << " bytes)" << endl;
+			exit(1);
+		}
+		regionBytes = min(maxMemBytes - bufferBytes - subtractBytes,
+				s_maxRegionBytes);
+		regionBytes = max(regionBytes - regionBytes % 8, size_t(8));
+		regions = (m_filterSize / 8 + regionBytes - 1) / regionBytes;
+		size_t minBufferBytes = s_minBucketBuffer * sizeof(uint32_t) * threads
+				* regions;
+		if (minBufferBytes <= bufferBytes) {
+			break;
+		}
+		bufferBytes = minBufferBytes;
+	}
+	size_t bufferEntries = bufferBytes
+			/ (threads * regions * sizeof(uint32_t));
+	PositionBuckets buckets(tmpPrefix, m_filterSize, regionBytes * 8,
+			bufferEntries);
+	cerr << "Building filter in " << buckets.getRegions() << " regions of "
+			<< buckets.getRegionBits(0) / 8 << " bytes, with "
+			<< bufferEntries * threads * buckets.getRegions() * sizeof(uint32_t)
+			<< " bytes of bucket buffers" << endl;
+
+	BloomFilter *filterSub = NULL;
+	if (!subtractFilter.empty()) {
+		filterSub = new BloomFilter(subtractFilter);
+		checkFilters(BloomFilter(64, m_hashNum, m_kmerSize), *filterSub);
+	}
+
+	size_t kmerRemoved = 0;
+	size_t kmers = hashToBuckets(buckets, filterSub, kmerRemoved);
+	delete filterSub;
+	if (!subtractFilter.empty()) {
+		cerr << "Total Number of K-mers not added: " << kmerRemoved << endl;
+	}
+
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		cerr << "Error: Could not open " << filename << endl;
+		exit(1);
+	}
+	writeHeader(file, filename);
+	size_t popcount = 0;
+	for (size_t i = 0; i < buckets.getRegions(); ++i) {
+		vector<uint64_t> words(buckets.getRegionBits(i) / 64, 0);
+		buckets.fill(i, words);
+		for (size_t j = 0; j < words.size(); ++j) {
+			popcount += __builtin_popcountll(words[j]);
+		}
+		if (fwrite(words.data(), sizeof(uint64_t), words.size(), file)
+				!= words.size()) {
+			cerr << "Error: Could not write to " << filename << endl;
+			exit(1);
+		}
+		if (opt::verbose) {
+			cerr << "Wrote region " << i + 1 << " of " << buckets.getRegions()
+					<< endl;
+		}
+	}
+	if (fclose(file) != 0) {
+		cerr << "Error: Could not write to " << filename << endl;
+		exit(1);
+	}
+
+	m_totalEntries =
+			popcount < m_filterSize ?
+					BloomFilterInfo::calcEntriesFromPop(m_filterSize,
+							popcount, m_hashNum) :
+					kmers;
+	m_totalEntries = max(min(m_totalEntries, kmers), size_t(1));
+	cerr
+			<< "Approximated (from bits set) total unique k-mers in reference files "
+			<< m_totalEntries << endl;
+	return kmers - m_totalEntries;
+}
+
+/*
+ * Writes the bit positions of the k-mers of all files, except those in bfsub
+ * if it is not NULL, to the buckets. Returns the number of k-mers written.
+ */
+size_t BloomFilterGenerator::hashToBuckets(PositionBuckets &buckets,
+		const BloomFilter *bfsub, size_t &kmerRemoved) {
+	size_t kmers = 0;
+	for (unsigned i = 0; i < m_fileNames.size(); ++i) {
+		gzFile fp;
+		fp = gzopen(m_fileNames[i].c_str(), "r");
+		if (fp == Z_NULL) {
+			cerr << "file " << m_fileNames[i] << " cannot be opened" << endl;
+			exit(1);
+		}
+		kseq_t *seq = kseq_init(fp);
+		ChunkedSeqReader reader(seq, m_kmerSize);
+#pragma omp parallel
+		{
+			vector<string> sequences;
+			vector<uint64_t> hashes(
+					size_t(KmerLoader::s_hashBatch) * m_hashNum);
+			PositionBuckets::Buffer buffer = buckets.createBuffer();
+			size_t localKmers = 0;
+			size_t localRemoved = 0;
+			for (;;) {
+				unsigned count;
+#pragma omp critical(kseq_read)
+				count = KmerLoader::readBatch(reader, sequences);
+				if (count == 0) {
+					break;
+				}
+				for (unsigned j = 0; j < count; ++j) {
+					KmerLoader::hashBatches(sequences[j], m_kmerSize,
+							m_hashNum, opt::syncmerSize, hashes,
+							[&](const uint64_t *batch, unsigned batched) {
+								for (unsigned k = 0; k < batched; ++k) {
+									const uint64_t *kmerHashes = &batch[k
+											* m_hashNum];
+									if (bfsub != NULL
+											&& bfsub->contains(kmerHashes)) {
+										++localRemoved;
+										continue;
+									}
+									for (unsigned h = 0; h < m_hashNum; ++h) {
+										buckets.add(buffer,
+												kmerHashes[h] % m_filterSize);
+									}
+									++localKmers;
+								}
+							});
+				}
+			}
+			buckets.flush(buffer);
+#pragma omp atomic
+			kmers += localKmers;
+#pragma omp atomic
+			kmerRemoved += localRemoved;
+		}
+		kseq_destroy(seq);
+		gzclose(fp);
+	}
+	buckets.close();
+	return kmers;
+}
+
+/*
+ * Writes the header BloomFilter::storeFilter writes for a filter of
+ * m_filterSize bits, taken from a small filter stored next to filename
+ */
+void BloomFilterGenerator::writeHeader(FILE *file,
+		const string &filename) const {
+	string headerFile = filename + ".header";
+	BloomFilter(64, m_hashNum, m_kmerSize).storeFilter(headerFile);
+	BloomFilter::FileHeader header;
+	FILE *small = fopen(headerFile.c_str(), "rb");
+	if (small == NULL || fread(&header, sizeof(header), 1, small) != 1) {
+		cerr << "Error: Could not read " << headerFile << endl;
+		exit(1);
+	}
+	fclose(small);
+	remove(headerFile.c_str());
+	header.size = m_filterSize;
+	if (fwrite(&header, sizeof(header), 1, file) != 1) {
+		cerr << "Error: Could not write to " << filename << endl;
+		exit(1);
+	}
+}
+
 //setters
 void BloomFilterGenerator::setFilterSize(size_t bits) {
 	m_filterSize = bits;
 }
 
+/*
+ * Also build a prescreen filter of bits bits holding 1 in rate k-mers (see
+ * SeqEval::prescreen), written to [filter name]_prescreen.bf. Not used in
+ * progressive mode.
+ */
+void BloomFilterGenerator::setPrescreen(unsigned rate, size_t bits) {
+	m_prescreenRate = rate;
+	m_prescreenSize = bits;
+}
+
 //getters
 
 /*
@@ -1212,6 +1748,13 @@ size_t BloomFilterGenerator::getTotalEntries() const {
 	return m_totalEntries;
 }
 
+/*
+ * Returns the number of k-mers inserted into the prescreen filter
+ */
+size_t BloomFilterGenerator::getPrescreenEntries() const {
+	return m_prescreenEntries;
+}
+
 /*
  * Returns the maximum possible number of expected filter entries based on inputs
  */
@@ -1219,6 +1762,108 @@ size_t BloomFilterGenerator::getExpectedEntries() const {
 	return m_expectedEntries;
 }
 
+/*
+ * Distinct k-mers estimated when sizing the filter (0 if the size was given)
+ * and the relative standard error of the estimate
+ */
+size_t BloomFilterGenerator::getDistinctEstimate(double &error) const {
+	error = m_distinctError;
+	return m_distinctEstimate;
+}
+
+/*
+ * Upper bound on the number of k-mers in the files from their sizes, without
+ * reading them. Used to size a filter that is folded once the number of
+ * k-mers inserted is known (--single_pass).
+ */
+size_t BloomFilterGenerator::estimateMaxEntries(const vector<string> &filenames,
+		unsigned kmerSize) {
+	size_t entries = 0;
+	for (vector<string>::const_iterator i = filenames.begin();
+			i != filenames.end(); ++i) {
+		struct stat st;
+		if (stat(i->c_str(), &st) != 0) {
+			cerr << "file " << *i << " cannot be opened" << endl;
+			exit(1);
+		}
+		//gzip files start with 0x1f 0x8b
+		unsigned char magic[2] = { 0, 0 };
+		FILE *file = fopen(i->c_str(), "rb");
+		if (file == NULL || fread(magic, 1, 2, file) != 2) {
+			magic[0] = 0;
+		}
+		if (file != NULL) {
+			fclose(file);
+		}
+		bool gzipped = magic[0] == 0x1f && magic[1] == 0x8b;
+		entries += size_t(st.st_size) * (gzipped ? s_maxGzipRatio : 1);
+	}
+	if (opt::syncmerSize > 0) {
+		//about 1 in k - s + 1 k-mers are syncmers
+		entries /= kmerSize - opt::syncmerSize + 1;
+	}
+	return max(entries, size_t(1));
+}
+
+/*
+ * Folds the filter in filename to the smallest size of at least minSize bits
+ * that divides its size, by OR-ing together its bits that are equal modulo
+ * the new size. A k-mer sets bit (hash % size) % newSize = hash % newSize, so
+ * the result is the filter that would have been built with the new size.
+ * Returns the new size.
+ */
+size_t BloomFilterGenerator::foldFilter(const string &filename,
+		size_t minSize) {
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == NULL) {
+		cerr << "Error: Could not open " << filename << endl;
+		exit(1);
+	}
+	BloomFilter::FileHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1
+			|| header.hlen != sizeof(header) || header.size % 64 != 0) {
+		cerr << "Error: " << filename << " does not have a valid filter header"
+				<< endl;
+		exit(1);
+	}
+	const size_t words = header.size / 64;
+	size_t factor = max(header.size / max(minSize, size_t(64)), size_t(1));
+	while (words % factor != 0) {
+		--factor;
+	}
+	if (factor == 1) {
+		fclose(file);
+		return header.size;
+	}
+	const size_t newWords = words / factor;
+	vector<uint64_t> folded(newWords, 0);
+	vector<uint64_t> block(min(words, s_foldBlockWords));
+	for (size_t done = 0; done < words;) {
+		size_t count = min(block.size(), words - done);
+		if (fread(block.data(), sizeof(uint64_t), count, file) != count) {
+			cerr << "Error: " << filename << " is truncated" << endl;
+			exit(1);
+		}
+		for (size_t i = 0; i < count; ++i) {
+			folded[(done + i) % newWords] |= block[i];
+		}
+		done += count;
+	}
+	fclose(file);
+
+	header.size = newWords * 64;
+	file = fopen(filename.c_str(), "wb");
+	if (file == NULL
+			|| fwrite(&header, sizeof(header), 1, file) != 1
+			|| fwrite(folded.data(), sizeof(uint64_t), newWords, file)
+					!= newWords) {
+		cerr << "Error: Could not write to " << filename << endl;
+		exit(1);
+	}
+	fclose(file);
+	return header.size;
+}
+
 //destructor
 BloomFilterGenerator::~BloomFilterGenerator() {
 }
@@ -8,15 +8,24 @@
 #ifndef BLOOMFILTERGENERATOR_H_
 #define BLOOMFILTERGENERATOR_H_
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_set.hpp>
 #include <vector>
 #include "btl_bloomfilter/BloomFilter.hpp"
 #include "btl_bloomfilter/vendor/ntHashIterator.hpp"
 #include "Common/SeqEval.h"
+#include "Common/Syncmers.hpp"
+#include "Common/HyperLogLog.hpp"
+#include "Common/ChunkedSeqReader.hpp"
+#include "Common/KmerLoader.hpp"
+#include "ReadSpill.hpp"
+#include "PositionBuckets.hpp"
+#include "MappedFilter.hpp"
 #include "Common/kseq.h"
 #include <iostream>
 #include <zlib.h>
 #include <omp.h>
 #include "Common/Options.h"
+#include "Common/Checkpoint.h"
 #ifndef KSEQ_INIT_NEW
 #define KSEQ_INIT_NEW
 #include "Common/kseq.h"
@@ -39,6 +48,9 @@ public:
 
 	size_t generate(const string &filename);
 	size_t generate(const string &filename, const string &subtractFilter);
+	size_t generateExternal(const string &filename,
+			const string &subtractFilter, size_t maxMemBytes,
+			const string &tmpPrefix);
 	size_t generateProgressive(const string &filename, double score,
 			const string &file1, const string &file2, createMode mode,
 			bool printReads, const string &subtractFilter = "");
@@ -59,10 +71,20 @@ public:
 			const vector<string> &files, bool printReads,
 			const string &subtractFilter = "");
 
+	size_t estimateNewEntries(const MappedFilter &filter);
+	size_t append(MappedFilter &filter, MappedFilter *prescreen);
+
 	void setFilterSize(size_t bits);
 	void setHashFuncs(unsigned numFunc);
+	void setPrescreen(unsigned rate, size_t bits);
 	size_t getTotalEntries() const;
+	size_t getPrescreenEntries() const;
+
+	static size_t estimateMaxEntries(const vector<string> &filenames,
+			unsigned kmerSize);
+	static size_t foldFilter(const string &filename, size_t minSize);
 	size_t getExpectedEntries() const;
+	size_t getDistinctEstimate(double &error) const;
 
 	virtual ~BloomFilterGenerator();
 private:
@@ -70,8 +92,34 @@ private:
 	unsigned m_kmerSize;
 	unsigned m_hashNum;
 	size_t m_expectedEntries;
+	size_t m_distinctEstimate;
+	double m_distinctError;
 	size_t m_filterSize;
 	size_t m_totalEntries;
+	//filter being built with the subtract filter fused into it (progressive)
+	FusedSubtractFilter *m_fused;
+	//filter of 1 in m_prescreenRate k-mers written next to the filter
+	BloomFilter *m_prescreen;
+	//existing prescreen filter appended to instead (--append)
+	MappedFilter *m_mappedPrescreen;
+	unsigned m_prescreenRate;
+	size_t m_prescreenSize;
+	size_t m_prescreenEntries;
+	//read evaluators for the scoring options, chosen once
+	SeqEval::ReadEvaluator<BloomFilter> m_evalRead;
+	SeqEval::ReadEvaluator<BloomFilter> m_evalReadSub;
+	SeqEval::ReadEvaluator<FusedSubtractFilter> m_evalFused;
+
+	//counts of a thread while loading, added to the totals once
+	struct LoadCounts {
+		size_t redundancy;
+		size_t total;
+		size_t sampled;
+		size_t removed;
+		LoadCounts() :
+				redundancy(0), total(0), sampled(0), removed(0) {
+		}
+	};
 
 	//TODO a similar struct exists in BBC -> refactor to use same struct?
 	struct FqRec {
@@ -98,6 +146,44 @@ private:
 		}
 	}
 
+	/*
+	 * Stores the partially built filter and read position
+	 * Must be called outside of any parallel region
+	 */
+	inline void saveCheckpoint(Checkpoint &ckpt, const BloomFilter &filter,
+			const vector<string> &inputFiles, unsigned iteration,
+			size_t pairReads, size_t totalReads, size_t taggedReads,
+			size_t redundancy) {
+		filter.storeFilter(ckpt.getPrefix() + "_checkpoint.bf");
+		ckpt.setList("input_files", inputFiles);
+		ckpt.set("iteration", iteration);
+		ckpt.set("pair_reads", pairReads);
+		ckpt.set("total_reads", totalReads);
+		ckpt.set("tagged_reads", taggedReads);
+		ckpt.set("redundancy", redundancy);
+		ckpt.set("total_entries", m_totalEntries);
+		ckpt.save();
+		if (opt::verbose) {
+			cerr << "Checkpoint saved at read " << totalReads << endl;
+		}
+	}
+
+	/*
+	 * Skips over reads already processed before a checkpoint
+	 */
+	inline size_t skipReads(kseq_t *seq, size_t count) {
+		size_t skipped = 0;
+		while (skipped < count && kseq_read(seq) >= 0) {
+			++skipped;
+		}
+		if (skipped < count) {
+			cerr << "Error: Input is shorter than recorded in checkpoint."
+					<< endl;
+			exit(1);
+		}
+		return skipped;
+	}
+
 	inline void printDebug(const FqRec &rec, unsigned taggedKmers,
 			unsigned repeatKmers, size_t taggedReadIndex, size_t totalReads) {
 		cout << "@" << rec.header << " " << taggedKmers << " " << m_totalEntries
@@ -105,8 +191,74 @@ private:
 				<< totalReads << "\n" << rec.seq << "\n+\n" << rec.qual << "\n";
 	}
 
+	/*
+	 * Reads the next pair from the spill file if there is one, or else from
+	 * the read files. l1 and l2 are negative at the end of the reads.
+	 */
+	inline void readPair(kseq_t *seq1, kseq_t *seq2, ReadSpillReader *spillIn,
+			FqRec &rec1, FqRec &rec2, int &l1, int &l2) {
+		if (spillIn != NULL) {
+			l1 = l2 = -1;
+			if (spillIn->read(rec1.header, rec1.seq, rec1.qual)
+					&& spillIn->read(rec2.header, rec2.seq, rec2.qual)) {
+				l1 = rec1.seq.length();
+				l2 = rec2.seq.length();
+			}
+			return;
+		}
+		l1 = kseq_read(seq1);
+		if (l1 >= 0) {
+			rec1.seq = string(seq1->seq.s, l1);
+			rec1.header = string(seq1->name.s, seq1->name.l);
+			rec1.qual = string(seq1->qual.s, seq1->qual.l);
+		}
+		l2 = kseq_read(seq2);
+		if (l2 >= 0) {
+			rec2.seq = string(seq2->seq.s, l2);
+			rec2.header = string(seq2->name.s, seq2->name.l);
+			rec2.qual = string(seq2->qual.s, seq2->qual.l);
+		}
+	}
+
+	/*
+	 * Spill file written in iteration i of a progressive build of filename.
+	 * Two files are alternated, as each iteration reads the previous one.
+	 */
+	static string spillName(const string &filename, unsigned i) {
+		return filename.substr(0, filename.length() - 3)
+				+ (i % 2 == 0 ? "_spill0.bin" : "_spill1.bin");
+	}
+
+	/*
+	 * Ends iteration i of a progressive build: the spill file read in it is
+	 * removed and the one written in it is read in the next iteration
+	 */
+	inline void nextSpill(const string &filename, unsigned i, bool printReads,
+			ReadSpillReader *&spillIn, ReadSpillWriter *&spillOut) {
+		if (spillIn != NULL) {
+			delete spillIn;
+			spillIn = NULL;
+			remove(spillName(filename, i - 1).c_str());
+		}
+		if (spillOut != NULL) {
+			cerr << "Pairs not yet recruited: " << spillOut->getPairs()
+					<< endl;
+			delete spillOut;
+			spillOut = NULL;
+			spillIn = new ReadSpillReader(spillName(filename, i), printReads);
+		}
+	}
+
+	/*
+	 * Number of entries to size the filter for: the number of distinct k-mers
+	 * estimated with a HyperLogLog counted while reading the files, padded by
+	 * three standard errors and capped by the number of k-mer positions.
+	 * Every k-mer is hashed here and again when inserted, as the filter size
+	 * must be known before insertion; --single_pass avoids this pass.
+	 */
 	inline size_t calcExpectedEntries() {
-		size_t expectedEntries = 0;
+		size_t kmerPositions = 0;
+		HyperLogLog distinct;
 		for (unsigned i = 0; i < m_fileNames.size(); ++i) {
 			gzFile fp;
 			fp = gzopen(m_fileNames[i].c_str(), "r");
@@ -118,82 +270,237 @@ private:
 				cerr << "Opening File " << m_fileNames[i] << endl;
 			}
 			kseq_t *seq = kseq_init(fp);
-			int l;
-			size_t length;
-#pragma omp parallel private(l, length)
-			for (;;) {
+			ChunkedSeqReader reader(seq, m_kmerSize);
+#pragma omp parallel
+			{
+				vector<string> buffers;
+				size_t positions = 0;
+				HyperLogLog localDistinct;
+				for (;;) {
+					unsigned count;
 #pragma omp critical(kseq_read)
-				{
-					l = kseq_read(seq);
-					length = seq->seq.l;
+					count = KmerLoader::readBatch(reader, buffers);
+					if (count == 0) {
+						break;
+					}
+					KmerLoader::countBatch(buffers, count, m_kmerSize,
+							positions, localDistinct);
 				}
-				if (l >= 0) {
 #pragma omp atomic
-					expectedEntries += length - m_kmerSize + 1;
-				} else {
-					break;
-				}
+				kmerPositions += positions;
+#pragma omp critical(distinct)
+				distinct.merge(localDistinct);
 			}
 			kseq_destroy(seq);
 			gzclose(fp);
 		}
-		return (expectedEntries);
+		m_distinctEstimate = size_t(distinct.estimate() + 0.5);
+		m_distinctError = distinct.relativeError();
+		cerr << "Estimated distinct k-mers: " << m_distinctEstimate << " (+/- "
+				<< 100.0 * m_distinctError << "%) of " << kmerPositions
+				<< " k-mer positions" << endl;
+		return KmerLoader::expectedEntries(kmerPositions, distinct,
+				m_kmerSize, opt::syncmerSize);
 	}
 
-	inline size_t loadFilter(BloomFilter &bf, size_t &totalEntries) {
-		size_t redundancy = 0;
-		for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-			gzFile fp;
-			fp = gzopen(m_fileNames[i].c_str(), "r");
-			if (fp == Z_NULL) {
-				cerr << "file " << m_fileNames[i] << " cannot be opened"
-						<< endl;
-				exit(1);
+	/*
+	 * Inserts into bf, and into its fused copy if there is one
+	 */
+	inline bool insertAndCheck(BloomFilter &bf, const uint64_t *hashes) {
+		if (m_fused != NULL && &bf == &m_fused->getFilter()) {
+			m_fused->insert(hashes);
+		}
+		return bf.insertAndCheck(hashes);
+	}
+
+	inline bool insertAndCheck(MappedFilter &bf, const uint64_t *hashes) {
+		return bf.insertAndCheck(hashes);
+	}
+
+	/*
+	 * Exits if a filter to append to was not built with the k-mer size and
+	 * number of hash functions of its info file
+	 */
+	inline void checkAppendFilter(const MappedFilter &filter) const {
+		if (filter.getKmerSize() != m_kmerSize
+				|| filter.getHashNum() != m_hashNum) {
+			cerr << "Error: " << filter.getFileName() << " has a k-mer size of "
+					<< filter.getKmerSize() << " and " << filter.getHashNum()
+					<< " hash functions, which do not match its info file"
+					<< endl;
+			exit(1);
+		}
+	}
+
+	inline void createPrescreen() {
+		if (m_prescreenRate > 0) {
+			m_prescreen = new BloomFilter(m_prescreenSize, m_hashNum,
+					m_kmerSize);
+		}
+	}
+
+	/*
+	 * Writes the prescreen filter next to the filter written to filename
+	 */
+	inline void storePrescreen(const string &filename) {
+		if (m_prescreen != NULL) {
+			m_prescreen->storeFilter(
+					filename.substr(0, filename.length() - 3)
+							+ "_prescreen.bf");
+			delete m_prescreen;
+			m_prescreen = NULL;
+		}
+	}
+
+	/*
+	 * Inserts into the prescreen filter if there is one and the k-mer is
+	 * sampled, returning 1 if the k-mer is new to it
+	 */
+	inline size_t insertPrescreen(const uint64_t *hashes) {
+		if ((m_prescreen == NULL && m_mappedPrescreen == NULL)
+				|| !SeqEval::inPrescreenSample(hashes[0], m_prescreenRate)) {
+			return 0;
+		}
+		if (m_mappedPrescreen != NULL) {
+			return !m_mappedPrescreen->insertAndCheck(hashes);
+		}
+		return !m_prescreen->insertAndCheck(hashes);
+	}
+
+	/*
+	 * Evaluates a read against the filter being built and the subtract filter
+	 */
+	inline bool evalRead(const string &seq, const BloomFilter &filter,
+			double score, const BloomFilter *filterSub) const {
+		if (m_fused != NULL) {
+			return m_evalFused(seq, *m_fused, score, NULL);
+		}
+		return (filterSub != NULL ? m_evalReadSub : m_evalRead)(seq, filter,
+				score, filterSub);
+	}
+
+	/*
+	 * Evaluates a read against the bait filter and the subtract filter
+	 */
+	inline bool evalBait(const string &seq, const BloomFilter &baitFilter,
+			double score, const BloomFilter *filterSub) const {
+		return (filterSub != NULL ? m_evalReadSub : m_evalRead)(seq,
+				baitFilter, score, filterSub);
+	}
+
+	/*
+	 * Whether a pair is recruited, with the same rules as the parallel
+	 * progressive build
+	 */
+	inline bool isRecruited(const FqRec &rec1, const FqRec &rec2,
+			const BloomFilter &filter, const BloomFilter *filterSub,
+			double score, createMode mode) const {
+		if (mode == PROG_INC) {
+			size_t numKmers1 =
+					rec1.seq.length() > m_kmerSize ?
+							rec1.seq.length() - m_kmerSize + 1 : 0;
+			size_t numKmers2 =
+					rec2.seq.length() > m_kmerSize ?
+							rec2.seq.length() - m_kmerSize + 1 : 0;
+			return (numKmers1 > score
+					&& evalRead(rec1.seq, filter, score, filterSub))
+					|| (numKmers2 > score
+							&& evalRead(rec2.seq, filter, score, filterSub));
+		}
+		return evalRead(rec1.seq, filter, score, filterSub)
+				&& evalRead(rec2.seq, filter, score, filterSub);
+	}
+
+	/*
+	 * Inserts a recruited pair, returning the number of new k-mers. The bit
+	 * positions of the new k-mers are added to setPositions if it is not NULL.
+	 */
+	inline size_t insertPair(BloomFilter &filter, BloomFilter *filterSub,
+			const FqRec &rec1, const FqRec &rec2, bool printReads,
+			size_t taggedReads, size_t totalReads,
+			vector<uint64_t> *setPositions = NULL) {
+		unsigned taggedKmers1 = loadFilter(filter, rec1.seq, setPositions);
+		unsigned taggedKmers2 = loadFilter(filter, rec2.seq, setPositions);
+		if (printReads) {
+			printDebug(rec1, taggedKmers1, checkFilter(filterSub, rec1.seq),
+					taggedReads, totalReads);
+			printDebug(rec2, taggedKmers2, checkFilter(filterSub, rec2.seq),
+					taggedReads, totalReads);
+		}
+		return taggedKmers1 + taggedKmers2;
+	}
+
+	/*
+	 * Adds a bit position not set in filter for each k-mer of seq not in it.
+	 * A read's evaluation can only change once one of these bits is set, as
+	 * k-mers found in the filter stay in it.
+	 */
+	inline void addWitnesses(const string &seq, const BloomFilter &filter,
+			vector<uint64_t> &witnesses) const {
+		vector<uint64_t> probe(m_hashNum);
+		for (ntHashIterator itr(seq, m_hashNum, m_kmerSize); itr != itr.end();
+				++itr) {
+			if (filter.contains(*itr)) {
+				continue;
 			}
-			kseq_t *seq = kseq_init(fp);
-			int l;
-			char * tempStr;
-#pragma omp parallel private(l, tempStr)
-			for (;;) {
-#pragma omp critical(kseq_read)
-				{
-					l = kseq_read(seq);
-					if (l >= 0) {
-						tempStr = new char[l + 1];
-						strcpy(tempStr, seq->seq.s);
-					}
-				}
-				size_t tempRedund = 0;
-				size_t tempTotal = 0;
-				if (l >= 0) {
-					//k-merize and insert into bloom filter
-					for (ntHashIterator itr(tempStr, m_hashNum, m_kmerSize); itr != itr.end(); ++itr) {
-						bool found = bf.insertAndCheck(*itr);
-						tempRedund += found;
-						tempTotal += !found;
-					}
-#pragma omp atomic
-					redundancy += tempRedund;
-#pragma omp atomic
-					totalEntries += tempTotal;
-					delete[] tempStr;
-				} else {
+			//looking up a k-mer whose hash values are all the same checks one bit
+			for (unsigned i = 0; i < m_hashNum; ++i) {
+				fill(probe.begin(), probe.end(), (*itr)[i]);
+				if (!filter.contains(probe.data())) {
+					witnesses.push_back((*itr)[i] % filter.getFilterSize());
 					break;
 				}
 			}
-			kseq_destroy(seq);
-			gzclose(fp);
 		}
-		return redundancy;
+	}
+
+	static inline bool hasSetWitness(const vector<uint64_t> &witnesses,
+			const boost::unordered_set<uint64_t> &setBits) {
+		if (setBits.empty()) {
+			return false;
+		}
+		for (vector<uint64_t>::const_iterator i = witnesses.begin();
+				i != witnesses.end(); ++i) {
+			if (setBits.find(*i) != setBits.end()) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool recruitBatches(kseq_t *seq1, kseq_t *seq2, ReadSpillReader *spillIn,
+			ReadSpillWriter *spillOut, BloomFilter &filter,
+			BloomFilter *filterSub, double score, createMode mode,
+			bool printReads, size_t batchEnd, size_t &pairReads,
+			size_t &totalReads, size_t &taggedReads);
+
+	size_t hashToBuckets(PositionBuckets &buckets, const BloomFilter *bfsub,
+			size_t &kmerRemoved);
+	void writeHeader(FILE *file, const string &filename) const;
+
+	template<typename Filter>
+	inline size_t loadFilter(Filter &bf, size_t &totalEntries) {
+		size_t kmerRemoved = 0;
+		return loadFiles(bf, NULL, totalEntries, kmerRemoved);
 	}
 
 	/*
-	 * Return the count of new k-mers in the filter
+	 * Return the count of new k-mers in the filter. The bit positions of the
+	 * new k-mers are added to setPositions if it is not NULL.
 	 */
-	inline unsigned loadFilter(BloomFilter &bf, const string &str) {
+	inline unsigned loadFilter(BloomFilter &bf, const string &str,
+			vector<uint64_t> *setPositions = NULL) {
 		size_t tempTotal = 0;
 		for (ntHashIterator itr(str, m_hashNum, m_kmerSize); itr != itr.end(); ++itr) {
-			tempTotal += !bf.insertAndCheck(*itr);
+			if (!insertAndCheck(bf, *itr)) {
+				++tempTotal;
+				if (setPositions != NULL) {
+					for (unsigned i = 0; i < m_hashNum; ++i) {
+						setPositions->push_back(
+								(*itr)[i] % bf.getFilterSize());
+					}
+				}
+			}
 		}
 #pragma omp atomic
 		m_totalEntries += tempTotal;
@@ -201,14 +508,18 @@ private:
 	}
 
 	/*
-	 * Returns count of k-mers found in filter
+	 * Returns count of k-mers found in the subtract filter bf, looked up in
+	 * the fused filter if there is one
 	 */
 	inline unsigned checkFilter(BloomFilter *bf, const string &str) {
 		size_t tempTotal = 0;
 		if (bf != NULL) {
 			for (ntHashIterator itr(str, m_hashNum, m_kmerSize);
 					itr != itr.end(); ++itr) {
-				tempTotal += bf->contains(*itr);
+				tempTotal +=
+						m_fused != NULL ?
+								m_fused->subtractContains(*itr) :
+								bf->contains(*itr);
 			}
 		}
 		return tempTotal;
@@ -217,7 +528,6 @@ private:
 	inline size_t loadFilterSubtract(BloomFilter &bf, BloomFilter &bfsub,
 			size_t &totalEntries) {
 		size_t kmerRemoved = 0;
-		size_t redundancy = 0;
 
 		if (bf.getHashNum() != bfsub.getHashNum()) {
 			cerr << "Error: Subtraction filter's hash number "
@@ -235,54 +545,90 @@ private:
 			exit(1);
 		}
 
+		size_t redundancy = loadFiles(bf, &bfsub, totalEntries, kmerRemoved);
+		cerr << "Total Number of K-mers not added: " << kmerRemoved << endl;
+		return redundancy;
+	}
+
+	/*
+	 * Inserts the k-mers of all files into bf, skipping those in bfsub if it
+	 * is not NULL. Returns the number of k-mers already in bf.
+	 *
+	 * Threads take batches of sequences from the file, so the lock on reading
+	 * is taken once per batch rather than once per sequence. Long sequences
+	 * are split into pieces that are loaded by different threads. Buffers are kept
+	 * per thread and reused, and counts are added to the totals once per
+	 * thread. Several threads can insert into bf at once, as each bit is set
+	 * with an atomic fetch-or, whose result tells whether the k-mer was new.
+	 */
+	template<typename Filter>
+	inline size_t loadFiles(Filter &bf, const BloomFilter *bfsub,
+			size_t &totalEntries, size_t &kmerRemoved) {
+		size_t redundancy = 0;
 		for (unsigned i = 0; i < m_fileNames.size(); ++i) {
 			gzFile fp;
 			fp = gzopen(m_fileNames[i].c_str(), "r");
-			if (fp == NULL) {
+			if (fp == Z_NULL) {
 				cerr << "file " << m_fileNames[i] << " cannot be opened"
 						<< endl;
 				exit(1);
 			}
 			kseq_t *seq = kseq_init(fp);
-			int l;
-			char * tempStr;
-#pragma omp parallel private(l, tempStr)
-			for (;;) {
+			ChunkedSeqReader reader(seq, m_kmerSize);
+#pragma omp parallel
+			{
+				vector<string> buffers;
+				vector<uint64_t> hashes(
+						size_t(KmerLoader::s_hashBatch) * m_hashNum);
+				LoadCounts counts;
+				for (;;) {
+					unsigned count;
 #pragma omp critical(kseq_read)
-				{
-					l = kseq_read(seq);
-					if (l >= 0) {
-						tempStr = new char[l + 1];
-						strcpy(tempStr, seq->seq.s);
+					count = KmerLoader::readBatch(reader, buffers);
+					if (count == 0) {
+						break;
 					}
-				}
-				size_t tempRedund = 0;
-				size_t tempTotal = 0;
-				if (l >= 0) {
-					for (ntHashIterator itr(tempStr, m_hashNum, m_kmerSize); itr != itr.end(); ++itr) {
-						if (bfsub.contains(*itr)) {
-							++kmerRemoved;
-						} else {
-							bool found = bf.insertAndCheck(*itr);
-							tempRedund += found;
-							tempTotal += !found;
-						}
+					for (unsigned j = 0; j < count; ++j) {
+						insertSeq(bf, bfsub, buffers[j], hashes, counts);
 					}
+				}
 #pragma omp atomic
-					redundancy += tempRedund;
+				redundancy += counts.redundancy;
 #pragma omp atomic
-					totalEntries += tempTotal;
-					delete[] tempStr;
-				} else {
-					break;
-				}
+				totalEntries += counts.total;
+#pragma omp atomic
+				m_prescreenEntries += counts.sampled;
+#pragma omp atomic
+				kmerRemoved += counts.removed;
 			}
 			kseq_destroy(seq);
 			gzclose(fp);
 		}
-		cerr << "Total Number of K-mers not added: " << kmerRemoved << endl;
 		return redundancy;
 	}
+
+	/*
+	 * Inserts the k-mers of a sequence, skipping those in bfsub if it is not
+	 * NULL. The k-mers are hashed in batches (see KmerLoader).
+	 */
+	template<typename Filter>
+	inline void insertSeq(Filter &bf, const BloomFilter *bfsub,
+			const string &seq, vector<uint64_t> &hashes, LoadCounts &counts) {
+		KmerLoader::hashBatches(seq, m_kmerSize, m_hashNum, opt::syncmerSize,
+				hashes, [&](const uint64_t *batch, unsigned batched) {
+					for (unsigned j = 0; j < batched; ++j) {
+						const uint64_t *kmerHashes = &batch[j * m_hashNum];
+						if (bfsub != NULL && bfsub->contains(kmerHashes)) {
+							++counts.removed;
+							continue;
+						}
+						bool found = insertAndCheck(bf, kmerHashes);
+						counts.redundancy += found;
+						counts.total += !found;
+						counts.sampled += insertPrescreen(kmerHashes);
+					}
+				});
+	}
 };
 
 #endif /* BLOOMFILTERGENERATOR_H_ */
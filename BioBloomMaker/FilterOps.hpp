@@ -0,0 +1,173 @@
+/*
+ * FilterOps.hpp
+ *
+ * Bitwise operations on the bit arrays of filter files, used by
+ * biobloomfilterops. Filters are streamed in blocks so memory use does not
+ * depend on the filter size.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef FILTEROPS_HPP_
+#define FILTEROPS_HPP_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <stdint.h>
+#include "btl_bloomfilter/BloomFilter.hpp"
+
+using namespace std;
+
+namespace FilterOps {
+
+enum Operation {
+	NO_OP, UNION, INTERSECT, SUBTRACT
+};
+
+//64-bit words of each filter held in memory at once
+static const size_t s_blockWords = 1 << 23;
+
+/*
+ * Combines words of src into dest. Plain loops over 64-bit words, which the
+ * compiler vectorizes.
+ */
+inline void combine(Operation op, uint64_t *dest, const uint64_t *src,
+		long words) {
+	switch (op) {
+	case UNION: {
+#pragma omp parallel for
+		for (long i = 0; i < words; ++i) {
+			dest[i] |= src[i];
+		}
+		break;
+	}
+	case INTERSECT: {
+#pragma omp parallel for
+		for (long i = 0; i < words; ++i) {
+			dest[i] &= src[i];
+		}
+		break;
+	}
+	case SUBTRACT: {
+#pragma omp parallel for
+		for (long i = 0; i < words; ++i) {
+			dest[i] &= ~src[i];
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+inline size_t popcount(const uint64_t *words, long count) {
+	size_t pop = 0;
+#pragma omp parallel for reduction(+:pop)
+	for (long i = 0; i < count; ++i) {
+		pop += __builtin_popcountll(words[i]);
+	}
+	return pop;
+}
+
+/*
+ * Reads bytes of a filter into words, zeroing the unused end of the last word
+ */
+inline void readBlock(FILE *file, const string &fileName, uint64_t *words,
+		size_t bytes) {
+	words[(bytes - 1) / sizeof(uint64_t)] = 0;
+	if (fread(words, 1, bytes, file) != bytes) {
+		cerr << "Error: " << fileName << " is truncated" << endl;
+		exit(1);
+	}
+}
+
+/*
+ * Opens a filter file and reads its header, leaving the file at its bit array
+ */
+inline FILE *openFilter(const string &fileName,
+		BloomFilter::FileHeader &header) {
+	FILE *file = fopen(fileName.c_str(), "rb");
+	if (file == NULL) {
+		cerr << "Error: Could not open " << fileName << endl;
+		exit(1);
+	}
+	if (fread(&header, sizeof(BloomFilter::FileHeader), 1, file) != 1
+			|| header.hlen != sizeof(BloomFilter::FileHeader)) {
+		cerr << "Error: " << fileName << " does not have a valid filter header"
+				<< endl;
+		exit(1);
+	}
+	return file;
+}
+
+/*
+ * Number of bits set in the union of the filters from first on, which are at
+ * their bit arrays of filterBytes bytes. The files are returned there.
+ */
+inline size_t unionPopcount(const vector<FILE*> &files,
+		const vector<string> &fileNames, unsigned first, size_t filterBytes) {
+	vector<uint64_t> result(s_blockWords);
+	vector<uint64_t> block(s_blockWords);
+	size_t pop = 0;
+	for (size_t done = 0; done < filterBytes;) {
+		size_t bytes = min(filterBytes - done, s_blockWords * sizeof(uint64_t));
+		long words = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		readBlock(files[first], fileNames[first], result.data(), bytes);
+		for (unsigned i = first + 1; i < files.size(); ++i) {
+			readBlock(files[i], fileNames[i], block.data(), bytes);
+			combine(UNION, result.data(), block.data(), words);
+		}
+		pop += popcount(result.data(), words);
+		done += bytes;
+	}
+	for (unsigned i = first; i < files.size(); ++i) {
+		fseek(files[i], sizeof(BloomFilter::FileHeader), SEEK_SET);
+	}
+	return pop;
+}
+
+/*
+ * Expected fraction of the k-mers of a filter with hashNum hash functions
+ * lost by clearing pop of its size bits, which is the chance that at least
+ * one of the bits of a k-mer is cleared
+ */
+inline double subtractLoss(size_t pop, size_t size, unsigned hashNum) {
+	return 1.0 - pow(1.0 - double(pop) / double(size), double(hashNum));
+}
+
+/*
+ * Combines the bit arrays of filterBytes bytes of files, at their bit arrays,
+ * by op and writes the result to output. Returns the number of bits set.
+ */
+inline size_t combineFilters(Operation op, const vector<FILE*> &files,
+		const vector<string> &fileNames, size_t filterBytes, FILE *output,
+		const string &outputName) {
+	vector<uint64_t> result(s_blockWords);
+	vector<uint64_t> block(s_blockWords);
+	size_t pop = 0;
+	for (size_t done = 0; done < filterBytes;) {
+		size_t bytes = min(filterBytes - done, s_blockWords * sizeof(uint64_t));
+		long words = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+		readBlock(files[0], fileNames[0], result.data(), bytes);
+		for (unsigned i = 1; i < files.size(); ++i) {
+			readBlock(files[i], fileNames[i], block.data(), bytes);
+			combine(op, result.data(), block.data(), words);
+		}
+		pop += popcount(result.data(), words);
+		if (fwrite(result.data(), 1, bytes, output) != bytes) {
+			cerr << "Error: Could not write to " << outputName << endl;
+			exit(1);
+		}
+		done += bytes;
+	}
+	return pop;
+}
+
+}
+
+#endif /* FILTEROPS_HPP_ */
@@ -17,7 +17,10 @@
 #include "btl_bloomfilter/MIBloomFilter.hpp"
 #include "btl_bloomfilter/MIBFConstructSupport.hpp"
 #include "btl_bloomfilter/vendor/stHashIterator.hpp"
+#include "btl_bloomfilter/vendor/ntHashIterator.hpp"
 #include "Common/sntHashIterator.hpp"
+#include "Common/HyperLogLog.hpp"
+#include "Common/ChunkedSeqReader.hpp"
 
 #include "btl_bloomfilter/BloomFilter.hpp"
 
@@ -49,6 +52,8 @@ public:
 		//dense hash maps take POD, and strings need to live somewhere
 		m_nameToID.set_empty_key(m_ids[0]);
 		size_t counts = 0;
+		//distinct k-mers, as repeated k-mers take a single slot
+		HyperLogLog distinct;
 
 		if (opt::idByFile) {
 			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
@@ -56,65 +61,65 @@ public:
 						m_fileNames[i].find_last_of("/") + 1));
 				m_nameToID[m_ids.back()] = m_ids.size() - 1;
 			}
-#pragma omp parallel for schedule(dynamic)
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				if (fp == NULL) {
-					cerr << "file " << m_fileNames[i] << " cannot be opened"
-							<< endl;
-					exit(1);
-				}
-				if(opt::verbose){
-#pragma omp critical(stderr)
-					cerr << "Opening " << m_fileNames[i] << endl;
-				}
-				kseq_t *seq = kseq_init(fp);
-				int l;
-				for (;;) {
-					l = kseq_read(seq);
-					if (l >= 0) {
-#pragma omp atomic
-						counts += seq->seq.l - m_kmerSize + 1;
-					} else {
-						kseq_destroy(seq);
-						break;
-					}
-				}
-				gzclose(fp);
+		}
+		for (unsigned i = 0; i < m_fileNames.size(); ++i) {
+			gzFile fp;
+			fp = gzopen(m_fileNames[i].c_str(), "r");
+			if (fp == NULL) {
+				cerr << "file " << m_fileNames[i] << " cannot be opened"
+						<< endl;
+				exit(1);
 			}
-		} else {
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				if (fp == NULL) {
-					cerr << "file " << m_fileNames[i] << " cannot be opened"
-							<< endl;
-					exit(1);
-				}
-				kseq_t *seq = kseq_init(fp);
-				int l;
+			if (opt::verbose) {
+				cerr << "Opening " << m_fileNames[i] << endl;
+			}
+			kseq_t *seq = kseq_init(fp);
+			ChunkedSeqReader reader(seq, m_kmerSize);
+#pragma omp parallel
+			{
+				HyperLogLog localDistinct;
+				string sequence, name;
 				for (;;) {
-					l = kseq_read(seq);
-					if (l >= 0) {
-						m_ids.push_back(string(seq->name.s, seq->name.l));
-						m_nameToID[m_ids.back()] = m_ids.size() - 1;
-						counts += seq->seq.l - m_kmerSize + 1;
-					} else {
-						kseq_destroy(seq);
+					bool read;
+#pragma omp critical(seq)
+					{
+						read = reader.next(sequence, name);
+						//IDs are given in the order of the records
+						if (read && !opt::idByFile && reader.startsRecord()) {
+							m_ids.push_back(name);
+							m_nameToID[m_ids.back()] = m_ids.size() - 1;
+						}
+					}
+					if (!read) {
 						break;
 					}
+					if (sequence.length() >= m_kmerSize) {
+#pragma omp atomic
+						counts += sequence.length() - m_kmerSize + 1;
+					}
+					addDistinct(localDistinct, sequence);
 				}
-				gzclose(fp);
+#pragma omp critical(distinct)
+				distinct.merge(localDistinct);
 			}
+			kseq_destroy(seq);
+			gzclose(fp);
 		}
 
 		//make saturation bit is not exceeded
 		assert(m_ids.size() < ID(1 << (sizeof(ID) * 8 - 1)));
 
-		//estimate number of k-mers
+		//estimate number of k-mers, padded by three standard errors
 		if (m_expectedEntries == 0) {
-			m_expectedEntries = counts;
+			m_expectedEntries = min(counts,
+					size_t(distinct.estimate()
+							* (1.0 + 3.0 * distinct.relativeError()) + 0.5));
+			if (opt::verbose) {
+				cerr << "Estimated distinct k-mers: "
+						<< size_t(distinct.estimate() + 0.5) << " (+/- "
+						<< 100.0 * distinct.relativeError() << "%) of "
+						<< counts << " k-mer positions" << endl;
+			}
 		}
 		//assume each file one line per file
 		if (opt::verbose) {
@@ -149,135 +154,20 @@ public:
 		if (opt::verbose)
 			cerr << "Mem usage (kB): " << memKB << endl;
 
-		if (opt::idByFile) {
-#pragma omp parallel for schedule(dynamic)
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				if(opt::verbose){
-#pragma omp critical(stderr)
-					cerr << "Opening " << m_fileNames[i] << endl;
-				}
-				kseq_t *seq = kseq_init(fp);
-				int l;
-				for (;;) {
-					string sequence, name;
-					{
-						l = kseq_read(seq);
-						if (l >= 0) {
-							sequence = string(seq->seq.s, seq->seq.l);
-							name = m_fileNames[i].substr(
-									m_fileNames[i].find_last_of("/") + 1);
-						}
-					}
-					if (l >= 0) {
-						H itr = hashIterator<H>(sequence, ssVal);
-						miBFCS.insertMIBF(*miBF, itr, m_nameToID[name]);
-					} else {
-						break;
-					}
-				}
-				kseq_destroy(seq);
-				gzclose(fp);
-				if(opt::verbose){
-#pragma omp critical(stderr)
-					cerr << "Finished processing " << m_fileNames[i] << endl;
-				}
-			}
-			//apply saturation
-			if(opt::verbose){
-				cerr << "Applying saturation" << endl;
-			}
-#pragma omp parallel for schedule(dynamic)
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				if(opt::verbose){
-#pragma omp critical(stderr)
-					cerr << "Opening " << m_fileNames[i] << endl;
-				}
-				kseq_t *seq = kseq_init(fp);
-				int l;
-				for (;;) {
-					string sequence, name;
-					{
-						l = kseq_read(seq);
-						if (l >= 0) {
-							sequence = string(seq->seq.s, seq->seq.l);
-							name = m_fileNames[i].substr(
-									m_fileNames[i].find_last_of("/") + 1);
-						}
-					}
-					if (l >= 0) {
-						H itr = hashIterator<H>(sequence, ssVal);
-						miBFCS.insertSaturation(*miBF, itr, m_nameToID[name]);
-					} else {
-						break;
-					}
-				}
-				kseq_destroy(seq);
-				gzclose(fp);
-			}
-		} else {
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				kseq_t *seq = kseq_init(fp);
-				int l;
-#pragma omp parallel private(l)
-				for (;;) {
-					string sequence, name;
-#pragma omp critical(seq)
-					{
-						l = kseq_read(seq);
-						if (l >= 0) {
-							sequence = string(seq->seq.s, seq->seq.l);
-							name = string(seq->name.s, seq->name.l);
-						}
-					}
-					if (l >= 0) {
-						H itr = hashIterator<H>(sequence, ssVal);
-						miBFCS.insertMIBF(*miBF, itr, m_nameToID[name]);
-					} else {
-						break;
-					}
-				}
-				kseq_destroy(seq);
-				gzclose(fp);
-			}
-			//apply saturation
-			if(opt::verbose){
-				cerr << "Applying saturation" << endl;
-			}
-			//another pass through references
-			//if target frame does not have a single representative, mark frame as saturated
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				kseq_t *seq = kseq_init(fp);
-				int l;
-#pragma omp parallel private(l)
-				for (;;) {
-					string sequence, name;
-#pragma omp critical(seq)
-					{
-						l = kseq_read(seq);
-						if (l >= 0) {
-							sequence = string(seq->seq.s, seq->seq.l);
-							name = string(seq->name.s, seq->name.l);
-						}
-					}
-					if (l >= 0) {
-						H itr = hashIterator<H>(sequence, ssVal);
-						miBFCS.insertSaturation(*miBF, itr, m_nameToID[name]);
-					} else {
-						break;
-					}
-				}
-				kseq_destroy(seq);
-				gzclose(fp);
-			}
+		forEachPiece([&](const string &sequence, ID id) {
+			H itr = hashIterator<H>(sequence, ssVal);
+			miBFCS.insertMIBF(*miBF, itr, id);
+		});
+		//apply saturation
+		if(opt::verbose){
+			cerr << "Applying saturation" << endl;
 		}
+		//another pass through references
+		//if target frame does not have a single representative, mark frame as saturated
+		forEachPiece([&](const string &sequence, ID id) {
+			H itr = hashIterator<H>(sequence, ssVal);
+			miBFCS.insertSaturation(*miBF, itr, id);
+		});
 
 		cerr << "Outputting IDs file: " << filePrefix + "_ids.txt" << endl;
 		std::ofstream idFile;
@@ -309,6 +199,62 @@ public:
 	}
 
 private:
+	/*
+	 * Counts the k-mers of a sequence into an estimate of distinct k-mers
+	 */
+	void addDistinct(HyperLogLog &distinct, const string &sequence) const {
+		for (ntHashIterator itr(sequence, 1, m_kmerSize); itr != itr.end();
+				++itr) {
+			distinct.add((*itr)[0]);
+		}
+	}
+
+	/*
+	 * Calls process(sequence, id) from all threads for each piece of sequence
+	 * in the files, with the ID of its file or record. Long records are split
+	 * into pieces (see ChunkedSeqReader) so they are hashed by several threads.
+	 */
+	template<typename F>
+	void forEachPiece(F process) {
+		for (unsigned i = 0; i < m_fileNames.size(); ++i) {
+			gzFile fp;
+			fp = gzopen(m_fileNames[i].c_str(), "r");
+			if (fp == NULL) {
+				cerr << "file " << m_fileNames[i] << " cannot be opened"
+						<< endl;
+				exit(1);
+			}
+			if (opt::verbose) {
+				cerr << "Opening " << m_fileNames[i] << endl;
+			}
+			const string fileName = m_fileNames[i].substr(
+					m_fileNames[i].find_last_of("/") + 1);
+			kseq_t *seq = kseq_init(fp);
+			ChunkedSeqReader reader(seq, m_kmerSize);
+#pragma omp parallel
+			{
+				string sequence, name;
+				for (;;) {
+					bool read;
+					ID id = 0;
+#pragma omp critical(seq)
+					{
+						read = reader.next(sequence, name);
+						if (read) {
+							id = m_nameToID[opt::idByFile ? fileName : name];
+						}
+					}
+					if (!read) {
+						break;
+					}
+					process(sequence, id);
+				}
+			}
+			kseq_destroy(seq);
+			gzclose(fp);
+		}
+	}
+
 	unsigned m_kmerSize;
 	size_t m_expectedEntries;
 	vector<string> m_fileNames;
@@ -326,79 +272,15 @@ private:
 			cerr << "Populating initial bit vector" << endl;
 
 		//populate sdsl bitvector (bloomFilter)
-		if (opt::idByFile) {
-#pragma omp parallel for schedule(dynamic)
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				if(opt::verbose){
-#pragma omp critical(stderr)
-					cerr << "Opening " << m_fileNames[i] << endl;
-				}
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				kseq_t *seq = kseq_init(fp);
-				int l;
-				size_t colliCounts = 0;
-				size_t totalCount = 0;
-				for (;;) {
-					string sequence;
-					{
-						l = kseq_read(seq);
-						if (l >= 0) {
-							sequence = string(seq->seq.s, seq->seq.l);
-						}
-					}
-					if (l >= 0) {
-						if (sequence.length() >= m_kmerSize) {
-							H itr = hashIterator<H>(sequence, ssVal);
-							colliCounts += miBFCS.insertBVColli(itr);
-							totalCount += sequence.length() - m_kmerSize + 1;
-						}
-					} else {
-						break;
-					}
-				}
+		forEachPiece([&](const string &sequence, ID) {
+			if (sequence.length() >= m_kmerSize) {
+				H itr = hashIterator<H>(sequence, ssVal);
+				size_t unique = sequence.length() - m_kmerSize + 1
+						- miBFCS.insertBVColli(itr);
 #pragma omp atomic
-				uniqueCounts += totalCount - colliCounts;
-				kseq_destroy(seq);
-				gzclose(fp);
-				if(opt::verbose){
-#pragma omp critical(stderr)
-					cerr << "Finished processing " << m_fileNames[i] << endl;
-				}
+				uniqueCounts += unique;
 			}
-		} else {
-			for (unsigned i = 0; i < m_fileNames.size(); ++i) {
-				gzFile fp;
-				fp = gzopen(m_fileNames[i].c_str(), "r");
-				kseq_t *seq = kseq_init(fp);
-				int l;
-				size_t colliCounts = 0;
-				size_t totalCount = 0;
-#pragma omp parallel private(l)
-				for (;;) {
-					string sequence;
-#pragma omp critical(seq)
-					{
-						l = kseq_read(seq);
-						if (l >= 0) {
-							sequence = string(seq->seq.s, seq->seq.l);
-						}
-					}
-					if (l >= 0) {
-						if (sequence.length() >= m_kmerSize) {
-							H itr = hashIterator<H>(sequence, ssVal);
-							colliCounts += miBFCS.insertBVColli(itr);
-							totalCount += sequence.length() - m_kmerSize + 1;
-						}
-					} else {
-						break;
-					}
-				}
-				uniqueCounts += totalCount - colliCounts;
-				kseq_destroy(seq);
-				gzclose(fp);
-			}
-		}
+		});
 
 		if (opt::verbose > 0) {
 			cerr << "Approximate number of unique frames in filter: "
@@ -0,0 +1,498 @@
+/*
+ * ManifestBuilder.hpp
+ *
+ * Builds every filter listed in a manifest (--manifest) in one run. Each
+ * non-empty line holds a filter ID, the filter to subtract ('-' for none) and
+ * the sequence files of the filter. Lines starting with '#' are ignored.
+ *
+ * Filters with the same sequence files are built together: the files are read
+ * and each k-mer is hashed once, then inserted into each of the filters. The
+ * files of up to one group per thread are open at once, each read by one
+ * thread at a time, so the threads decompress in parallel and stay busy
+ * however small each filter is. A filter is allocated when its files are first
+ * read and written once all of them have been loaded, so only the filters
+ * being loaded are kept in memory.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef MANIFESTBUILDER_HPP_
+#define MANIFESTBUILDER_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <zlib.h>
+#include <omp.h>
+#include "btl_bloomfilter/BloomFilter.hpp"
+#include "Common/BloomFilterInfo.h"
+#include "Common/HyperLogLog.hpp"
+#include "Common/ChunkedSeqReader.hpp"
+#include "Common/KmerLoader.hpp"
+#include "Common/Options.h"
+
+using namespace std;
+
+struct FilterJob {
+	string filterID;
+	//empty if nothing is subtracted
+	string subtractFilter;
+	vector<string> files;
+};
+
+static inline vector<FilterJob> loadBuildManifest(const string &fileName) {
+	vector<FilterJob> jobs;
+	ifstream manifest(fileName.c_str());
+	if (!manifest.is_open()) {
+		cerr << "Error: manifest " << fileName << " cannot be opened" << endl;
+		exit(1);
+	}
+	map<string, unsigned> ids;
+	string line;
+	for (unsigned lineNum = 1; getline(manifest, line); ++lineNum) {
+		stringstream ss(line);
+		FilterJob job;
+		if (!(ss >> job.filterID) || job.filterID[0] == '#') {
+			continue;
+		}
+		string file;
+		ss >> job.subtractFilter;
+		while (ss >> file) {
+			job.files.push_back(file);
+		}
+		if (job.files.empty()) {
+			cerr << "Error: line " << lineNum << " of manifest " << fileName
+					<< " should contain a filter ID, a filter to subtract (or"
+					<< " '-') and at least one sequence file" << endl;
+			exit(1);
+		}
+		if (job.filterID.find('/') != string::npos
+				|| !ids.insert(make_pair(job.filterID, lineNum)).second) {
+			cerr << "Error: filter ID on line " << lineNum << " of manifest "
+					<< fileName << " contains '/' or is used more than once"
+					<< endl;
+			exit(1);
+		}
+		if (job.subtractFilter == "-") {
+			job.subtractFilter.clear();
+		}
+		jobs.push_back(job);
+	}
+	if (jobs.empty()) {
+		cerr << "Error: manifest " << fileName << " contains no filters"
+				<< endl;
+		exit(1);
+	}
+	return jobs;
+}
+
+class ManifestBuilder {
+public:
+	/*
+	 * Filters are sized for entryNum k-mers, or for the distinct k-mers of
+	 * their files if entryNum is 0
+	 */
+	ManifestBuilder(const vector<FilterJob> &jobs, const string &outputDir,
+			unsigned kmerSize, unsigned hashNum, double fpr, size_t entryNum) :
+			m_jobs(jobs.size()), m_outputDir(outputDir), m_kmerSize(
+					kmerSize), m_hashNum(hashNum), m_fpr(fpr), m_entryNum(
+					entryNum), m_loading(false), m_nextGroup(0) {
+		map<vector<string>, size_t> groupOfFiles;
+		for (unsigned i = 0; i < jobs.size(); ++i) {
+			m_jobs[i].job = jobs[i];
+			map<vector<string>, size_t>::iterator group = groupOfFiles.insert(
+					make_pair(jobs[i].files, m_groups.size())).first;
+			if (group->second == m_groups.size()) {
+				m_groups.push_back(Group());
+				m_groups.back().files = jobs[i].files;
+			}
+			m_groups[group->second].jobs.push_back(i);
+		}
+	}
+
+	/*
+	 * Builds all filters, writing [filter ID].bf and [filter ID].txt to the
+	 * output directory
+	 */
+	void build() {
+		cerr << "Building " << m_jobs.size() << " filters from "
+				<< m_groups.size() << " sets of sequence files" << endl;
+		loadSubtractFilters();
+		if (m_entryNum == 0) {
+			run(false);
+		}
+		run(true);
+	}
+
+	~ManifestBuilder() {
+		for (map<string, BloomFilter*>::iterator i = m_subtract.begin();
+				i != m_subtract.end(); ++i) {
+			delete i->second;
+		}
+	}
+
+private:
+	struct JobState {
+		FilterJob job;
+		BloomFilter *filter;
+		const BloomFilter *subtract;
+		size_t expectedEntries;
+		size_t redundancy;
+		size_t total;
+		size_t removed;
+		JobState() :
+				filter(NULL), subtract(NULL), expectedEntries(0), redundancy(
+						0), total(0), removed(0) {
+		}
+	};
+
+	//filters built from the same files
+	struct Group {
+		vector<string> files;
+		vector<unsigned> jobs;
+		size_t positions;
+		HyperLogLog distinct;
+		size_t distinctEstimate;
+		double distinctError;
+		//batches taken from the files but not yet loaded
+		size_t inFlight;
+		//all files of the group have been read
+		bool read;
+		Group() :
+				positions(0), distinctEstimate(0), distinctError(0), inFlight(
+						0), read(false) {
+		}
+	};
+
+	//files of one group being read, by one thread at a time
+	struct Stream {
+		omp_lock_t lock;
+		size_t group;
+		unsigned file;
+		gzFile fp;
+		kseq_t *seq;
+		ChunkedSeqReader *reader;
+		//threads reading or waiting to read the stream
+		unsigned users;
+		//no groups are left to read
+		bool done;
+		Stream() :
+				group(0), file(0), fp(Z_NULL), seq(NULL), reader(NULL), users(
+						0), done(false) {
+		}
+	};
+
+	vector<JobState> m_jobs;
+	vector<Group> m_groups;
+	string m_outputDir;
+	unsigned m_kmerSize;
+	unsigned m_hashNum;
+	double m_fpr;
+	size_t m_entryNum;
+	map<string, BloomFilter*> m_subtract;
+	//inserting k-mers rather than counting them
+	bool m_loading;
+
+	//next group to read
+	size_t m_nextGroup;
+	vector<Stream> m_streams;
+
+	void loadSubtractFilters() {
+		for (vector<JobState>::iterator i = m_jobs.begin(); i != m_jobs.end();
+				++i) {
+			const string &fileName = i->job.subtractFilter;
+			if (fileName.empty()) {
+				continue;
+			}
+			if (m_subtract.find(fileName) == m_subtract.end()) {
+				BloomFilter *filter = new BloomFilter(fileName);
+				if (filter->getHashNum() != m_hashNum
+						|| filter->getKmerSize() != m_kmerSize) {
+					cerr << "Error: Subtraction filter " << fileName
+							<< " must have the same k-mer size and number of"
+							<< " hash functions as the filters being built"
+							<< endl;
+					exit(1);
+				}
+				m_subtract[fileName] = filter;
+			}
+			i->subtract = m_subtract[fileName];
+		}
+	}
+
+	/*
+	 * Passes over the files of all groups, counting distinct k-mers or
+	 * loading them into the filters
+	 */
+	void run(bool loading) {
+		m_loading = loading;
+		m_nextGroup = 0;
+		for (unsigned i = 0; i < m_groups.size(); ++i) {
+			m_groups[i].read = false;
+		}
+		m_streams = vector<Stream>(
+				max(min(size_t(omp_get_max_threads()), m_groups.size()),
+						size_t(1)));
+		for (unsigned i = 0; i < m_streams.size(); ++i) {
+			omp_init_lock(&m_streams[i].lock);
+		}
+#pragma omp parallel
+		{
+			vector<string> buffers;
+			vector<uint64_t> hashes(
+					size_t(KmerLoader::s_hashBatch) * m_hashNum);
+			HyperLogLog distinct;
+			vector<size_t> finished;
+			for (;;) {
+				Stream *stream;
+#pragma omp critical(manifestRead)
+				stream = pickStream();
+				if (stream == NULL) {
+					break;
+				}
+				size_t group = 0;
+				omp_set_lock(&stream->lock);
+				unsigned count = nextBatch(*stream, buffers, group, finished);
+				omp_unset_lock(&stream->lock);
+#pragma omp critical(manifestRead)
+				{
+					--stream->users;
+					stream->done |= count == 0;
+				}
+				for (unsigned i = 0; i < finished.size(); ++i) {
+					finishGroup(finished[i]);
+				}
+				finished.clear();
+				if (count == 0) {
+					continue;
+				}
+				if (loading) {
+					loadBatch(m_groups[group], buffers, count, hashes);
+				} else {
+					countBatch(m_groups[group], buffers, count, distinct);
+				}
+				bool last;
+#pragma omp critical(manifestRead)
+				last = --m_groups[group].inFlight == 0 && m_groups[group].read;
+				if (last) {
+					finishGroup(group);
+				}
+			}
+		}
+		for (unsigned i = 0; i < m_streams.size(); ++i) {
+			omp_destroy_lock(&m_streams[i].lock);
+		}
+	}
+
+	/*
+	 * Returns the stream with the fewest threads using it, NULL once all
+	 * groups are read.
+	 * Must be called in critical(manifestRead).
+	 */
+	Stream *pickStream() {
+		Stream *best = NULL;
+		for (unsigned i = 0; i < m_streams.size(); ++i) {
+			Stream &stream = m_streams[i];
+			if (!stream.done && (best == NULL || stream.users < best->users)) {
+				best = &stream;
+			}
+		}
+		if (best != NULL) {
+			++best->users;
+		}
+		return best;
+	}
+
+	/*
+	 * Reads the next batch of sequence of a stream into buffers, setting group
+	 * to the group it is from and moving the stream on to the next group once
+	 * the files of its group are read. Groups whose files were all read with
+	 * no batch left to load are added to finished. Returns the number of
+	 * sequences read, 0 once no groups are left.
+	 * Must be called holding the lock of the stream.
+	 */
+	unsigned nextBatch(Stream &stream, vector<string> &buffers, size_t &group,
+			vector<size_t> &finished) {
+		for (;;) {
+			if (stream.reader == NULL) {
+				if (stream.done) {
+					return 0;
+				}
+				bool claimed;
+#pragma omp critical(manifestRead)
+				{
+					claimed = m_nextGroup < m_groups.size();
+					if (claimed) {
+						stream.group = m_nextGroup++;
+					}
+				}
+				if (!claimed) {
+					return 0;
+				}
+				stream.file = 0;
+				if (m_loading) {
+					startGroup(m_groups[stream.group]);
+				}
+				openFile(stream, m_groups[stream.group].files[0]);
+			}
+			Group &current = m_groups[stream.group];
+			unsigned count = KmerLoader::readBatch(*stream.reader, buffers);
+			if (count > 0) {
+				group = stream.group;
+#pragma omp critical(manifestRead)
+				++current.inFlight;
+				return count;
+			}
+			closeFile(stream);
+			if (++stream.file < current.files.size()) {
+				openFile(stream, current.files[stream.file]);
+				continue;
+			}
+#pragma omp critical(manifestRead)
+			{
+				current.read = true;
+				if (current.inFlight == 0) {
+					finished.push_back(stream.group);
+				}
+			}
+		}
+	}
+
+	void openFile(Stream &stream, const string &fileName) {
+		stream.fp = gzopen(fileName.c_str(), "r");
+		if (stream.fp == Z_NULL) {
+			cerr << "file " << fileName << " cannot be opened" << endl;
+			exit(1);
+		}
+		stream.seq = kseq_init(stream.fp);
+		stream.reader = new ChunkedSeqReader(stream.seq, m_kmerSize);
+	}
+
+	void closeFile(Stream &stream) {
+		delete stream.reader;
+		stream.reader = NULL;
+		kseq_destroy(stream.seq);
+		gzclose(stream.fp);
+	}
+
+	/*
+	 * Allocates the filters of a group
+	 */
+	void startGroup(Group &group) {
+		for (unsigned i = 0; i < group.jobs.size(); ++i) {
+			JobState &state = m_jobs[group.jobs[i]];
+			state.expectedEntries =
+					m_entryNum > 0 ?
+							m_entryNum :
+							max(KmerLoader::expectedEntries(group.positions,
+									group.distinct, m_kmerSize,
+									opt::syncmerSize), size_t(1));
+			state.filter = new BloomFilter(createInfo(state).getCalcuatedFilterSize(),
+					m_hashNum, m_kmerSize);
+		}
+	}
+
+	BloomFilterInfo createInfo(const JobState &state) const {
+		BloomFilterInfo info(state.job.filterID, m_kmerSize, m_hashNum, m_fpr,
+				state.expectedEntries, state.job.files);
+		info.setSyncmerSize(opt::syncmerSize);
+		return info;
+	}
+
+	void countBatch(Group &group, const vector<string> &buffers,
+			unsigned count, HyperLogLog &distinct) {
+		size_t positions = 0;
+		distinct = HyperLogLog();
+		KmerLoader::countBatch(buffers, count, m_kmerSize, positions,
+				distinct);
+#pragma omp atomic
+		group.positions += positions;
+#pragma omp critical(distinct)
+		group.distinct.merge(distinct);
+	}
+
+	/*
+	 * Hashes the k-mers of a batch once, inserting them into every filter of
+	 * the group that does not subtract them
+	 */
+	void loadBatch(Group &group, const vector<string> &buffers, unsigned count,
+			vector<uint64_t> &hashes) {
+		vector<size_t> redundancy(group.jobs.size(), 0);
+		vector<size_t> total(group.jobs.size(), 0);
+		vector<size_t> removed(group.jobs.size(), 0);
+		for (unsigned i = 0; i < count; ++i) {
+			KmerLoader::hashBatches(buffers[i], m_kmerSize, m_hashNum,
+					opt::syncmerSize, hashes,
+					[&](const uint64_t *batch, unsigned batched) {
+						for (unsigned j = 0; j < group.jobs.size(); ++j) {
+							JobState &state = m_jobs[group.jobs[j]];
+							for (unsigned k = 0; k < batched; ++k) {
+								const uint64_t *kmerHashes = &batch[k
+										* m_hashNum];
+								if (state.subtract != NULL
+										&& state.subtract->contains(
+												kmerHashes)) {
+									++removed[j];
+									continue;
+								}
+								bool found = state.filter->insertAndCheck(
+										kmerHashes);
+								redundancy[j] += found;
+								total[j] += !found;
+							}
+						}
+					});
+		}
+		for (unsigned j = 0; j < group.jobs.size(); ++j) {
+			JobState &state = m_jobs[group.jobs[j]];
+#pragma omp atomic
+			state.redundancy += redundancy[j];
+#pragma omp atomic
+			state.total += total[j];
+#pragma omp atomic
+			state.removed += removed[j];
+		}
+	}
+
+	/*
+	 * Called once all batches of a group are counted or loaded. Writes and
+	 * frees the filters of the group after loading.
+	 */
+	void finishGroup(size_t index) {
+		Group &group = m_groups[index];
+		if (!m_loading) {
+			group.distinctEstimate = size_t(group.distinct.estimate() + 0.5);
+			group.distinctError = group.distinct.relativeError();
+			return;
+		}
+		for (unsigned i = 0; i < group.jobs.size(); ++i) {
+			JobState &state = m_jobs[group.jobs[i]];
+			state.filter->storeFilter(
+					m_outputDir + state.job.filterID + ".bf");
+			BloomFilterInfo info = createInfo(state);
+			if (group.distinctEstimate > 0) {
+				info.setDistinctEstimate(group.distinctEstimate,
+						group.distinctError);
+			}
+			info.setTotalNum(state.total);
+			info.setRedundancy(state.redundancy);
+			info.printInfoFile(m_outputDir + state.job.filterID + ".txt");
+			delete state.filter;
+			state.filter = NULL;
+			stringstream message;
+			message << "Built " << state.job.filterID << ": " << state.total
+					<< " k-mers";
+			if (state.subtract != NULL) {
+				message << ", " << state.removed << " subtracted";
+			}
+			message << ", FPR " << info.getFPR() << "\n";
+			cerr << message.str() << flush;
+		}
+	}
+};
+
+#endif /* MANIFESTBUILDER_HPP_ */
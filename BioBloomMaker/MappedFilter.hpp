@@ -0,0 +1,146 @@
+/*
+ * MappedFilter.hpp
+ *
+ * A filter file mapped into memory so its bits can be set in place
+ * (--append). Only the pages holding the bits looked up or set are read and
+ * written back, so updating a filter takes time proportional to the new
+ * k-mers rather than to the size of the filter. Bit i of the filter is bit
+ * i % 8 of byte i / 8, as in BloomFilter.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef MAPPEDFILTER_HPP_
+#define MAPPEDFILTER_HPP_
+
+#include <string>
+#include <iostream>
+#include <cstdlib>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "btl_bloomfilter/BloomFilter.hpp"
+
+using namespace std;
+
+class MappedFilter {
+public:
+	explicit MappedFilter(const string &fileName) :
+			m_fileName(fileName), m_length(0), m_header(NULL), m_bits(NULL) {
+		m_fd = open(fileName.c_str(), O_RDWR);
+		if (m_fd < 0) {
+			cerr << "Error: Could not open " << fileName << endl;
+			exit(1);
+		}
+		struct stat fileStat;
+		if (fstat(m_fd, &fileStat) != 0
+				|| size_t(fileStat.st_size) < sizeof(BloomFilter::FileHeader)) {
+			invalid();
+		}
+		m_length = fileStat.st_size;
+		void *map = mmap(NULL, m_length, PROT_READ | PROT_WRITE, MAP_SHARED,
+				m_fd, 0);
+		if (map == MAP_FAILED) {
+			cerr << "Error: Could not map " << fileName << " into memory"
+					<< endl;
+			exit(1);
+		}
+		m_header = static_cast<BloomFilter::FileHeader*>(map);
+		if (m_header->hlen != sizeof(BloomFilter::FileHeader)
+				|| m_length
+						< sizeof(BloomFilter::FileHeader)
+								+ (m_header->size + 7) / 8) {
+			invalid();
+		}
+		m_bits = static_cast<uint8_t*>(map) + sizeof(BloomFilter::FileHeader);
+	}
+
+	const string &getFileName() const {
+		return m_fileName;
+	}
+
+	unsigned getHashNum() const {
+		return m_header->nhash;
+	}
+
+	unsigned getKmerSize() const {
+		return m_header->kmer;
+	}
+
+	size_t getFilterSize() const {
+		return m_header->size;
+	}
+
+	bool contains(const uint64_t *hashes) const {
+		for (unsigned i = 0; i < m_header->nhash; ++i) {
+			uint64_t pos = hashes[i] % m_header->size;
+			if ((m_bits[pos / 8] & (uint8_t(1) << (pos % 8))) == 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+	 * Sets the bits of a k-mer, returning true if they were all set already.
+	 * Thread safe, as each bit is set with an atomic fetch-or.
+	 */
+	bool insertAndCheck(const uint64_t *hashes) {
+		bool found = true;
+		for (unsigned i = 0; i < m_header->nhash; ++i) {
+			uint64_t pos = hashes[i] % m_header->size;
+			uint8_t mask = uint8_t(1) << (pos % 8);
+			found &= (__sync_fetch_and_or(&m_bits[pos / 8], mask) & mask) != 0;
+		}
+		return found;
+	}
+
+	/*
+	 * Records the FPR and number of entries of the filter in its header
+	 */
+	void setStats(double fpr, uint64_t entries) {
+		m_header->dFPR = fpr;
+		m_header->nEntry = entries;
+		m_header->tEntry = entries;
+	}
+
+	/*
+	 * Writes the changed pages back to the file and unmaps it
+	 */
+	void close() {
+		if (m_header == NULL) {
+			return;
+		}
+		if (msync(m_header, m_length, MS_SYNC) != 0) {
+			cerr << "Error: Could not write to " << m_fileName << endl;
+			exit(1);
+		}
+		munmap(m_header, m_length);
+		::close(m_fd);
+		m_header = NULL;
+		m_bits = NULL;
+	}
+
+	~MappedFilter() {
+		close();
+	}
+
+private:
+	string m_fileName;
+	int m_fd;
+	size_t m_length;
+	BloomFilter::FileHeader *m_header;
+	uint8_t *m_bits;
+
+	MappedFilter(const MappedFilter &that);
+
+	void invalid() const {
+		cerr << "Error: " << m_fileName << " does not have a valid filter header"
+				<< endl;
+		exit(1);
+	}
+};
+
+#endif /* MAPPEDFILTER_HPP_ */
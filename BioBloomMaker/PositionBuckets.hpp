@@ -0,0 +1,192 @@
+/*
+ * PositionBuckets.hpp
+ *
+ * On-disk buckets of the bit positions of a filter too large to build in
+ * memory (--max_mem). The filter is cut into regions, and each position set
+ * by a k-mer is appended to the file of its region as a 32-bit offset into
+ * the region. The bits of one region at a time are then set from its file.
+ * Each thread keeps a buffer for every bucket, so files are written in large
+ * blocks.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef POSITIONBUCKETS_HPP_
+#define POSITIONBUCKETS_HPP_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+using namespace std;
+
+class PositionBuckets {
+public:
+	//offsets in each bucket buffer of a thread
+	typedef vector<vector<uint32_t> > Buffer;
+
+	//most bucket files open at once
+	static const size_t s_maxRegions = 1000;
+
+	/*
+	 * Bucket files are named [prefix]_bucket[region].bin. Regions have at most
+	 * maxRegionBits bits (rounded down to a multiple of 64), and at most 2^32
+	 * so offsets fit in 32 bits.
+	 */
+	PositionBuckets(const string &prefix, size_t filterSize,
+			size_t maxRegionBits, size_t bufferEntries) :
+			m_prefix(prefix), m_filterSize(filterSize), m_bufferEntries(
+					bufferEntries) {
+		maxRegionBits = min(maxRegionBits, size_t(1) << 32);
+		maxRegionBits = max(maxRegionBits - maxRegionBits % 64, size_t(64));
+		size_t regions = (filterSize + maxRegionBits - 1) / maxRegionBits;
+		m_regionBits = (filterSize + regions - 1) / regions;
+		m_regionBits += (64 - m_regionBits % 64) % 64;
+		regions = (filterSize + m_regionBits - 1) / m_regionBits;
+		if (regions > s_maxRegions) {
+			cerr << "Error: The filter would be built in " << regions
+					<< " regions, more than the " << s_maxRegions
+					<< " allowed. Increase --max_mem." << endl;
+			exit(1);
+		}
+		for (size_t i = 0; i < regions; ++i) {
+			FILE *file = fopen(fileName(i).c_str(), "wb");
+			if (file == NULL) {
+				cerr << "Error: Could not open " << fileName(i) << endl;
+				exit(1);
+			}
+			m_files.push_back(file);
+		}
+	}
+
+	size_t getRegions() const {
+		return m_files.size();
+	}
+
+	/*
+	 * Size in bits of a region (the last one can be smaller)
+	 */
+	size_t getRegionBits(size_t region) const {
+		return min(m_regionBits, m_filterSize - region * m_regionBits);
+	}
+
+	Buffer createBuffer() const {
+		return Buffer(m_files.size());
+	}
+
+	inline void add(Buffer &buffer, uint64_t pos) {
+		size_t region = pos / m_regionBits;
+		buffer[region].push_back(uint32_t(pos - region * m_regionBits));
+		if (buffer[region].size() == m_bufferEntries) {
+			flush(buffer, region);
+		}
+	}
+
+	/*
+	 * Writes out all buffered offsets of a thread
+	 */
+	void flush(Buffer &buffer) {
+		for (size_t i = 0; i < buffer.size(); ++i) {
+			flush(buffer, i);
+		}
+	}
+
+	/*
+	 * Closes the bucket files once all threads have flushed their buffers
+	 */
+	void close() {
+		for (size_t i = 0; i < m_files.size(); ++i) {
+			if (m_files[i] != NULL && fclose(m_files[i]) != 0) {
+				cerr << "Error: Could not write to " << fileName(i) << endl;
+				exit(1);
+			}
+			m_files[i] = NULL;
+		}
+	}
+
+	/*
+	 * Sets the bits of a region from its bucket, removing the bucket file.
+	 * words must hold the region and be zeroed. Bit i of the region is bit
+	 * i % 64 of word i / 64, as in the bytes of a filter on a little endian
+	 * machine.
+	 */
+	void fill(size_t region, vector<uint64_t> &words) const {
+		FILE *file = fopen(fileName(region).c_str(), "rb");
+		if (file == NULL) {
+			cerr << "Error: Could not open " << fileName(region) << endl;
+			exit(1);
+		}
+#pragma omp parallel
+		{
+			vector<uint32_t> block(s_readBlock);
+			for (;;) {
+				size_t count;
+#pragma omp critical(bucketRead)
+				count = fread(block.data(), sizeof(uint32_t), block.size(),
+						file);
+				if (count == 0) {
+					break;
+				}
+				for (size_t i = 0; i < count; ++i) {
+					__sync_fetch_and_or(&words[block[i] / 64],
+							uint64_t(1) << (block[i] % 64));
+				}
+			}
+		}
+		if (ferror(file)) {
+			cerr << "Error: Could not read " << fileName(region) << endl;
+			exit(1);
+		}
+		fclose(file);
+		remove(fileName(region).c_str());
+	}
+
+	~PositionBuckets() {
+		for (size_t i = 0; i < m_files.size(); ++i) {
+			if (m_files[i] != NULL) {
+				fclose(m_files[i]);
+			}
+			remove(fileName(i).c_str());
+		}
+	}
+
+private:
+	//offsets read from a bucket at once
+	static const size_t s_readBlock = 1 << 20;
+
+	string m_prefix;
+	size_t m_filterSize;
+	size_t m_regionBits;
+	size_t m_bufferEntries;
+	vector<FILE*> m_files;
+
+	string fileName(size_t region) const {
+		stringstream name;
+		name << m_prefix << "_bucket" << region << ".bin";
+		return name.str();
+	}
+
+	void flush(Buffer &buffer, size_t region) {
+		vector<uint32_t> &offsets = buffer[region];
+		if (offsets.empty()) {
+			return;
+		}
+#pragma omp critical(bucketWrite)
+		{
+			if (fwrite(offsets.data(), sizeof(uint32_t), offsets.size(),
+					m_files[region]) != offsets.size()) {
+				cerr << "Error: Could not write to " << fileName(region)
+						<< endl;
+				exit(1);
+			}
+		}
+		offsets.clear();
+	}
+};
+
+#endif /* POSITIONBUCKETS_HPP_ */
@@ -0,0 +1,224 @@
+/*
+ * ReadSpill.hpp
+ *
+ * File of the read pairs a progressive build has not recruited yet, so later
+ * iterations read it instead of decompressing and parsing the input again.
+ * Bases are packed in 2 bits each, with the positions of other characters
+ * (e.g. N) stored separately. Lower case bases are packed as upper case ones,
+ * and the runs of lower case bases are stored separately. Names and quality
+ * values are only kept when reads are printed.
+ *
+ * Each read is stored as its length, the number of other characters, the
+ * number of lower case runs, the packed bases, the (position, character) of
+ * each other character, the (start, length) of each lower case run and, if
+ * kept, the lengths and characters of the name and quality values.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef READSPILL_HPP_
+#define READSPILL_HPP_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+using namespace std;
+
+class ReadSpillWriter {
+public:
+	ReadSpillWriter(const string &fileName, bool keepNames) :
+			m_fileName(fileName), m_keepNames(keepNames), m_pairs(0) {
+		m_file = fopen(fileName.c_str(), "wb");
+		if (m_file == NULL) {
+			cerr << "Error: Could not open " << fileName << endl;
+			exit(1);
+		}
+		setvbuf(m_file, NULL, _IOFBF, s_bufferSize);
+	}
+
+	/*
+	 * Thread safe: pairs are encoded by the calling thread and written in one
+	 * call
+	 */
+	void writePair(const string &header1, const string &seq1,
+			const string &qual1, const string &header2, const string &seq2,
+			const string &qual2) {
+		vector<char> buffer;
+		encode(buffer, header1, seq1, qual1);
+		encode(buffer, header2, seq2, qual2);
+#pragma omp critical(readSpill)
+		{
+			if (fwrite(buffer.data(), 1, buffer.size(), m_file)
+					!= buffer.size()) {
+				cerr << "Error: Could not write to " << m_fileName << endl;
+				exit(1);
+			}
+			++m_pairs;
+		}
+	}
+
+	size_t getPairs() const {
+		return m_pairs;
+	}
+
+	~ReadSpillWriter() {
+		fclose(m_file);
+	}
+
+private:
+	static const size_t s_bufferSize = 1 << 20;
+
+	string m_fileName;
+	bool m_keepNames;
+	size_t m_pairs;
+	FILE *m_file;
+
+	static void append(vector<char> &buffer, uint32_t value) {
+		const char *bytes = reinterpret_cast<const char*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+	}
+
+	void encode(vector<char> &buffer, const string &header, const string &seq,
+			const string &qual) const {
+		vector<uint32_t> others;
+		//start and end of each run of lower case bases
+		vector<uint32_t> lowerRuns;
+		vector<char> packed((seq.length() + 3) / 4, 0);
+		for (size_t i = 0; i < seq.length(); ++i) {
+			unsigned code;
+			//upper and lower case letters differ only in bit 0x20
+			switch (seq[i] | 0x20) {
+			case 'a':
+				code = 0;
+				break;
+			case 'c':
+				code = 1;
+				break;
+			case 'g':
+				code = 2;
+				break;
+			case 't':
+				code = 3;
+				break;
+			default:
+				others.push_back(i);
+				continue;
+			}
+			if (seq[i] & 0x20) {
+				if (!lowerRuns.empty() && lowerRuns.back() == i) {
+					++lowerRuns.back();
+				} else {
+					lowerRuns.push_back(i);
+					lowerRuns.push_back(i + 1);
+				}
+			}
+			packed[i / 4] |= char(code << (2 * (i % 4)));
+		}
+		append(buffer, seq.length());
+		append(buffer, others.size());
+		append(buffer, lowerRuns.size() / 2);
+		buffer.insert(buffer.end(), packed.begin(), packed.end());
+		for (vector<uint32_t>::const_iterator i = others.begin();
+				i != others.end(); ++i) {
+			append(buffer, *i);
+			buffer.push_back(seq[*i]);
+		}
+		for (size_t i = 0; i < lowerRuns.size(); i += 2) {
+			append(buffer, lowerRuns[i]);
+			append(buffer, lowerRuns[i + 1] - lowerRuns[i]);
+		}
+		if (m_keepNames) {
+			append(buffer, header.length());
+			buffer.insert(buffer.end(), header.begin(), header.end());
+			append(buffer, qual.length());
+			buffer.insert(buffer.end(), qual.begin(), qual.end());
+		}
+	}
+};
+
+class ReadSpillReader {
+public:
+	ReadSpillReader(const string &fileName, bool keepNames) :
+			m_fileName(fileName), m_keepNames(keepNames) {
+		m_file = fopen(fileName.c_str(), "rb");
+		if (m_file == NULL) {
+			cerr << "Error: Could not open " << fileName << endl;
+			exit(1);
+		}
+		setvbuf(m_file, NULL, _IOFBF, s_bufferSize);
+	}
+
+	/*
+	 * Reads the next read into header, seq and qual (header and qual are left
+	 * empty if names were not kept). Returns false at the end of the file.
+	 * Not thread safe.
+	 */
+	bool read(string &header, string &seq, string &qual) {
+		uint32_t length;
+		if (fread(&length, sizeof(length), 1, m_file) != 1) {
+			return false;
+		}
+		uint32_t otherCount = readValue();
+		uint32_t lowerRunCount = readValue();
+		m_packed.resize((length + 3) / 4);
+		readBytes(m_packed.data(), m_packed.size());
+		static const char bases[] = { 'A', 'C', 'G', 'T' };
+		seq.resize(length);
+		for (uint32_t i = 0; i < length; ++i) {
+			seq[i] = bases[(m_packed[i / 4] >> (2 * (i % 4))) & 3];
+		}
+		for (uint32_t i = 0; i < otherCount; ++i) {
+			uint32_t pos = readValue();
+			char c;
+			readBytes(&c, 1);
+			seq[pos] = c;
+		}
+		for (uint32_t i = 0; i < lowerRunCount; ++i) {
+			uint32_t start = readValue();
+			uint32_t end = start + readValue();
+			for (uint32_t j = start; j < end; ++j) {
+				seq[j] |= 0x20;
+			}
+		}
+		header.clear();
+		qual.clear();
+		if (m_keepNames) {
+			header.resize(readValue());
+			readBytes(&header[0], header.length());
+			qual.resize(readValue());
+			readBytes(&qual[0], qual.length());
+		}
+		return true;
+	}
+
+	~ReadSpillReader() {
+		fclose(m_file);
+	}
+
+private:
+	static const size_t s_bufferSize = 1 << 20;
+
+	string m_fileName;
+	bool m_keepNames;
+	FILE *m_file;
+	vector<unsigned char> m_packed;
+
+	void readBytes(void *dest, size_t bytes) {
+		if (bytes > 0 && fread(dest, 1, bytes, m_file) != bytes) {
+			cerr << "Error: " << m_fileName << " is truncated" << endl;
+			exit(1);
+		}
+	}
+
+	uint32_t readValue() {
+		uint32_t value;
+		readBytes(&value, sizeof(value));
+		return value;
+	}
+};
+
+#endif /* READSPILL_HPP_ */
@@ -18,10 +18,12 @@ BloomFilterInfo::BloomFilterInfo(string const &filterID, unsigned kmerSize, unsi
 		const vector<string> &seqSrcs) :
 		m_filterID(filterID), m_kmerSize(kmerSize), m_desiredFPR(desiredFPR), m_seqSrcs(
 				seqSrcs), m_hashNum(hashNum), m_expectedNumEntries(
-				expectedNumEntries)
+				expectedNumEntries), m_syncmerSize(0), m_sampleRate(0)
 {
 	m_runInfo.size = calcOptimalSize(expectedNumEntries, desiredFPR, hashNum);
 	m_runInfo.redundantSequences = 0;
+	m_runInfo.distinctEstimate = 0;
+	m_runInfo.distinctError = 0;
 }
 
 /*
@@ -38,6 +40,9 @@ BloomFilterInfo::BloomFilterInfo(string const &fileName)
 	string tempSeqSrcs = pt.get<string>("user_input_options.sequence_sources");
 	m_seqSrcs = convertSeqSrcString(tempSeqSrcs);
 	m_hashNum = pt.get<unsigned>("user_input_options.number_of_hash_functions");
+	//absent in filters made before sampled filters existed
+	m_syncmerSize = pt.get<unsigned>("user_input_options.syncmer_size", 0);
+	m_sampleRate = pt.get<unsigned>("user_input_options.sample_rate", 0);
 
 	//runtime params
 	m_runInfo.size = pt.get<size_t>("runtime_options.size");
@@ -50,6 +55,10 @@ BloomFilterInfo::BloomFilterInfo(string const &fileName)
 			"user_input_options.expected_num_entries");
 	m_runInfo.FPR = pt.get<double>(
 			"runtime_options.approximate_false_positive_rate");
+	m_runInfo.distinctEstimate = pt.get<size_t>(
+			"runtime_options.distinct_kmer_estimate", 0);
+	m_runInfo.distinctError = pt.get<double>(
+			"runtime_options.distinct_kmer_error", 0);
 }
 
 /**
@@ -74,6 +83,92 @@ void BloomFilterInfo::setTotalNum(size_t totalNum)
 	m_runInfo.numEntries = totalNum;
 }
 
+/*
+ * Records that only syncmers of this length were inserted
+ */
+void BloomFilterInfo::setSyncmerSize(unsigned syncmerSize)
+{
+	m_syncmerSize = syncmerSize;
+}
+
+/*
+ * Records that only 1 in sampleRate k-mers were inserted (see
+ * SeqEval::inPrescreenSample)
+ */
+void BloomFilterInfo::setSampleRate(unsigned sampleRate)
+{
+	m_sampleRate = sampleRate;
+}
+
+/*
+ * Overrides the calculated filter size
+ */
+void BloomFilterInfo::setFilterSize(size_t size)
+{
+	m_runInfo.size = size;
+}
+
+/*
+ * Sets size and FPR of a filter whose bits were not set by inserting k-mers
+ * (e.g. combined from other filters) from its number of set bits. The number
+ * of entries is estimated from the fraction of bits set.
+ */
+void BloomFilterInfo::setPopcount(size_t size, size_t popcount)
+{
+	assert(popcount < size);
+	m_runInfo.size = size;
+	m_runInfo.numEntries = calcEntriesFromPop(size, popcount, m_hashNum);
+	m_runInfo.FPR = pow(double(popcount) / double(size), double(m_hashNum));
+	m_runInfo.redundantSequences = 0;
+	m_runInfo.redundantFPR = 0;
+}
+
+/*
+ * Records the estimated number of distinct k-mers the filter was sized for and
+ * the relative standard error of the estimate
+ */
+void BloomFilterInfo::setDistinctEstimate(size_t estimate, double error)
+{
+	m_runInfo.distinctEstimate = estimate;
+	m_runInfo.distinctError = error;
+}
+
+/*
+ * Records k-mers appended to the filter from more sequence files. The
+ * redundancy FPR is extended over the new entries only, so the time taken
+ * does not depend on the number already in the filter. The distinct k-mer
+ * estimate the filter was sized from is dropped, as it no longer applies.
+ */
+void BloomFilterInfo::addEntries(size_t entries, size_t redunSeq,
+		const vector<string> &seqSrc)
+{
+	size_t oldEntries = m_runInfo.numEntries;
+	double total = m_runInfo.redundantFPR * double(oldEntries);
+	for (size_t i = max(oldEntries, size_t(1)); i < oldEntries + entries;
+			++i) {
+		total += calcApproxFPR(m_runInfo.size, i, m_hashNum);
+	}
+	m_runInfo.numEntries += entries;
+	m_runInfo.redundantSequences += redunSeq;
+	if (m_runInfo.numEntries > 0) {
+		m_runInfo.redundantFPR = total / double(m_runInfo.numEntries);
+	}
+	m_runInfo.FPR = calcApproxFPR(m_runInfo.size, m_runInfo.numEntries,
+			m_hashNum);
+	m_seqSrcs.insert(m_seqSrcs.end(), seqSrc.begin(), seqSrc.end());
+	m_runInfo.distinctEstimate = 0;
+	m_runInfo.distinctError = 0;
+}
+
+/*
+ * FPR the filter would have after inserting newEntries more k-mers
+ */
+double BloomFilterInfo::projectFPR(size_t newEntries) const
+{
+	return calcApproxFPR(m_runInfo.size, m_runInfo.numEntries + newEntries,
+			m_hashNum);
+}
+
 /*
  * Prints out INI format file
  */
@@ -93,8 +188,14 @@ void BloomFilterInfo::printInfoFile(const string &fileName) const
 	output << "[user_input_options]\nfilter_id=" << m_filterID << "\nkmer_size="
 			<< m_kmerSize << "\ndesired_false_positve_rate=" << m_desiredFPR
 			<< "\nnumber_of_hash_functions=" << m_hashNum
-			<< "\nexpected_num_entries=" << m_expectedNumEntries
-			<< "\nsequence_sources=";
+			<< "\nexpected_num_entries=" << m_expectedNumEntries;
+	if (m_syncmerSize > 0) {
+		output << "\nsyncmer_size=" << m_syncmerSize;
+	}
+	if (m_sampleRate > 0) {
+		output << "\nsample_rate=" << m_sampleRate;
+	}
+	output << "\nsequence_sources=";
 
 	//print out sources as a list
 	for (vector<string>::const_iterator it = m_seqSrcs.begin();
@@ -110,6 +211,10 @@ void BloomFilterInfo::printInfoFile(const string &fileName) const
 			<< m_runInfo.FPR << "\nredundant_sequences="
 			<< m_runInfo.redundantSequences << "\nredundant_fpr="
 			<< m_runInfo.redundantFPR << "\n";
+	if (m_runInfo.distinctEstimate > 0) {
+		output << "distinct_kmer_estimate=" << m_runInfo.distinctEstimate
+				<< "\ndistinct_kmer_error=" << m_runInfo.distinctError << "\n";
+	}
 	//print out hash functions as a list
 
 	output.close();
@@ -147,6 +252,26 @@ double BloomFilterInfo::getFPR() const
 	return m_runInfo.FPR;
 }
 
+unsigned BloomFilterInfo::getSyncmerSize() const
+{
+	return m_syncmerSize;
+}
+
+unsigned BloomFilterInfo::getSampleRate() const
+{
+	return m_sampleRate;
+}
+
+size_t BloomFilterInfo::getTotalNum() const
+{
+	return m_runInfo.numEntries;
+}
+
+double BloomFilterInfo::getDesiredFPR() const
+{
+	return m_desiredFPR;
+}
+
 const vector<string> BloomFilterInfo::convertSeqSrcString(
 		string const &seqSrcStr) const
 {
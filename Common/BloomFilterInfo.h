@@ -35,6 +35,14 @@ public:
 	void addHashFunction(const string &fnName, size_t seed);
 	void setRedundancy(size_t redunSeq);
 	void setTotalNum(size_t totalNum);
+	void setSyncmerSize(unsigned syncmerSize);
+	void setSampleRate(unsigned sampleRate);
+	void setFilterSize(size_t size);
+	void setPopcount(size_t size, size_t popcount);
+	void setDistinctEstimate(size_t estimate, double error);
+	void addEntries(size_t entries, size_t redunSeq,
+			const vector<string> &seqSrc);
+	double projectFPR(size_t newEntries) const;
 
 	void printInfoFile(const string &fileName) const;
 	virtual ~BloomFilterInfo();
@@ -47,6 +55,10 @@ public:
 	const string &getPresetType() const;
 	double getRedundancyFPR() const;
 	double getFPR() const;
+	unsigned getSyncmerSize() const;
+	unsigned getSampleRate() const;
+	size_t getTotalNum() const;
+	double getDesiredFPR() const;
 
 	/*
 	 * Only returns multiples of 64 for filter building purposes
@@ -75,6 +87,18 @@ public:
 		return unsigned(-log(fpr) / log(2));
 	}
 
+	/*
+	 * Estimates the number of entries in a filter from the number of bits set
+	 * see Swamidass & Baldi (2007)
+	 */
+	static size_t calcEntriesFromPop(size_t size, size_t popcount,
+			unsigned hashNum)
+	{
+		return size_t(
+				ceil(-double(size) / hashNum
+						* log(1.0 - double(popcount) / double(size))));
+	}
+
 private:
 	//user specified input
 	string m_filterID;
@@ -83,6 +107,10 @@ private:
 	vector<string> m_seqSrcs;
 	unsigned m_hashNum;
 	size_t m_expectedNumEntries;
+	//0 unless only syncmers were inserted
+	unsigned m_syncmerSize;
+	//0 unless only 1 in this many k-mers were inserted (prescreen filters)
+	unsigned m_sampleRate;
 
 	//determined at run time
 	struct runtime {
@@ -91,6 +119,9 @@ private:
 		double FPR;
 		size_t redundantSequences;
 		double redundantFPR;
+		//0 unless the filter was sized from an estimate of distinct k-mers
+		size_t distinctEstimate;
+		double distinctError;
 	};
 
 	runtime m_runInfo;
@@ -0,0 +1,73 @@
+/*
+ * Checkpoint.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+#include "Checkpoint.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <boost/property_tree/ini_parser.hpp>
+
+Checkpoint::Checkpoint(const string &prefix) :
+		m_prefix(prefix), m_fileName(prefix + "_checkpoint.txt") {
+}
+
+/*
+ * Loads a previously saved checkpoint
+ * Returns false if no checkpoint exists
+ */
+bool Checkpoint::load() {
+	ifstream ifile(m_fileName.c_str());
+	if (!ifile.good()) {
+		return false;
+	}
+	ifile.close();
+	boost::property_tree::ini_parser::read_ini(m_fileName, m_pt);
+	return true;
+}
+
+void Checkpoint::save() const {
+	string tempName = m_fileName + ".tmp";
+	boost::property_tree::ini_parser::write_ini(tempName, m_pt);
+	if (rename(tempName.c_str(), m_fileName.c_str()) != 0) {
+		cerr << "Error: Cannot write checkpoint file " << m_fileName << endl;
+		exit(1);
+	}
+}
+
+/*
+ * Called once a run completes so a later --resume starts from the beginning
+ */
+void Checkpoint::remove() const {
+	std::remove(m_fileName.c_str());
+}
+
+size_t Checkpoint::getFileSize(const string &fileName) {
+	struct stat sb;
+	if (stat(fileName.c_str(), &sb) != 0) {
+		return 0;
+	}
+	return sb.st_size;
+}
+
+/*
+ * Cuts an output file back to the size it had when the checkpoint was taken,
+ * discarding anything written after it
+ */
+void Checkpoint::truncateFile(const string &fileName, size_t size) {
+	if (getFileSize(fileName) < size) {
+		cerr << "Error: " << fileName
+				<< " is smaller than recorded in checkpoint. Cannot resume."
+				<< endl;
+		exit(1);
+	}
+	if (truncate(fileName.c_str(), size) != 0) {
+		cerr << "Error: Cannot truncate " << fileName << endl;
+		exit(1);
+	}
+}
@@ -0,0 +1,83 @@
+/*
+ * Checkpoint.h
+ * Stores the progress of a long running job in an INI format text file so
+ * that it can be continued with --resume after the process is killed.
+ *
+ * The checkpoint file is always written to a temporary file first and then
+ * renamed so a crash during a write never leaves a partial checkpoint.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+#include <string>
+#include <vector>
+#include <sstream>
+#include <boost/property_tree/ptree.hpp>
+
+using namespace std;
+
+class Checkpoint {
+public:
+	explicit Checkpoint(const string &prefix);
+
+	bool load();
+	void save() const;
+	void remove() const;
+
+	template<typename T>
+	void set(const string &key, const T &value) {
+		m_pt.put("checkpoint." + key, value);
+	}
+
+	template<typename T>
+	T get(const string &key) const {
+		return m_pt.get<T>("checkpoint." + key);
+	}
+
+	/*
+	 * Stores a list as a single space separated value
+	 */
+	template<typename T>
+	void setList(const string &key, const vector<T> &values) {
+		stringstream ss;
+		for (typename vector<T>::const_iterator i = values.begin();
+				i != values.end(); ++i) {
+			if (i != values.begin()) {
+				ss << " ";
+			}
+			ss << *i;
+		}
+		m_pt.put("checkpoint." + key, ss.str());
+	}
+
+	template<typename T>
+	vector<T> getList(const string &key) const {
+		vector<T> values;
+		stringstream ss(m_pt.get<string>("checkpoint." + key));
+		T temp;
+		while (ss >> temp) {
+			values.push_back(temp);
+		}
+		return values;
+	}
+
+	const string &getFileName() const {
+		return m_fileName;
+	}
+
+	const string &getPrefix() const {
+		return m_prefix;
+	}
+
+	static size_t getFileSize(const string &fileName);
+	static void truncateFile(const string &fileName, size_t size);
+
+private:
+	string m_prefix;
+	string m_fileName;
+	boost::property_tree::ptree m_pt;
+};
+
+#endif /* CHECKPOINT_H_ */
@@ -0,0 +1,88 @@
+/*
+ * ChunkedSeqReader.hpp
+ *
+ * Reads the records of a sequence file as pieces so that threads can share
+ * the work of long records (e.g. chromosomes). Records with more than
+ * chunkSize k-mers are split into pieces of chunkSize k-mers, each with the
+ * k - 1 bases its last k-mer needs, so every k-mer is in exactly one piece.
+ *
+ * Not thread safe: next() must be called in a critical section, and each
+ * thread hashes the pieces it gets outside of it.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMMON_CHUNKEDSEQREADER_HPP_
+#define COMMON_CHUNKEDSEQREADER_HPP_
+
+#include <string>
+#include <zlib.h>
+#ifndef KSEQ_INIT_NEW
+#define KSEQ_INIT_NEW
+#include "Common/kseq.h"
+KSEQ_INIT(gzFile, gzread)
+#endif /*KSEQ_INIT_NEW*/
+
+using namespace std;
+
+class ChunkedSeqReader {
+public:
+	//k-mers in a piece of a long record
+	static const size_t s_defaultChunkSize = 1 << 20;
+
+	ChunkedSeqReader(kseq_t *seq, unsigned kmerSize, size_t chunkSize =
+			s_defaultChunkSize) :
+			m_seq(seq), m_kmerSize(kmerSize), m_chunkSize(chunkSize), m_pos(0), m_length(
+					0), m_startsRecord(false) {
+	}
+
+	/*
+	 * Copies the next piece into piece. Returns false at the end of the file.
+	 */
+	bool next(string &piece) {
+		if (m_pos >= m_length) {
+			if (kseq_read(m_seq) < 0) {
+				return false;
+			}
+			m_pos = 0;
+			m_length = m_seq->seq.l;
+		}
+		m_startsRecord = m_pos == 0;
+		size_t end = m_length;
+		if (m_length - m_pos > m_chunkSize + m_kmerSize - 1) {
+			end = m_pos + m_chunkSize + m_kmerSize - 1;
+		}
+		piece.assign(m_seq->seq.s + m_pos, end - m_pos);
+		m_pos = end == m_length ? m_length : m_pos + m_chunkSize;
+		return true;
+	}
+
+	/*
+	 * As above, also copying the name of the record the piece is from
+	 */
+	bool next(string &piece, string &name) {
+		if (!next(piece)) {
+			return false;
+		}
+		name.assign(m_seq->name.s, m_seq->name.l);
+		return true;
+	}
+
+	/*
+	 * True if the last piece read is the start of a record
+	 */
+	bool startsRecord() const {
+		return m_startsRecord;
+	}
+
+private:
+	kseq_t *m_seq;
+	unsigned m_kmerSize;
+	size_t m_chunkSize;
+	//position of the next piece in the current record
+	size_t m_pos;
+	size_t m_length;
+	bool m_startsRecord;
+};
+
+#endif /* COMMON_CHUNKEDSEQREADER_HPP_ */
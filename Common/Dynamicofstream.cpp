@@ -11,13 +11,15 @@
 #include <iostream>
 #include <fstream>
 
-Dynamicofstream::Dynamicofstream(const string &filename)
+Dynamicofstream::Dynamicofstream(const string &filename, bool append) :
+		filename(filename)
 {
+	ios::openmode mode = append ? ios::out | ios::app : ios::out;
 	if (endsWith(filename, ".gz")) {
-		filestream = new ogzstream(filename.c_str(), ios::out);
+		filestream = new ogzstream(filename.c_str(), mode);
 		gz = true;
 	} else {
-		filestream = new ofstream(filename.c_str(), ios::out);
+		filestream = new ofstream(filename.c_str(), mode);
 		gz = false;
 	}
 	assert(filestream->good());
@@ -47,6 +49,23 @@ void Dynamicofstream::close()
 	}
 }
 
+/*
+ * Forces everything written so far to disk so the file size can be used as a
+ * resume point. Gzip output is finished as a complete member and reopened in
+ * append mode (concatenated gzip members are still a valid gzip file)
+ */
+void Dynamicofstream::sync()
+{
+	filestream->flush();
+	if (gz) {
+		ogzstream *temp = dynamic_cast<ogzstream*>(filestream);
+		temp->close();
+		temp->clear();
+		temp->open(filename.c_str(), ios::out | ios::app);
+		assert(filestream->good());
+	}
+}
+
 Dynamicofstream::~Dynamicofstream()
 {
 	close();
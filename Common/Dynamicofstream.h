@@ -22,15 +22,20 @@ using namespace std;
 
 class Dynamicofstream{
 public:
-	Dynamicofstream(const string &filename);
+	Dynamicofstream(const string &filename, bool append = false);
 //	void write(const string &input);
 //	Dynamicofstream& operator <<(Dynamicofstream& out, const string& o);
 	ostream& operator <<(const string& o);
 	ostream& operator <<(unsigned o);
 	void close();
+	void sync();
+	const string &getFileName() const {
+		return filename;
+	}
 	virtual ~Dynamicofstream();
 private:
 	ostream* filestream;
+	string filename;
 
 	//@TODO: Not happy with having to store this like this
 	//Should figure out better way and refactor code
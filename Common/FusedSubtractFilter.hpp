@@ -0,0 +1,162 @@
+/*
+ * FusedSubtractFilter.hpp
+ *
+ * Copy of a Bloom filter with a subtract filter of the same size and number of
+ * hash functions baked into it. The two bits for each position are kept in
+ * adjacent words, so asking whether a k-mer is in the filter and not in the
+ * subtract filter needs one memory access per hash value instead of two.
+ *
+ * Bits inserted into the filter must also be inserted here, so the filter
+ * being built takes three times its size in memory, plus the subtract filter.
+ * Assumes a little endian machine, as the filter files are read as 64-bit
+ * words.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMMON_FUSEDSUBTRACTFILTER_HPP_
+#define COMMON_FUSEDSUBTRACTFILTER_HPP_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include "btl_bloomfilter/BloomFilter.hpp"
+
+using namespace std;
+
+class FusedSubtractFilter {
+public:
+	/*
+	 * filterFile holds bits already in filter (e.g. a checkpoint), or is empty
+	 * for a new filter
+	 */
+	FusedSubtractFilter(const BloomFilter &filter, const string &subtractFile,
+			const string &filterFile = "") :
+			m_filter(filter), m_size(filter.getFilterSize()), m_hashNum(
+					filter.getHashNum()), m_words(
+					2 * ((m_size + 63) / 64), 0) {
+		if (!filterFile.empty()) {
+			load(filterFile, 0);
+		}
+		load(subtractFile, 1);
+	}
+
+	/*
+	 * Returns true if all bits of the k-mer are set in the filter, setting
+	 * subtracted if they are also all set in the subtract filter
+	 */
+	bool contains(const uint64_t *hashes, bool &subtracted) const {
+		subtracted = true;
+		for (unsigned i = 0; i < m_hashNum; ++i) {
+			size_t pos = hashes[i] % m_size;
+			const uint64_t *pair = &m_words[2 * (pos / 64)];
+			uint64_t mask = uint64_t(1) << (pos % 64);
+			if ((pair[0] & mask) == 0) {
+				return false;
+			}
+			subtracted = subtracted && (pair[1] & mask) != 0;
+		}
+		return true;
+	}
+
+	/*
+	 * Returns true if all bits of the k-mer are set in the subtract filter
+	 */
+	bool subtractContains(const uint64_t *hashes) const {
+		for (unsigned i = 0; i < m_hashNum; ++i) {
+			size_t pos = hashes[i] % m_size;
+			if ((m_words[2 * (pos / 64) + 1] & (uint64_t(1) << (pos % 64)))
+					== 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void insert(const uint64_t *hashes) {
+		for (unsigned i = 0; i < m_hashNum; ++i) {
+			size_t pos = hashes[i] % m_size;
+			__sync_fetch_and_or(&m_words[2 * (pos / 64)],
+					uint64_t(1) << (pos % 64));
+		}
+	}
+
+	const BloomFilter &getFilter() const {
+		return m_filter;
+	}
+
+	unsigned getKmerSize() const {
+		return m_filter.getKmerSize();
+	}
+
+	unsigned getHashNum() const {
+		return m_hashNum;
+	}
+
+	double getFPRPrecompute() const {
+		return m_filter.getFPRPrecompute();
+	}
+
+	/*
+	 * Size in bits of the filter in a filter file, or 0 if it cannot be read
+	 */
+	static size_t fileFilterSize(const string &fileName) {
+		FILE *file = fopen(fileName.c_str(), "rb");
+		if (file == NULL) {
+			return 0;
+		}
+		BloomFilter::FileHeader header;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1
+				&& header.hlen == sizeof(header);
+		fclose(file);
+		return valid ? header.size : 0;
+	}
+
+private:
+	const BloomFilter &m_filter;
+	size_t m_size;
+	unsigned m_hashNum;
+	//filter and subtract words alternate
+	vector<uint64_t> m_words;
+
+	/*
+	 * Reads the bits of a filter file into the filter (half 0) or subtract
+	 * filter (half 1) words
+	 */
+	void load(const string &fileName, unsigned half) {
+		FILE *file = fopen(fileName.c_str(), "rb");
+		if (file == NULL) {
+			cerr << "Error: Could not open " << fileName << endl;
+			exit(1);
+		}
+		BloomFilter::FileHeader header;
+		if (fread(&header, sizeof(header), 1, file) != 1
+				|| header.hlen != sizeof(header) || header.size != m_size
+				|| header.nhash != m_hashNum) {
+			cerr << "Error: " << fileName
+					<< " must have the same size and number of hash functions"
+					<< " as the filter being built to be fused with it" << endl;
+			exit(1);
+		}
+		vector<uint64_t> block(1 << 20);
+		size_t bytesLeft = m_size / 8;
+		for (size_t word = 0; bytesLeft > 0;) {
+			size_t bytes = min(bytesLeft, block.size() * sizeof(uint64_t));
+			block[(bytes - 1) / sizeof(uint64_t)] = 0;
+			if (fread(block.data(), 1, bytes, file) != bytes) {
+				cerr << "Error: " << fileName << " is truncated" << endl;
+				exit(1);
+			}
+			for (size_t i = 0; i * sizeof(uint64_t) < bytes; ++i, ++word) {
+				m_words[2 * word + half] = block[i];
+			}
+			bytesLeft -= bytes;
+		}
+		fclose(file);
+	}
+};
+
+#endif /* COMMON_FUSEDSUBTRACTFILTER_HPP_ */
@@ -0,0 +1,90 @@
+/*
+ * HyperLogLog.hpp
+ *
+ * Estimates the number of distinct k-mers from their hash values in a fixed
+ * amount of memory (2^precision bytes). Each thread can count into its own
+ * estimator, which are then merged.
+ * see Flajolet et al. (2007) and Heule et al. (2013)
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMMON_HYPERLOGLOG_HPP_
+#define COMMON_HYPERLOGLOG_HPP_
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+using namespace std;
+
+class HyperLogLog {
+public:
+	explicit HyperLogLog(unsigned precision = 14) :
+			m_precision(precision), m_registers(size_t(1) << precision, 0) {
+	}
+
+	void add(uint64_t hash) {
+		//ntHash values are not mixed well enough to use their bits directly
+		hash = mix(hash);
+		const size_t index = hash >> (64 - m_precision);
+		//set a bit below the register bits so the rank is at most 64 - p + 1
+		const uint64_t rest = (hash << m_precision)
+				| (uint64_t(1) << (m_precision - 1));
+		const uint8_t rank = uint8_t(__builtin_clzll(rest) + 1);
+		if (rank > m_registers[index]) {
+			m_registers[index] = rank;
+		}
+	}
+
+	void merge(const HyperLogLog &other) {
+		for (size_t i = 0; i < m_registers.size(); ++i) {
+			if (other.m_registers[i] > m_registers[i]) {
+				m_registers[i] = other.m_registers[i];
+			}
+		}
+	}
+
+	/*
+	 * Estimated number of distinct values added
+	 */
+	double estimate() const {
+		const double m = double(m_registers.size());
+		double sum = 0;
+		size_t zeros = 0;
+		for (size_t i = 0; i < m_registers.size(); ++i) {
+			sum += ldexp(1.0, -int(m_registers[i]));
+			zeros += m_registers[i] == 0;
+		}
+		const double alpha = 0.7213 / (1.0 + 1.079 / m);
+		const double raw = alpha * m * m / sum;
+		//linear counting is more accurate for small counts
+		if (raw <= 2.5 * m && zeros > 0) {
+			return m * log(m / double(zeros));
+		}
+		return raw;
+	}
+
+	/*
+	 * Relative standard error of the estimate
+	 */
+	double relativeError() const {
+		return 1.04 / sqrt(double(m_registers.size()));
+	}
+
+private:
+	unsigned m_precision;
+	vector<uint8_t> m_registers;
+
+	//MurmurHash3 finalizer
+	static uint64_t mix(uint64_t x) {
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdULL;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ULL;
+		x ^= x >> 33;
+		return x;
+	}
+};
+
+#endif /* COMMON_HYPERLOGLOG_HPP_ */
@@ -0,0 +1,114 @@
+/*
+ * KmerLoader.hpp
+ *
+ * Reading, counting and hashing of the k-mers of sequence files, shared by the
+ * filter builders (BloomFilterGenerator and ManifestBuilder). Threads take
+ * batches of sequence from a ChunkedSeqReader and hash up to s_hashBatch
+ * k-mers before any of them is inserted, so the memory accesses of the
+ * insertions are not interleaved with hashing and can overlap.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMMON_KMERLOADER_HPP_
+#define COMMON_KMERLOADER_HPP_
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include "btl_bloomfilter/vendor/ntHashIterator.hpp"
+#include "Common/Syncmers.hpp"
+#include "Common/HyperLogLog.hpp"
+#include "Common/ChunkedSeqReader.hpp"
+
+using namespace std;
+
+namespace KmerLoader {
+
+//bases of sequence a thread takes from a file at once
+static const size_t s_batchBases = 1 << 20;
+//k-mers hashed before they are inserted
+static const unsigned s_hashBatch = 256;
+
+/*
+ * Reads sequences (or pieces of long ones) into buffers until about
+ * s_batchBases bases are read, reusing the memory of the buffers.
+ * Returns the number read, 0 at the end of the file. Not thread safe.
+ */
+inline unsigned readBatch(ChunkedSeqReader &reader, vector<string> &buffers) {
+	unsigned count = 0;
+	for (size_t bases = 0; bases < s_batchBases; ++count) {
+		if (count == buffers.size()) {
+			buffers.push_back(string());
+		}
+		if (!reader.next(buffers[count])) {
+			break;
+		}
+		bases += buffers[count].length();
+	}
+	return count;
+}
+
+/*
+ * Adds the k-mer positions of the first count buffers to positions and their
+ * k-mers to distinct
+ */
+inline void countBatch(const vector<string> &buffers, unsigned count,
+		unsigned kmerSize, size_t &positions, HyperLogLog &distinct) {
+	for (unsigned i = 0; i < count; ++i) {
+		const string &seq = buffers[i];
+		if (seq.length() >= kmerSize) {
+			positions += seq.length() - kmerSize + 1;
+		}
+		for (ntHashIterator itr(seq, 1, kmerSize); itr != itr.end(); ++itr) {
+			distinct.add((*itr)[0]);
+		}
+	}
+}
+
+/*
+ * Number of entries to size a filter for: the number of distinct k-mers
+ * estimated by distinct, padded by three standard errors and capped by the
+ * number of k-mer positions. Only about 1 in k - s + 1 k-mers are syncmers.
+ */
+inline size_t expectedEntries(size_t positions, const HyperLogLog &distinct,
+		unsigned kmerSize, unsigned syncmerSize) {
+	size_t padded = size_t(
+			distinct.estimate() * (1.0 + 3.0 * distinct.relativeError())
+					+ 0.5);
+	size_t entries = min(positions, padded);
+	if (syncmerSize > 0) {
+		entries /= kmerSize - syncmerSize + 1;
+	}
+	return entries;
+}
+
+/*
+ * Hashes the k-mers of seq (only syncmers if syncmerSize is not 0) into
+ * hashes, which holds s_hashBatch k-mers of hashNum values, and calls
+ * insert(hashes, n) for each batch of n k-mers
+ */
+template<typename Insert>
+inline void hashBatches(const string &seq, unsigned kmerSize, unsigned hashNum,
+		unsigned syncmerSize, vector<uint64_t> &hashes, Insert insert) {
+	Syncmers *syncmers =
+			syncmerSize > 0 ? new Syncmers(seq, kmerSize, syncmerSize) : NULL;
+	ntHashIterator itr(seq, hashNum, kmerSize);
+	while (itr != itr.end()) {
+		unsigned batched = 0;
+		for (; itr != itr.end() && batched < s_hashBatch; ++itr) {
+			if (syncmers != NULL && !syncmers->isSyncmer(itr.pos())) {
+				continue;
+			}
+			copy(*itr, *itr + hashNum, &hashes[batched * hashNum]);
+			++batched;
+		}
+		insert(static_cast<const uint64_t*>(hashes.data()), batched);
+	}
+	delete syncmers;
+}
+
+}
+
+#endif /* COMMON_KMERLOADER_HPP_ */
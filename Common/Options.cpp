@@ -23,9 +23,13 @@ namespace opt {
 	std::vector<std::string>fileList2;
 
 	unsigned fileInterval = 10000000;
+	size_t checkpoint = 0;
+	bool resume = false;
 	double fpr = 0.0078125;
 //	double occupancy = 0.5;
 	bool noRep = false;
+	bool fuseSubtract = false;
+	bool deterministic = false;
 	
 	std::string prefix = "";
 	unsigned kmerSize = 25;
@@ -37,4 +41,6 @@ namespace opt {
 	unsigned dustT = 20;
 	unsigned dustWindow = 64;
 
+	unsigned syncmerSize = 0;
+
 }
@@ -28,8 +28,12 @@ namespace opt {
 	extern std::vector<std::string> fileList1;
 	extern std::vector<std::string> fileList2;
 	extern unsigned fileInterval;
+	extern size_t checkpoint;
+	extern bool resume;
 	extern double fpr;
 	extern bool noRep;
+	extern bool fuseSubtract;
+	extern bool deterministic;
 
 	//options for normal BBT
 	enum ScoringMethod {SIMPLE, LENGTH, HARMONIC, BINOMIAL};
@@ -51,6 +55,9 @@ namespace opt {
 	extern bool dust;
 	extern unsigned dustT;
 	extern unsigned dustWindow;
+
+	//syncmer length for sampled filters, 0 to use all k-mers
+	extern unsigned syncmerSize;
 }
 
 #endif
@@ -13,13 +13,18 @@
 #define SEQEVAL_H_ 1
 
 #include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 #include "Common/Options.h"
 #include "btl_bloomfilter/BloomFilter.hpp"
-#include "btl_bloomfilter/vendor/ntHashIterator.hpp"
+#include "Common/ntHashJumpIterator.hpp"
 #include <boost/math/distributions/binomial.hpp>
 #include "Common/SDust.hpp"
+#include "Common/Syncmers.hpp"
+#include "Common/FusedSubtractFilter.hpp"
 
 using namespace std;
 
@@ -34,7 +39,34 @@ inline double normalizeScore(double score, unsigned kmerSize, size_t seqLen) {
 	return score / (seqLen - kmerSize + 1);
 }
 
-inline bool evalSimple(const string &rec, const BloomFilter &filter,
+/*
+ * Looks up the k-mer at itr unless it is low complexity. Returns true if it is
+ * in filter, setting subtracted if it is also in subtract. sduster and
+ * subtract are only used if Dust and Subtract are set.
+ */
+template<bool Dust, bool Subtract>
+inline bool lookup(const BloomFilter &filter, const BloomFilter *subtract,
+		SDust *sduster, const ntHashJumpIterator &itr, bool &subtracted) {
+	if ((Dust && sduster->isLowComp(itr.pos())) || !filter.contains(*itr)) {
+		return false;
+	}
+	subtracted = Subtract && subtract->contains(*itr);
+	return true;
+}
+
+/*
+ * Same for a filter with the subtract filter fused into it, which needs one
+ * memory access per hash value for both
+ */
+template<bool Dust, bool Subtract>
+inline bool lookup(const FusedSubtractFilter &filter, const BloomFilter *,
+		SDust *sduster, const ntHashJumpIterator &itr, bool &subtracted) {
+	return !(Dust && sduster->isLowComp(itr.pos()))
+			&& filter.contains(*itr, subtracted);
+}
+
+template<bool Dust, bool Subtract, typename Filter>
+inline bool evalSimple(const string &rec, const Filter &filter,
 		double threshold, const BloomFilter *subtract =
 		NULL, SDust *sduster = NULL) {
 
@@ -47,12 +79,13 @@ inline bool evalSimple(const string &rec, const BloomFilter &filter,
 	double score = 0;
 	unsigned antiScore = 0;
 	unsigned streak = 0;
-	ntHashIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
+	const unsigned streakThreshold = opt::streakThreshold;
+	ntHashJumpIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
 	unsigned prevPos = 0;
+	bool subtracted = false;
 	if (itr != itr.end()) {
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
-			if (subtract == NULL || !subtract->contains(*itr))
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
+			if (!subtracted)
 				score += 0.5;
 			if (thres <= score) {
 				return true;
@@ -75,13 +108,12 @@ inline bool evalSimple(const string &rec, const BloomFilter &filter,
 			}
 			streak = 0;
 		}
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
 			if (streak == 0) {
-				if (subtract == NULL || !subtract->contains(*itr))
+				if (!subtracted)
 					score += 0.5;
 			} else {
-				if (subtract == NULL || !subtract->contains(*itr))
+				if (!subtracted)
 					++score;
 			}
 			if (thres <= score) {
@@ -91,21 +123,18 @@ inline bool evalSimple(const string &rec, const BloomFilter &filter,
 			++itr;
 			++streak;
 		} else {
-			if (streak < opt::streakThreshold) {
+			if (streak < streakThreshold) {
 				if (antiThres <= ++antiScore)
 					return false;
 				prevPos = itr.pos();
 				++itr;
 			} else {
-				//TODO: Determine if faster to force re-init
-				unsigned skipEnd = itr.pos() + filter.getKmerSize();
 				//skip lookups
-				while (itr.pos() < skipEnd) {
-					if (antiThres <= ++antiScore)
-						return false;
-					prevPos = itr.pos();
-					++itr;
-				}
+				size_t lastPos = 0;
+				antiScore += itr.skip(filter.getKmerSize(), lastPos);
+				if (antiThres <= antiScore)
+					return false;
+				prevPos = lastPos;
 			}
 			streak = 0;
 		}
@@ -113,7 +142,8 @@ inline bool evalSimple(const string &rec, const BloomFilter &filter,
 	return false;
 }
 
-inline bool evalHarmonic(const string &rec, const BloomFilter &filter,
+template<bool Dust, bool Subtract, typename Filter>
+inline bool evalHarmonic(const string &rec, const Filter &filter,
 		double threshold, const BloomFilter *subtract =
 		NULL, SDust *sduster = NULL) {
 
@@ -126,12 +156,13 @@ inline bool evalHarmonic(const string &rec, const BloomFilter &filter,
 	double score = 0;
 	unsigned antiScore = 0;
 	unsigned streak = 0;
-	ntHashIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
+	const unsigned streakThreshold = opt::streakThreshold;
+	ntHashJumpIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
 	unsigned prevPos = 0;
+	bool subtracted = false;
 	if (itr != itr.end()) {
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
-			if (subtract == NULL || !subtract->contains(*itr))
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
+			if (!subtracted)
 				score += 0.5;
 			if (thres <= score) {
 				return true;
@@ -154,13 +185,12 @@ inline bool evalHarmonic(const string &rec, const BloomFilter &filter,
 			}
 			streak = 0;
 		}
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
 			if (streak == 0) {
-				if (subtract == NULL || !subtract->contains(*itr))
+				if (!subtracted)
 					score += 0.5;
 			} else {
-				if (subtract == NULL || !subtract->contains(*itr))
+				if (!subtracted)
 					score += 1.0 - 1.0 / (1.0 + double(streak));
 			}
 			if (thres <= score) {
@@ -170,21 +200,18 @@ inline bool evalHarmonic(const string &rec, const BloomFilter &filter,
 			++itr;
 			++streak;
 		} else {
-			if (streak < opt::streakThreshold) {
+			if (streak < streakThreshold) {
 				if (antiThres <= ++antiScore)
 					return false;
 				prevPos = itr.pos();
 				++itr;
 			} else {
-				//TODO: Determine if faster to force re-init
-				unsigned skipEnd = itr.pos() + filter.getKmerSize();
 				//skip lookups
-				while (itr.pos() < skipEnd) {
-					if (antiThres <= ++antiScore)
-						return false;
-					prevPos = itr.pos();
-					++itr;
-				}
+				size_t lastPos = 0;
+				antiScore += itr.skip(filter.getKmerSize(), lastPos);
+				if (antiThres <= antiScore)
+					return false;
+				prevPos = lastPos;
 			}
 			streak = 0;
 		}
@@ -215,7 +242,8 @@ inline double calcProbMatches(size_t frameLen, double bfFPR, size_t matches) {
 	return cdf(complement(bin, matches));
 }
 
-inline bool evalBinomial(const string &rec, const BloomFilter &filter,
+template<bool Dust, bool Subtract, typename Filter>
+inline bool evalBinomial(const string &rec, const Filter &filter,
 		double threshold, const BloomFilter *subtract =
 		NULL, SDust *sduster = NULL) {
 	if (rec.size() < filter.getKmerSize()) {
@@ -229,12 +257,13 @@ inline bool evalBinomial(const string &rec, const BloomFilter &filter,
 	unsigned score = 0;
 	unsigned antiScore = 0;
 	unsigned streak = 0;
-	ntHashIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
+	const unsigned streakThreshold = opt::streakThreshold;
+	ntHashJumpIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
 	unsigned prevPos = 0;
+	bool subtracted = false;
 	if (itr != itr.end()) {
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
-			if (subtract == NULL || !subtract->contains(*itr))
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
+			if (!subtracted)
 				score++;
 			if (thres <= score) {
 				return true;
@@ -257,9 +286,8 @@ inline bool evalBinomial(const string &rec, const BloomFilter &filter,
 			}
 			streak = 0;
 		}
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
-			if (subtract == NULL || !subtract->contains(*itr))
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
+			if (!subtracted)
 					++score;
 			if (thres <= score) {
 				return true;
@@ -268,20 +296,18 @@ inline bool evalBinomial(const string &rec, const BloomFilter &filter,
 			++itr;
 			++streak;
 		} else {
-			if (streak < opt::streakThreshold) {
+			if (streak < streakThreshold) {
 				if (antiThres <= ++antiScore)
 					return false;
 				prevPos = itr.pos();
 				++itr;
 			} else {
-				unsigned skipEnd = itr.pos() + filter.getKmerSize();
 				//skip lookups
-				while (itr.pos() < skipEnd) {
-					if (antiThres <= ++antiScore)
-						return false;
-					prevPos = itr.pos();
-					++itr;
-				}
+				size_t lastPos = 0;
+				antiScore += itr.skip(filter.getKmerSize(), lastPos);
+				if (antiThres <= antiScore)
+					return false;
+				prevPos = lastPos;
 			}
 			streak = 0;
 		}
@@ -292,15 +318,17 @@ inline bool evalBinomial(const string &rec, const BloomFilter &filter,
 /*
  * Evaluation algorithm based on minimum number of contiguous matching bases.
  */
-inline bool evalMinMatchLen(const string &rec, const BloomFilter &filter,
+template<bool Dust, bool Subtract, typename Filter>
+inline bool evalMinMatchLen(const string &rec, const Filter &filter,
 		unsigned minMatchLen, const BloomFilter *subtract = NULL,
 		SDust *sduster = NULL) {
 	// number of contiguous k-mers matched
 	unsigned matchLen = 0;
 	size_t l = rec.length();
 
-	ntHashIterator itr(rec, filter.getHashNum(), filter.getKmerSize());
+	ntHashJumpIterator itr(rec, filter.getHashNum(), filter.getKmerSize());
 	unsigned prevPos = 0;
+	bool subtracted = false;
 	while (itr != itr.end()) {
 		// quit early if there is no hope
 		if (l - itr.pos() + matchLen < minMatchLen)
@@ -311,9 +339,8 @@ inline bool evalMinMatchLen(const string &rec, const BloomFilter &filter,
 		if (itr.pos() != prevPos + 1) {
 			matchLen = 0;
 		}
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
-			if (subtract == NULL || !subtract->contains(*itr)) {
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
+			if (!subtracted) {
 				if (matchLen == 0)
 					matchLen = filter.getKmerSize();
 				else
@@ -331,236 +358,844 @@ inline bool evalMinMatchLen(const string &rec, const BloomFilter &filter,
 	return false;
 }
 
-inline double evalSimpleScore(const string &rec, const BloomFilter &filter,
-		const BloomFilter *subtract = NULL, SDust *sduster = NULL) {
+/*
+ * Lookup results for the k-mers of a read in one filter, one bit per k-mer
+ * position. Scores are computed from these with word operations rather than
+ * per k-mer state machines.
+ */
+struct HitBitmap {
+	//k-mers found in the filter, excluding low complexity and skipped k-mers
+	vector<uint64_t> hit;
+	//hits also found in the subtract filter
+	vector<uint64_t> subtracted;
+	//one past the last k-mer position looked up or skipped
+	size_t end;
+};
 
-	double score = 0;
+/*
+ * Bitmap of the calling thread, so its memory is reused from read to read
+ */
+inline HitBitmap &threadBitmap() {
+	static thread_local HitBitmap bitmap;
+	return bitmap;
+}
+
+/*
+ * First phase of scoring: looks up the k-mers of rec. Low complexity k-mers are
+ * not looked up. If skip is set, lookups after a miss that ends a streak of
+ * opt::streakThreshold hits are skipped as in the threshold kernels.
+ */
+template<bool Dust, bool Subtract>
+inline void scanBitmap(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract, SDust *sduster, bool skip,
+		HitBitmap &bitmap) {
+	const unsigned k = filter.getKmerSize();
+	const size_t words = rec.size() >= k ? (rec.size() - k + 64) / 64 : 0;
+	bitmap.hit.assign(words, 0);
+	bitmap.subtracted.assign(words, 0);
+	bitmap.end = 0;
 	unsigned streak = 0;
-	ntHashIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
-	unsigned prevPos = 0;
+	const unsigned streakThreshold = opt::streakThreshold;
+	unsigned hashNum = filter.getHashNum();
+	if (Subtract && subtract->getHashNum() > hashNum) {
+		hashNum = subtract->getHashNum();
+	}
+	ntHashJumpIterator itr(rec, hashNum, k);
+	size_t prevPos = 0;
+	bool subtracted = false;
 	while (itr != itr.end()) {
-		//check if k-mer has deviated/started again
-		//TODO try to terminate before itr has to re-init after skipping
-		if (itr.pos() != prevPos + 1) {
+		const size_t pos = itr.pos();
+		if (pos != prevPos + 1) {
 			streak = 0;
 		}
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
-			if (streak == 0) {
-				if (subtract == NULL || !subtract->contains(*itr))
-					score += 0.5;
-			} else {
-				if (subtract == NULL || !subtract->contains(*itr))
-					++score;
+		bitmap.end = pos + 1;
+		if (lookup<Dust, Subtract>(filter, subtract, sduster, itr, subtracted)) {
+			const uint64_t bit = uint64_t(1) << (pos % 64);
+			bitmap.hit[pos / 64] |= bit;
+			if (subtracted) {
+				bitmap.subtracted[pos / 64] |= bit;
 			}
-			prevPos = itr.pos();
+			prevPos = pos;
 			++itr;
 			++streak;
+		} else if (!skip || streak < streakThreshold) {
+			prevPos = pos;
+			++itr;
+			streak = 0;
 		} else {
-			if (streak < opt::streakThreshold) {
-				prevPos = itr.pos();
-				++itr;
-			} else {
-				//TODO: Determine if faster to force re-init
-				unsigned skipEnd = itr.pos() + filter.getKmerSize();
-				//skip lookups
-				while (itr.pos() < skipEnd) {
-					prevPos = itr.pos();
-					++itr;
+			itr.skip(k, prevPos);
+			bitmap.end = prevPos + 1;
+			streak = 0;
+		}
+	}
+}
+
+/*
+ * Second phase: hits count 1, or 0.5 if they start a streak. Streak starts
+ * are hits whose previous bit is clear.
+ */
+inline double simpleBitmapScore(const HitBitmap &bitmap) {
+	size_t kept = 0;
+	size_t keptStarts = 0;
+	uint64_t carry = 0;
+	for (size_t i = 0; i < bitmap.hit.size(); ++i) {
+		const uint64_t hit = bitmap.hit[i];
+		const uint64_t keep = hit & ~bitmap.subtracted[i];
+		const uint64_t starts = hit & ~((hit << 1) | carry);
+		carry = hit >> 63;
+		kept += __builtin_popcountll(keep);
+		keptStarts += __builtin_popcountll(keep & starts);
+	}
+	return double(kept) - 0.5 * double(keptStarts);
+}
+
+/*
+ * Harmonic score term of the hit after streak hits: 0.5 if streak = 0, else
+ * 1 - 1 / (streak + 1). Terms of short streaks are tabulated.
+ */
+inline double harmonicTerm(unsigned streak) {
+	static const unsigned tableSize = 256;
+	static const vector<double> table = [] {
+		vector<double> terms(tableSize, 0.5);
+		for (unsigned i = 1; i < tableSize; ++i) {
+			terms[i] = 1.0 - 1.0 / (1.0 + double(i));
+		}
+		return terms;
+	}();
+	return streak < tableSize ?
+			table[streak] : 1.0 - 1.0 / (1.0 + double(streak));
+}
+
+/*
+ * Second phase: the n-th hit of a streak counts 1 - 1 / n, or 0.5 if n = 1.
+ * Streaks are found a run of set bits at a time. Terms are added in position
+ * order so results match evalHarmonic.
+ */
+inline double harmonicBitmapScore(const HitBitmap &bitmap) {
+	double score = 0;
+	unsigned streak = 0;
+	//position after the previous hit
+	size_t nextPos = numeric_limits<size_t>::max();
+	for (size_t i = 0; i < bitmap.hit.size(); ++i) {
+		uint64_t hit = bitmap.hit[i];
+		const uint64_t subtracted = bitmap.subtracted[i];
+		while (hit != 0) {
+			const unsigned bit = __builtin_ctzll(hit);
+			const uint64_t run = ~(hit >> bit);
+			const unsigned len = run == 0 ? 64 - bit : __builtin_ctzll(run);
+			streak = i * 64 + bit == nextPos ? streak + 1 : 0;
+			const uint64_t kept = ~subtracted >> bit;
+			for (unsigned j = 0; j < len; ++j) {
+				if ((kept >> j) & 1) {
+					score += harmonicTerm(streak + j);
 				}
 			}
-			streak = 0;
+			streak += len - 1;
+			nextPos = i * 64 + bit + len;
+			hit = bit + len == 64 ? 0 : hit & (~uint64_t(0) << (bit + len));
+		}
+	}
+	return score;
+}
+
+/*
+ * Second phase: number of hits not subtracted
+ */
+inline size_t countBitmapScore(const HitBitmap &bitmap) {
+	size_t kept = 0;
+	for (size_t i = 0; i < bitmap.hit.size(); ++i) {
+		kept += __builtin_popcountll(bitmap.hit[i] & ~bitmap.subtracted[i]);
+	}
+	return kept;
+}
+
+/*
+ * Second phase: length in bases of the streak of hits that ends at the last
+ * k-mer, counting only hits not subtracted
+ */
+inline unsigned lastMatchLenBitmapScore(const HitBitmap &bitmap, unsigned k) {
+	size_t kept = 0;
+	for (size_t i = bitmap.end; i > 0;) {
+		const unsigned top = (i - 1) % 64;
+		//move bit i - 1 to the top, so the streak is the leading ones
+		const uint64_t hit = bitmap.hit[(i - 1) / 64] << (63 - top);
+		const uint64_t subtracted = bitmap.subtracted[(i - 1) / 64]
+				<< (63 - top);
+		const unsigned run = ~hit == 0 ? 64 : __builtin_clzll(~hit);
+		if (run == 0) {
+			break;
 		}
+		const uint64_t runMask = run == 64 ? ~uint64_t(0) : ~(~uint64_t(0) >> run);
+		kept += __builtin_popcountll(runMask & ~subtracted);
+		if (run < top + 1) {
+			break;
+		}
+		i -= run;
 	}
-	return normalizeScore(score, filter.getKmerSize(), rec.length());
+	return kept > 0 ? unsigned(k + kept - 1) : 0;
+}
+
+template<bool Dust, bool Subtract>
+inline double evalSimpleScore(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract = NULL, SDust *sduster = NULL) {
+	HitBitmap &bitmap = threadBitmap();
+	scanBitmap<Dust, Subtract>(rec, filter, subtract, sduster, true, bitmap);
+	return normalizeScore(simpleBitmapScore(bitmap), filter.getKmerSize(),
+			rec.length());
 }
 
+template<bool Dust, bool Subtract>
 inline double evalHarmonicScore(const string &rec, const BloomFilter &filter,
 		const BloomFilter *subtract = NULL, SDust *sduster = NULL) {
-	double score = 0;
+	HitBitmap &bitmap = threadBitmap();
+	scanBitmap<Dust, Subtract>(rec, filter, subtract, sduster, true, bitmap);
+	return normalizeScore(harmonicBitmapScore(bitmap), filter.getKmerSize(),
+			rec.length());
+}
+
+template<bool Dust, bool Subtract>
+inline unsigned evalMinMatchLenScore(const string &rec,
+		const BloomFilter &filter, const BloomFilter *subtract = NULL,
+		SDust *sduster = NULL) {
+	HitBitmap &bitmap = threadBitmap();
+	scanBitmap<Dust, Subtract>(rec, filter, subtract, sduster, false, bitmap);
+	return lastMatchLenBitmapScore(bitmap, filter.getKmerSize());
+}
+
+template<bool Dust, bool Subtract>
+inline double evalBinomialScore(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract = NULL, SDust *sduster = NULL) {
+	if (rec.size() < filter.getKmerSize()) {
+		return 1.0;
+	}
+	const unsigned frameLen = rec.size() - filter.getKmerSize() + 1;
+	HitBitmap &bitmap = threadBitmap();
+	scanBitmap<Dust, Subtract>(rec, filter, subtract, sduster, true, bitmap);
+	return calcProbMatches(frameLen, filter.getFPRPrecompute(),
+			countBitmapScore(bitmap));
+}
+
+/*
+ * Kernel for scoring method Method with dust and subtraction fixed at compile
+ * time, so the kernels have no branches for them
+ */
+template<opt::ScoringMethod Method, bool Dust, bool Subtract, typename Filter>
+inline bool evalReadKernel(const string &rec, const Filter &filter,
+		double threshold, const BloomFilter *subtract, SDust *sduster) {
+	switch (Method) {
+	case opt::LENGTH:
+		return evalMinMatchLen<Dust, Subtract>(rec, filter,
+				(unsigned) round(threshold), subtract, sduster);
+	case opt::HARMONIC:
+		return evalHarmonic<Dust, Subtract>(rec, filter, threshold, subtract,
+				sduster);
+	case opt::BINOMIAL:
+		return evalBinomial<Dust, Subtract>(rec, filter, threshold, subtract,
+				sduster);
+	case opt::SIMPLE:
+	default:
+		return evalSimple<Dust, Subtract>(rec, filter, threshold, subtract,
+				sduster);
+	}
+}
+
+template<opt::ScoringMethod Method, bool Dust, bool Subtract, typename Filter>
+inline bool evalReadWith(const string &rec, const Filter &filter,
+		double threshold, const BloomFilter *subtract) {
+	if (Dust) {
+		SDust sduster(rec);
+		return evalReadKernel<Method, Dust, Subtract>(rec, filter, threshold,
+				subtract, &sduster);
+	}
+	return evalReadKernel<Method, Dust, Subtract>(rec, filter, threshold,
+			subtract, NULL);
+}
+
+template<typename Filter>
+using ReadEvaluator = bool (*)(const string &, const Filter &, double,
+		const BloomFilter *);
+
+template<opt::ScoringMethod Method, typename Filter>
+inline ReadEvaluator<Filter> readEvaluator(bool dust, bool subtract) {
+	if (dust) {
+		return subtract ?
+				&evalReadWith<Method, true, true, Filter> :
+				&evalReadWith<Method, true, false, Filter>;
+	}
+	return subtract ?
+			&evalReadWith<Method, false, true, Filter> :
+			&evalReadWith<Method, false, false, Filter>;
+}
+
+/*
+ * Returns evalRead specialized for the current options, so callers evaluating
+ * many reads can choose it once
+ */
+template<typename Filter>
+inline ReadEvaluator<Filter> readEvaluator(bool subtract) {
+	switch (opt::scoringMethod) {
+	case opt::LENGTH:
+		return readEvaluator<opt::LENGTH, Filter>(opt::dust, subtract);
+	case opt::HARMONIC:
+		return readEvaluator<opt::HARMONIC, Filter>(opt::dust, subtract);
+	case opt::BINOMIAL:
+		return readEvaluator<opt::BINOMIAL, Filter>(opt::dust, subtract);
+	case opt::SIMPLE:
+	default:
+		return readEvaluator<opt::SIMPLE, Filter>(opt::dust, subtract);
+	}
+}
+
+template<typename Filter>
+inline bool evalRead(const string &rec, const Filter &filter,
+		double threshold, const BloomFilter *subtract = NULL) {
+	return readEvaluator<Filter>(subtract != NULL)(rec, filter, threshold,
+			subtract);
+}
+
+inline bool evalRead(const string &rec, const BloomFilter &filter,
+		double threshold, const BloomFilter &subtract) {
+	return evalRead(rec, filter, threshold, &subtract);
+}
+
+/*
+ * Computes exhaustively (no ending early to save speed)
+ */
+template<opt::ScoringMethod Method, bool Dust, bool Subtract>
+inline double evalScoreKernel(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract, SDust *sduster) {
+	switch (Method) {
+	case opt::LENGTH:
+		return evalMinMatchLenScore<Dust, Subtract>(rec, filter, subtract,
+				sduster);
+	case opt::HARMONIC:
+		return evalHarmonicScore<Dust, Subtract>(rec, filter, subtract,
+				sduster);
+	case opt::BINOMIAL:
+		return log10(
+				evalBinomialScore<Dust, Subtract>(rec, filter, subtract,
+						sduster)) * -10;
+	case opt::SIMPLE:
+	default:
+		return evalSimpleScore<Dust, Subtract>(rec, filter, subtract, sduster);
+	}
+}
+
+template<opt::ScoringMethod Method, bool Dust, bool Subtract>
+inline double evalScoreWith(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract) {
+	if (Dust) {
+		SDust sduster(rec);
+		return evalScoreKernel<Method, Dust, Subtract>(rec, filter, subtract,
+				&sduster);
+	}
+	return evalScoreKernel<Method, Dust, Subtract>(rec, filter, subtract, NULL);
+}
+
+typedef double (*ScoreEvaluator)(const string &, const BloomFilter &,
+		const BloomFilter *);
+
+template<opt::ScoringMethod Method>
+inline ScoreEvaluator scoreEvaluator(bool dust, bool subtract) {
+	if (dust) {
+		return subtract ?
+				&evalScoreWith<Method, true, true> :
+				&evalScoreWith<Method, true, false>;
+	}
+	return subtract ?
+			&evalScoreWith<Method, false, true> :
+			&evalScoreWith<Method, false, false>;
+}
+
+/*
+ * Returns evalScore specialized for the current options
+ */
+inline ScoreEvaluator scoreEvaluator(bool subtract) {
+	switch (opt::scoringMethod) {
+	case opt::LENGTH:
+		return scoreEvaluator<opt::LENGTH>(opt::dust, subtract);
+	case opt::HARMONIC:
+		return scoreEvaluator<opt::HARMONIC>(opt::dust, subtract);
+	case opt::BINOMIAL:
+		return scoreEvaluator<opt::BINOMIAL>(opt::dust, subtract);
+	case opt::SIMPLE:
+	default:
+		return scoreEvaluator<opt::SIMPLE>(opt::dust, subtract);
+	}
+}
+
+inline double evalScore(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract = NULL) {
+	return scoreEvaluator(subtract != NULL)(rec, filter, subtract);
+}
+
+/*
+ * Windowed evaluation of long reads
+ *
+ * The k-mers of a read are split into windows that are looked up concurrently
+ * as OpenMP tasks, recording one flag per k-mer position. The scoring loops
+ * are then replayed over the flags, so the result is identical to evalRead
+ * and evalScore on the whole read.
+ */
+enum KmerFlag {
+	KMER_VALID = 1, KMER_HIT = 2, KMER_SUBTRACT = 4, KMER_LOWCOMP = 8
+};
+
+/*
+ * Looks up the k-mers starting in [start, end) of rec
+ */
+inline void scanWindow(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract, size_t start, size_t end,
+		vector<unsigned char> &flags) {
+	const unsigned k = filter.getKmerSize();
+	unsigned hashNum = filter.getHashNum();
+	if (subtract != NULL && subtract->getHashNum() > hashNum) {
+		hashNum = subtract->getHashNum();
+	}
+	for (ntHashJumpIterator itr(rec, hashNum, k, start);
+			itr != itr.end() && itr.pos() < end; ++itr) {
+		unsigned char &flag = flags[itr.pos()];
+		flag = KMER_VALID;
+		if (filter.contains(*itr)) {
+			flag |= KMER_HIT;
+			if (subtract != NULL && subtract->contains(*itr)) {
+				flag |= KMER_SUBTRACT;
+			}
+		}
+	}
+}
+
+/*
+ * Creates a task for every window of windowSize k-mers in rec. Windows overlap
+ * by k - 1 bases so each k-mer is looked up once.
+ * Tasks may still be running on return: use "#pragma omp taskwait" before
+ * reading flags.
+ */
+inline void scanWindows(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract, size_t windowSize,
+		vector<unsigned char> &flags) {
+	const unsigned k = filter.getKmerSize();
+	const size_t kmerCount = rec.size() >= k ? rec.size() - k + 1 : 0;
+	flags.assign(kmerCount, 0);
+	const string *recPtr = &rec;
+	const BloomFilter *filterPtr = &filter;
+	vector<unsigned char> *flagsPtr = &flags;
+	for (size_t start = 0; start < kmerCount; start += windowSize) {
+		size_t end = min(start + windowSize, kmerCount);
+#pragma omp task firstprivate(recPtr, filterPtr, subtract, start, end, flagsPtr)
+		scanWindow(*recPtr, *filterPtr, subtract, start, end, *flagsPtr);
+	}
+}
+
+/*
+ * Marks low complexity k-mers (opt::dust). Call once all windows are scanned.
+ */
+inline void maskLowComp(const string &rec, vector<unsigned char> &flags) {
+	SDust sduster(rec);
+	for (size_t pos = 0; pos < flags.size(); ++pos) {
+		if ((flags[pos] & KMER_VALID) && sduster.isLowComp(pos)) {
+			flags[pos] |= KMER_LOWCOMP;
+		}
+	}
+}
+
+/*
+ * Position of the next k-mer scanned at or after pos, as ntHashIterator
+ * would visit it
+ */
+inline size_t nextKmer(const vector<unsigned char> &flags, size_t pos) {
+	for (; pos < flags.size(); ++pos) {
+		if (flags[pos] & KMER_VALID) {
+			return pos;
+		}
+	}
+	return numeric_limits<size_t>::max();
+}
+
+/*
+ * Replays the loop shared by the simple, harmonic and binomial methods.
+ * With useThres the early exits of evalSimple, evalHarmonic and evalBinomial
+ * are applied and 1 or 0 is returned, -1 if neither was reached.
+ * The accumulated score is returned in score.
+ */
+inline int replayStreak(const vector<unsigned char> &flags, unsigned k,
+		bool useThres, double thres, double antiThres, double &score) {
+	const size_t end = numeric_limits<size_t>::max();
+	unsigned antiScore = 0;
 	unsigned streak = 0;
-	ntHashIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
-	unsigned prevPos = 0;
-	while (itr != itr.end()) {
+	size_t prevPos = 0;
+	bool first = true;
+	score = 0;
+	for (size_t pos = nextKmer(flags, 0); pos != end;) {
+		//evalSimple, evalHarmonic and evalBinomial handle the first k-mer
+		//separately: it is never counted as a deviation or skipped after
+		bool isFirst = first && useThres;
+		first = false;
 		//check if k-mer has deviated/started again
-		//TODO try to terminate before itr has to re-init after skipping
-		if (itr.pos() != prevPos + 1) {
+		if (!isFirst && pos != prevPos + 1) {
+			antiScore += pos - prevPos - 1;
+			if (useThres && antiThres <= antiScore) {
+				return 0;
+			}
 			streak = 0;
 		}
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr)) {
-			if (streak == 0) {
-				if (subtract == NULL || !subtract->contains(*itr))
-					score += 0.5;
-			} else {
-				if (subtract == NULL || !subtract->contains(*itr))
+		if ((flags[pos] & (KMER_HIT | KMER_LOWCOMP)) == KMER_HIT) {
+			if (!(flags[pos] & KMER_SUBTRACT)) {
+				if (streak == 0 || opt::scoringMethod == opt::BINOMIAL) {
+					score += opt::scoringMethod == opt::BINOMIAL ? 1.0 : 0.5;
+				} else if (opt::scoringMethod == opt::HARMONIC) {
 					score += 1.0 - 1.0 / (1.0 + double(streak));
+				} else {
+					++score;
+				}
 			}
-			prevPos = itr.pos();
-			++itr;
+			if (useThres && thres <= score) {
+				return 1;
+			}
+			prevPos = pos;
+			pos = nextKmer(flags, pos + 1);
 			++streak;
 		} else {
-			if (streak < opt::streakThreshold) {
-				prevPos = itr.pos();
-				++itr;
+			if (isFirst || streak < opt::streakThreshold) {
+				if (useThres && antiThres <= ++antiScore) {
+					return 0;
+				}
+				prevPos = pos;
+				pos = nextKmer(flags, pos + 1);
 			} else {
-				//TODO: Determine if faster to force re-init
-				unsigned skipEnd = itr.pos() + filter.getKmerSize();
+				size_t skipEnd = pos + k;
 				//skip lookups
-				while (itr.pos() < skipEnd) {
-					prevPos = itr.pos();
-					++itr;
+				while (pos < skipEnd) {
+					if (useThres && antiThres <= ++antiScore) {
+						return 0;
+					}
+					prevPos = pos;
+					pos = nextKmer(flags, pos + 1);
 				}
 			}
 			streak = 0;
 		}
 	}
-	return normalizeScore(score, filter.getKmerSize(), rec.length());
+	return -1;
 }
 
-inline unsigned evalMinMatchLenScore(const string &rec,
-		const BloomFilter &filter, const BloomFilter *subtract = NULL,
-		SDust *sduster = NULL) {
+/*
+ * Replays evalMinMatchLenScore, also returning the longest match seen
+ */
+inline unsigned replayMinMatchLen(const vector<unsigned char> &flags,
+		unsigned k, unsigned &maxMatchLen) {
 	unsigned matchLen = 0;
-	ntHashIterator itr(rec, filter.getHashNum(), filter.getKmerSize());
-	unsigned prevPos = 0;
-	while (itr != itr.end()) {
-		//check if k-mer has deviated/started again
-		//TODO try to terminate before itr has to re-init after skipping
-		if (itr.pos() != prevPos + 1) {
+	size_t prevPos = 0;
+	maxMatchLen = 0;
+	for (size_t pos = nextKmer(flags, 0); pos != numeric_limits<size_t>::max();
+			prevPos = pos, pos = nextKmer(flags, pos + 1)) {
+		if (pos != prevPos + 1) {
 			matchLen = 0;
 		}
-		if ((!(sduster != NULL && sduster->isLowComp(itr.pos()))
-				&& filter.contains(*itr))) {
-			if (subtract == NULL || !subtract->contains(*itr)) {
-				if (matchLen == 0)
-					matchLen = filter.getKmerSize();
-				else
-					++matchLen;
+		if ((flags[pos] & (KMER_HIT | KMER_LOWCOMP)) == KMER_HIT) {
+			if (!(flags[pos] & KMER_SUBTRACT)) {
+				matchLen = matchLen == 0 ? k : matchLen + 1;
 			}
 		} else {
 			matchLen = 0;
 		}
-		prevPos = itr.pos();
-		++itr;
+		maxMatchLen = max(maxMatchLen, matchLen);
 	}
 	return matchLen;
 }
 
-inline double evalBinomialScore(const string &rec, const BloomFilter &filter,
-		const BloomFilter *subtract = NULL, SDust *sduster = NULL) {
-	if (rec.size() < filter.getKmerSize()) {
-		return 1.0;
+/*
+ * Same result as evalRead, computed from the flags of scanWindows
+ */
+inline bool replayRead(const vector<unsigned char> &flags,
+		const BloomFilter &filter, size_t seqLen, double threshold) {
+	const unsigned k = filter.getKmerSize();
+	double score = 0;
+	switch (opt::scoringMethod) {
+	case opt::LENGTH: {
+		unsigned maxMatchLen = 0;
+		replayMinMatchLen(flags, k, maxMatchLen);
+		return maxMatchLen >= (unsigned) round(threshold);
 	}
-	const unsigned frameLen = rec.size() - filter.getKmerSize() + 1;
-	unsigned score = 0;
-	unsigned streak = 0;
-	ntHashIterator itr(rec, filter.getKmerSize(), filter.getKmerSize());
-	unsigned prevPos = 0;
+	case opt::BINOMIAL: {
+		if (seqLen < k) {
+			return false;
+		}
+		const unsigned frameLen = seqLen - k + 1;
+		const unsigned thres = calcMinCount(frameLen,
+				filter.getFPRPrecompute(), threshold);
+		return replayStreak(flags, k, true, thres, frameLen - thres, score) == 1;
+	}
+	case opt::HARMONIC:
+	case opt::SIMPLE:
+	default:
+		return replayStreak(flags, k, true,
+				denormalizeScore(threshold, k, seqLen),
+				floor(denormalizeScore(1.0 - threshold, k, seqLen)), score) == 1;
+	}
+}
 
-	while (itr != itr.end()) {
-		//check if k-mer has deviated/started again
-		//TODO try to terminate before itr has to re-init after skipping
-		if (itr.pos() != prevPos + 1) {
-			streak = 0;
+/*
+ * Same result as evalScore, computed from the flags of scanWindows
+ */
+inline double replayScore(const vector<unsigned char> &flags,
+		const BloomFilter &filter, size_t seqLen) {
+	const unsigned k = filter.getKmerSize();
+	double score = 0;
+	switch (opt::scoringMethod) {
+	case opt::LENGTH: {
+		unsigned maxMatchLen = 0;
+		return replayMinMatchLen(flags, k, maxMatchLen);
+	}
+	case opt::BINOMIAL: {
+		if (seqLen < k) {
+			return log10(1.0) * -10;
 		}
-		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
+		replayStreak(flags, k, false, 0, 0, score);
+		return log10(
+				calcProbMatches(seqLen - k + 1, filter.getFPRPrecompute(),
+						size_t(score))) * -10;
+	}
+	case opt::HARMONIC:
+	case opt::SIMPLE:
+	default:
+		replayStreak(flags, k, false, 0, 0, score);
+		return normalizeScore(score, k, seqLen);
+	}
+}
+
+/*
+ * Batched lookups for many reads
+ *
+ * The hash values of every k-mer in a batch of reads are computed first. The
+ * bits are then looked up one hash function at a time, sorted by the region
+ * of the filter they fall in, so each region is visited once while it is in
+ * cache and the TLB. K-mers with a bit missing are dropped before the next
+ * round. There is no ending early within a read, so this pays off when the
+ * filter is much larger than the cache and batches have many k-mers per
+ * region. Flags are the same as those of scanWindows.
+ */
+
+//log2 of the bits in a region of the filter (256 KB)
+static const unsigned s_batchRegionBits = 21;
+//most k-mers looked up together, which caps the memory used at about
+//8(h + 4) bytes for each
+static const size_t s_batchMaxKmers = 1 << 22;
+
+/*
+ * Sets KMER_HIT in flags for the k-mers (read and position) with all of
+ * their hash values set in filter
+ */
+inline void lookupBatch(const BloomFilter &filter,
+		const vector<uint64_t> &hashes,
+		const vector<pair<size_t, size_t> > &kmers,
+		vector<vector<unsigned char> > &flags) {
+	const unsigned hashNum = filter.getHashNum();
+	const size_t size = filter.getFilterSize();
+	//k-mers with all bits looked up so far set
+	vector<size_t> candidates(kmers.size());
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		candidates[i] = i;
+	}
+	vector<size_t> sorted;
+	vector<size_t> offsets((size >> s_batchRegionBits) + 2);
+	const unsigned char *bits = filter.getFilter();
+	for (unsigned h = 0; h < hashNum && !candidates.empty(); ++h) {
+		//counting sort by region
+		fill(offsets.begin(), offsets.end(), 0);
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			++offsets[((hashes[candidates[i] * hashNum + h] % size)
+					>> s_batchRegionBits) + 1];
+		}
+		for (size_t i = 1; i < offsets.size(); ++i) {
+			offsets[i] += offsets[i - 1];
+		}
+		sorted.resize(candidates.size());
+		for (size_t i = 0; i < candidates.size(); ++i) {
+			sorted[offsets[(hashes[candidates[i] * hashNum + h] % size)
+					>> s_batchRegionBits]++] = candidates[i];
+		}
+		size_t kept = 0;
+		for (size_t i = 0; i < sorted.size(); ++i) {
+			size_t pos = hashes[sorted[i] * hashNum + h] % size;
+			if (bits[pos / 8] & (1 << (pos % 8))) {
+				candidates[kept++] = sorted[i];
+			}
+		}
+		candidates.resize(kept);
+	}
+	for (size_t i = 0; i < candidates.size(); ++i) {
+		flags[kmers[candidates[i]].first][kmers[candidates[i]].second] |=
+				KMER_HIT;
+	}
+}
+
+/*
+ * Looks up the reads s_batchMaxKmers k-mers (rounded up to whole reads) at a
+ * time
+ */
+inline void scanBatch(const vector<const string*> &recs,
+		const BloomFilter &filter, vector<vector<unsigned char> > &flags) {
+	const unsigned k = filter.getKmerSize();
+	const unsigned hashNum = filter.getHashNum();
+	flags.resize(recs.size());
+	//hash values of every k-mer, and the read and position it starts at
+	vector<uint64_t> hashes;
+	vector<pair<size_t, size_t> > kmers;
+	for (size_t r = 0; r < recs.size(); ++r) {
+		const string &rec = *recs[r];
+		flags[r].assign(rec.size() >= k ? rec.size() - k + 1 : 0, 0);
+		for (ntHashJumpIterator itr(rec, hashNum, k); itr != itr.end();
+				++itr) {
+			flags[r][itr.pos()] = KMER_VALID;
+			hashes.insert(hashes.end(), *itr, *itr + hashNum);
+			kmers.push_back(make_pair(r, itr.pos()));
+		}
+		if (kmers.size() >= s_batchMaxKmers) {
+			lookupBatch(filter, hashes, kmers, flags);
+			hashes.clear();
+			kmers.clear();
+		}
+	}
+	lookupBatch(filter, hashes, kmers, flags);
+}
+
+/*
+ * Sampled evaluation for filters holding only the syncmers of the reference
+ * (see Syncmers.hpp). Only the syncmers of the read are looked up.
+ *
+ * Scores are rescaled to the sampled k-mers so thresholds keep their meaning:
+ * simple and harmonic scores are the fraction of syncmers found, binomial
+ * scores use the number of syncmers as the number of trials, and the match
+ * length is the span of consecutive syncmers found (plus k - 1).
+ * Low complexity syncmers (opt::dust) count as misses.
+ * Stops once thres syncmers are found or antiThres are missed, returning the
+ * number found so far.
+ */
+inline size_t evalSampled(const string &rec, const BloomFilter &filter,
+		const Syncmers &syncmers, double thres, double antiThres,
+		unsigned &maxMatchLen) {
+	const unsigned k = filter.getKmerSize();
+	size_t hits = 0;
+	maxMatchLen = 0;
+	size_t misses = 0;
+	size_t runStart = 0;
+	bool inRun = false;
+	SDust *sduster = opt::dust ? new SDust(rec) : NULL;
+	for (ntHashJumpIterator itr(rec, filter.getHashNum(), k); itr != itr.end();
+			++itr) {
+		size_t pos = itr.pos();
+		if (!syncmers.isSyncmer(pos)) {
+			continue;
+		}
+		if (!(sduster != NULL && sduster->isLowComp(pos))
 				&& filter.contains(*itr)) {
-			if (subtract == NULL || !subtract->contains(*itr))
-				++score;
-			prevPos = itr.pos();
-			++itr;
-			++streak;
+			++hits;
+			if (!inRun) {
+				runStart = pos;
+				inRun = true;
+			}
+			maxMatchLen = max(maxMatchLen, unsigned(pos - runStart + k));
+			if (thres <= hits) {
+				break;
+			}
 		} else {
-			if (streak < opt::streakThreshold) {
-				prevPos = itr.pos();
-				++itr;
-			} else {
-				unsigned skipEnd = itr.pos() + filter.getKmerSize();
-				//skip lookups
-				//TODO Add skip functionality to nthash (faster skip or reconstruct)
-				while (itr.pos() < skipEnd) {
-					prevPos = itr.pos();
-					++itr;
-				}
+			inRun = false;
+			if (antiThres <= ++misses) {
+				break;
 			}
-			streak = 0;
 		}
 	}
-	return calcProbMatches(frameLen, filter.getFPRPrecompute(), score);
+	delete sduster;
+	return hits;
 }
 
-inline bool evalRead(const string &rec, const BloomFilter &filter,
-		double threshold, const BloomFilter *subtract = NULL) {
-
-	if(opt::dust){
-		SDust sduster(rec);
-		switch (opt::scoringMethod) {
-		case opt::LENGTH:
-			return evalMinMatchLen(rec, filter, (unsigned) round(threshold), subtract, &sduster);
-		case opt::HARMONIC:
-			return evalHarmonic(rec, filter, threshold, subtract, &sduster);
-		case opt::BINOMIAL:
-			return evalBinomial(rec, filter, threshold, subtract, &sduster);
-		case opt::SIMPLE:
-		default:
-			return evalSimple(rec, filter, threshold, subtract, &sduster);
-		}
-	}
-	else{
-		switch (opt::scoringMethod) {
-		case opt::LENGTH:
-			return evalMinMatchLen(rec, filter, (unsigned) round(threshold),
-					subtract);
-		case opt::HARMONIC:
-			return evalHarmonic(rec, filter, threshold, subtract);
-		case opt::BINOMIAL:
-			return evalBinomial(rec, filter, threshold, subtract);
-		case opt::SIMPLE:
-		default:
-			return evalSimple(rec, filter, threshold, subtract);
+/*
+ * Same as evalRead, for a filter of syncmers of length syncmerSize
+ */
+inline bool evalSampledRead(const string &rec, const BloomFilter &filter,
+		double threshold, unsigned syncmerSize) {
+	const double inf = numeric_limits<double>::infinity();
+	Syncmers syncmers(rec, filter.getKmerSize(), syncmerSize);
+	const size_t total = syncmers.getCount();
+	unsigned maxMatchLen = 0;
+	double thres = 0;
+	switch (opt::scoringMethod) {
+	case opt::LENGTH:
+		evalSampled(rec, filter, syncmers, inf, inf, maxMatchLen);
+		return maxMatchLen >= (unsigned) round(threshold);
+	case opt::BINOMIAL:
+		if (total == 0) {
+			return false;
+		}
+		thres = calcMinCount(total, filter.getFPRPrecompute(), threshold);
+		break;
+	case opt::HARMONIC:
+	case opt::SIMPLE:
+	default:
+		if (total == 0) {
+			return false;
 		}
+		thres = ceil(threshold * total);
+		break;
 	}
+	return evalSampled(rec, filter, syncmers, thres, total - thres + 1,
+			maxMatchLen) >= thres;
 }
 
-inline bool evalRead(const string &rec, const BloomFilter &filter,
-		double threshold, const BloomFilter &subtract) {
-	return evalRead(rec, filter, threshold, &subtract);
+/*
+ * Same as evalScore, for a filter of syncmers of length syncmerSize
+ */
+inline double evalSampledScore(const string &rec, const BloomFilter &filter,
+		unsigned syncmerSize) {
+	const double inf = numeric_limits<double>::infinity();
+	Syncmers syncmers(rec, filter.getKmerSize(), syncmerSize);
+	const size_t total = syncmers.getCount();
+	unsigned maxMatchLen = 0;
+	size_t hits = evalSampled(rec, filter, syncmers, inf, inf, maxMatchLen);
+	switch (opt::scoringMethod) {
+	case opt::LENGTH:
+		return maxMatchLen;
+	case opt::BINOMIAL:
+		if (total == 0) {
+			return log10(1.0) * -10;
+		}
+		return log10(calcProbMatches(total, filter.getFPRPrecompute(), hits))
+				* -10;
+	case opt::HARMONIC:
+	case opt::SIMPLE:
+	default:
+		return total > 0 ? double(hits) / double(total) : 0;
+	}
 }
 
 /*
- * Computes exhaustively (no ending early to save speed)
+ * True if a k-mer is in the 1 in rate sample kept in prescreen filters. Uses
+ * its first hash value, remixed so the sample is unrelated to the bit
+ * positions of the k-mer in the filter.
  */
-inline double evalScore(const string &rec, const BloomFilter &filter, const BloomFilter *subtract =
-		NULL) {
+inline bool inPrescreenSample(uint64_t hash, unsigned rate) {
+	return ((hash * 0x9E3779B97F4A7C15ULL) >> 32) % rate == 0;
+}
 
-	if(opt::dust){
-		SDust sduster(rec);
-		switch (opt::scoringMethod) {
-		case opt::LENGTH:
-			return evalMinMatchLenScore(rec, filter, subtract, &sduster);
-		case opt::HARMONIC:
-			return evalHarmonicScore(rec, filter, subtract, &sduster);
-		case opt::BINOMIAL:
-			return log10(evalBinomialScore(rec, filter, subtract, &sduster)) * -10;
-		case opt::SIMPLE:
-		default:
-			return evalSimpleScore(rec, filter, subtract, &sduster);
-		}
-	}
-	else{
-		switch (opt::scoringMethod) {
-		case opt::LENGTH:
-			return evalMinMatchLenScore(rec, filter, subtract);
-		case opt::HARMONIC:
-			return evalHarmonicScore(rec, filter, subtract);
-		case opt::BINOMIAL:
-			return log10(evalBinomialScore(rec, filter, subtract)) * -10;
-		case opt::SIMPLE:
-		default:
-			return evalSimpleScore(rec, filter, subtract);
+/*
+ * Looks up the sampled k-mers of rec in a prescreen filter of 1 in rate k-mers
+ * of a reference. Returns false if fewer than minHits are found, in which case
+ * the read can skip full evaluation against the reference filter.
+ * A read with m k-mers in the reference has about m / rate sampled ones, so
+ * with minHits = 1 it is missed with probability about (1 - 1 / rate)^m.
+ */
+inline bool prescreen(const string &rec, const BloomFilter &sketch,
+		unsigned rate, unsigned minHits) {
+	unsigned hits = 0;
+	for (ntHashJumpIterator itr(rec, sketch.getHashNum(),
+			sketch.getKmerSize()); itr != itr.end(); ++itr) {
+		if (inPrescreenSample((*itr)[0], rate) && sketch.contains(*itr)
+				&& ++hits >= minHits) {
+			return true;
 		}
 	}
+	return false;
 }
 }
 ;
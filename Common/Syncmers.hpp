@@ -0,0 +1,94 @@
+/*
+ * Syncmers.hpp
+ *
+ * Selects the k-mers of a sequence that are open syncmers: k-mers whose
+ * smallest s-mer (by canonical ntHash value) is the middle one. Selection only
+ * depends on the k-mer itself, so filters built from syncmers of a reference
+ * can be queried with the syncmers of a read. It is the same on both strands
+ * because k - s must be even. About 1 in k - s + 1 k-mers are selected.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMMON_SYNCMERS_HPP_
+#define COMMON_SYNCMERS_HPP_
+
+#include <string>
+#include <vector>
+#include <limits>
+#include "btl_bloomfilter/vendor/ntHashIterator.hpp"
+
+using namespace std;
+
+class Syncmers {
+public:
+	Syncmers(const string &seq, unsigned k, unsigned s) :
+			m_count(0) {
+		if (seq.size() < k) {
+			return;
+		}
+		//s-mers with non ACGT bases are never the minimum
+		vector<uint64_t> smers(seq.size() - s + 1,
+				numeric_limits<uint64_t>::max());
+		for (ntHashIterator itr(seq, 1, s); itr != itr.end(); ++itr) {
+			smers[itr.pos()] = (*itr)[0];
+		}
+		//position of the next non ACGT base at or after each position
+		vector<size_t> nextInvalid(seq.size() + 1, seq.size());
+		for (size_t i = seq.size(); i-- > 0;) {
+			nextInvalid[i] = isValid(seq[i]) ? nextInvalid[i + 1] : i;
+		}
+		const unsigned window = k - s + 1;
+		const unsigned mid = (k - s) / 2;
+		m_selected.assign(seq.size() - k + 1, false);
+		for (size_t pos = 0; pos < m_selected.size(); ++pos) {
+			if (nextInvalid[pos] < pos + k) {
+				continue;
+			}
+			const uint64_t midHash = smers[pos + mid];
+			bool selected = true;
+			for (unsigned i = 0; i < window && selected; ++i) {
+				//ties are not selected so both strands agree
+				selected = i == mid || smers[pos + i] > midHash;
+			}
+			if (selected) {
+				m_selected[pos] = true;
+				++m_count;
+			}
+		}
+	}
+
+	bool isSyncmer(size_t pos) const {
+		return pos < m_selected.size() && m_selected[pos];
+	}
+
+	/*
+	 * Number of syncmers in the sequence
+	 */
+	size_t getCount() const {
+		return m_count;
+	}
+
+	/*
+	 * Checks the syncmer length s is usable with k-mer size k
+	 */
+	static bool validSize(unsigned k, unsigned s) {
+		return s > 0 && s < k && (k - s) % 2 == 0;
+	}
+
+private:
+	vector<bool> m_selected;
+	size_t m_count;
+
+	static bool isValid(char c) {
+		switch (c) {
+		case 'A': case 'C': case 'G': case 'T':
+		case 'a': case 'c': case 'g': case 't':
+			return true;
+		default:
+			return false;
+		}
+	}
+};
+
+#endif /* COMMON_SYNCMERS_HPP_ */
@@ -16,7 +16,12 @@ KSEQ_INIT(gzFile, gzread)
 
 static void cpy_kstr(kstring_t *dst, const kstring_t *src)
 {
-	if (src->l == 0) return;
+	if (src->l == 0) {
+		//clear fields (e.g. comments) left over from a previous record
+		dst->l = 0;
+		if (dst->s) dst->s[0] = '\0';
+		return;
+	}
 	if (src->l + 1 > dst->m) {
 		dst->m = src->l + 1;
 		kroundup32(dst->m);
@@ -0,0 +1,152 @@
+/*
+ * ntHashJumpIterator.hpp
+ *
+ * ntHash iterator that can jump ahead. Visits the same k-mers with the same
+ * hash values as ntHashIterator, but can skip over k-mers without rolling
+ * the hash through each of them: the hash is recomputed at the new position
+ * when that is cheaper.
+ *
+ * The sequence is not copied, so it must outlive the iterator.
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef COMMON_NTHASHJUMPITERATOR_HPP_
+#define COMMON_NTHASHJUMPITERATOR_HPP_
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <stdint.h>
+#include "btl_bloomfilter/vendor/nthash.hpp"
+
+using namespace std;
+
+class ntHashJumpIterator {
+public:
+	ntHashJumpIterator() :
+			m_seq(NULL), m_h(0), m_k(0), m_end(0), m_pos(
+					numeric_limits<size_t>::max()), m_fhVal(0), m_rhVal(0) {
+	}
+
+	ntHashJumpIterator(const string &seq, unsigned h, unsigned k,
+			size_t pos = 0) :
+			m_seq(&seq), m_h(h), m_k(k), m_end(
+					seq.size() >= k ? seq.size() - k + 1 : 0), m_hVec(h), m_pos(
+					pos), m_fhVal(0), m_rhVal(0) {
+		init();
+	}
+
+	/*
+	 * Moves to the first k-mer at least dist positions ahead. Returns the
+	 * number of k-mers passed over, which (as with ++) excludes those with
+	 * non-ACGT characters, and sets lastPos to the last one passed over.
+	 */
+	size_t skip(size_t dist, size_t &lastPos) {
+		const size_t target = m_pos + dist;
+		const size_t stop = min(target, m_end);
+		//k-mers before stop only contain non-ACGT characters if one is
+		//ahead of the current k-mer
+		bool clean = true;
+		for (size_t i = m_pos + m_k; i < stop + m_k - 1 && clean; ++i) {
+			clean = seedTab[(unsigned char) (*m_seq)[i]] != seedN;
+		}
+		if (!clean) {
+			size_t passed = 0;
+			while (m_pos < target) {
+				lastPos = m_pos;
+				++passed;
+				next();
+			}
+			return passed;
+		}
+		const size_t passed = stop - m_pos;
+		lastPos = stop - 1;
+		if (target >= m_end) {
+			m_pos = numeric_limits<size_t>::max();
+		} else if (dist * (m_h + 1) < m_k + m_h) {
+			//rolling costs one character and h hash values per position,
+			//recomputing costs k characters and h hash values
+			while (m_pos < target) {
+				next();
+			}
+		} else {
+			m_pos = target;
+			init();
+		}
+		return passed;
+	}
+
+	size_t pos() const {
+		return m_pos;
+	}
+
+	const uint64_t *operator*() const {
+		return m_hVec.data();
+	}
+
+	const uint64_t *operator->() const {
+		return m_hVec.data();
+	}
+
+	bool operator==(const ntHashJumpIterator &it) const {
+		return m_pos == it.m_pos;
+	}
+
+	bool operator!=(const ntHashJumpIterator &it) const {
+		return !(*this == it);
+	}
+
+	ntHashJumpIterator &operator++() {
+		next();
+		return *this;
+	}
+
+	static const ntHashJumpIterator end() {
+		return ntHashJumpIterator();
+	}
+
+private:
+	const string *m_seq;
+	unsigned m_h;
+	unsigned m_k;
+	//one past the last k-mer position
+	size_t m_end;
+	vector<uint64_t> m_hVec;
+	size_t m_pos;
+	uint64_t m_fhVal;
+	uint64_t m_rhVal;
+
+	/*
+	 * Computes the hash of the first k-mer at or after m_pos without
+	 * non-ACGT characters
+	 */
+	void init() {
+		unsigned locN = 0;
+		while (m_pos < m_end
+				&& !NTMC64(m_seq->data() + m_pos, m_k, m_h, m_fhVal, m_rhVal,
+						locN, m_hVec.data())) {
+			m_pos += locN + 1;
+		}
+		if (m_pos >= m_end) {
+			m_pos = numeric_limits<size_t>::max();
+		}
+	}
+
+	void next() {
+		++m_pos;
+		if (m_pos >= m_end) {
+			m_pos = numeric_limits<size_t>::max();
+			return;
+		}
+		if (seedTab[(unsigned char) (*m_seq)[m_pos + m_k - 1]] == seedN) {
+			m_pos += m_k;
+			init();
+		} else {
+			NTMC64((*m_seq)[m_pos - 1], (*m_seq)[m_pos - 1 + m_k], m_k, m_h,
+					m_fhVal, m_rhVal, m_hVec.data());
+		}
+	}
+};
+
+#endif /* COMMON_NTHASHJUMPITERATOR_HPP_ */
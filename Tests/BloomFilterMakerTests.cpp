@@ -5,19 +5,462 @@
 
 #include "BioBloomMaker/BloomFilterGenerator.h"
 #include "BioBloomMaker/BloomFilterGenerator.cpp"
+#include "BioBloomMaker/ManifestBuilder.hpp"
+#include "Common/BloomFilterInfo.h"
 #include <string>
 #include <assert.h>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
-#include <fstream>
+#include <cstdlib>
 #include "btl_bloomfilter/BloomFilter.hpp"
 #include "btl_bloomfilter/ntHashIterator.hpp"
 #include "omp.h"
 
 using namespace std;
 
+static const char s_bases[] = "ACGT";
+
+static string randomSeq(size_t length) {
+	string seq(length, 'A');
+	for (size_t i = 0; i < length; ++i) {
+		seq[i] = s_bases[rand() % 4];
+	}
+	return seq;
+}
+
+static string readFile(const string &fileName) {
+	ifstream file(fileName.c_str(), ios::binary);
+	assert(file.is_open());
+	stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+/*
+ * Bit array of a filter file
+ */
+static string readBits(const string &fileName) {
+	return readFile(fileName).substr(sizeof(BloomFilter::FileHeader));
+}
+
+static BloomFilter::FileHeader readHeader(const string &fileName) {
+	BloomFilter::FileHeader header;
+	readFile(fileName).copy(reinterpret_cast<char*>(&header), sizeof(header));
+	return header;
+}
+
+static void assertSameFilter(const string &file1, const string &file2) {
+	BloomFilter::FileHeader header1 = readHeader(file1);
+	BloomFilter::FileHeader header2 = readHeader(file2);
+	assert(header1.size == header2.size);
+	assert(header1.nhash == header2.nhash);
+	assert(header1.kmer == header2.kmer);
+	assert(readBits(file1) == readBits(file2));
+}
+
+/*
+ * Writes read pairs taken from ref, with errors, Ns and unrelated pairs
+ */
+static void writeTestReads(const string &ref, const string &file1,
+		const string &file2, unsigned pairs) {
+	ofstream out1(file1.c_str());
+	ofstream out2(file2.c_str());
+	for (unsigned i = 0; i < pairs; ++i) {
+		size_t start = rand() % (ref.length() - 300);
+		string read1 = ref.substr(start, 100);
+		string read2 = ref.substr(start + 150, 100);
+		for (unsigned j = 0; j < 3; ++j) {
+			read1[rand() % 100] = s_bases[rand() % 4];
+			read2[rand() % 100] = s_bases[rand() % 4];
+		}
+		if (rand() % 10 == 0) {
+			read1[rand() % 100] = 'N';
+		}
+		if (rand() % 3 == 0) {
+			read1 = randomSeq(100);
+		}
+		out1 << "@r" << i << "/1\n" << read1 << "\n+\n" << string(100, 'I')
+				<< "\n";
+		out2 << "@r" << i << "/2\n" << read2 << "\n+\n" << string(100, 'I')
+				<< "\n";
+	}
+}
+
+/*
+ * Builds a progressive filter from a seed of ref with the reads and returns
+ * the filter file
+ */
+static string buildProgressive(const string &seedFile, unsigned threads,
+		createMode mode) {
+	omp_set_num_threads(threads);
+	vector<string> seedFiles(1, seedFile);
+	BloomFilterGenerator gen(seedFiles, 25, 3, 200000);
+	gen.setFilterSize(64 * 100000);
+	gen.generateProgressive("progressive.bf", 0.15, "reads_1.fq",
+			"reads_2.fq", mode, false);
+	string filter = readFile("progressive.bf");
+	remove("progressive.bf");
+	return filter;
+}
+
+/*
+ * --deterministic recruits the pairs recruited when they are evaluated one at
+ * a time in input order, for any number of threads
+ */
+static void testDeterministicProgressive() {
+	srand(7);
+	string ref = randomSeq(20000);
+	ofstream seed("seed.fa");
+	seed << ">seed\n" << ref.substr(0, 400) << "\n";
+	seed.close();
+	writeTestReads(ref, "reads_1.fq", "reads_2.fq", 20000);
+
+	createMode modes[] = { PROG_STD, PROG_INC };
+	for (unsigned i = 0; i < 2; ++i) {
+		opt::deterministic = false;
+		string serial = buildProgressive("seed.fa", 1, modes[i]);
+		opt::deterministic = true;
+		assert(buildProgressive("seed.fa", 1, modes[i]) == serial);
+		assert(buildProgressive("seed.fa", 3, modes[i]) == serial);
+		assert(buildProgressive("seed.fa", 8, modes[i]) == serial);
+	}
+	opt::deterministic = false;
+	remove("seed.fa");
+	remove("reads_1.fq");
+	remove("reads_2.fq");
+	cout << "Deterministic progressive build tests done" << endl;
+}
+
+static void writeFasta(const string &fileName, const string &seq) {
+	ofstream out(fileName.c_str());
+	out << ">" << fileName << "\n" << seq << "\n";
+}
+
+/*
+ * Builds a filter with a prescreen of 1 in 4 k-mers from files, returning the
+ * number of k-mers inserted
+ */
+static size_t buildWithPrescreen(const vector<string> &files,
+		const string &fileName, size_t &prescreenEntries) {
+	BloomFilterGenerator gen(files, 25, 3, 1000);
+	gen.setFilterSize(64 * 1000);
+	gen.setPrescreen(4, 64 * 300);
+	gen.generate(fileName);
+	prescreenEntries = gen.getPrescreenEntries();
+	return gen.getTotalEntries();
+}
+
+/*
+ * Appending files to a filter and its prescreen in place gives the filters
+ * built from all of the files, the new k-mers are estimated without those
+ * already in the filter, and the projected FPR is the FPR after the update
+ */
+static void testAppend() {
+	omp_set_num_threads(1);
+	srand(11);
+	writeFasta("old.fa", randomSeq(3000));
+	writeFasta("new.fa", randomSeq(2000));
+	vector<string> oldFiles(1, "old.fa");
+	vector<string> newFiles(1, "new.fa");
+	vector<string> allFiles(oldFiles);
+	allFiles.push_back("new.fa");
+
+	size_t allPrescreen;
+	size_t allEntries = buildWithPrescreen(allFiles, "all.bf", allPrescreen);
+	size_t oldPrescreen;
+	size_t oldEntries = buildWithPrescreen(oldFiles, "app.bf", oldPrescreen);
+
+	BloomFilterGenerator gen(newFiles, 25, 3, 1000);
+	gen.setPrescreen(4, 0);
+	MappedFilter filter("app.bf");
+	MappedFilter prescreen("app_prescreen.bf");
+	size_t newEntries = gen.estimateNewEntries(filter);
+	assert(newEntries > 1800 && newEntries < 2200);
+	gen.append(filter, &prescreen);
+	assert(oldEntries + gen.getTotalEntries() == allEntries);
+	assert(oldPrescreen + gen.getPrescreenEntries() == allPrescreen);
+	filter.setStats(0.5, allEntries);
+	filter.close();
+	prescreen.close();
+	assert(readBits("app.bf") == readBits("all.bf"));
+	assert(readBits("app_prescreen.bf") == readBits("all_prescreen.bf"));
+	BloomFilter::FileHeader header = readHeader("app.bf");
+	assert(header.size == 64 * 1000 && header.nhash == 3 && header.kmer == 25);
+	assert(header.dFPR == 0.5 && header.nEntry == allEntries);
+
+	//k-mers already in the filter are not counted as new
+	vector<string> bothFiles(1, "both.fa");
+	writeFasta("both.fa", readFile("new.fa").substr(8, 2000)
+			+ randomSeq(500));
+	BloomFilterGenerator genBoth(bothFiles, 25, 3, 1000);
+	MappedFilter updated("app.bf");
+	newEntries = genBoth.estimateNewEntries(updated);
+	assert(newEntries > 400 && newEntries < 600);
+
+	BloomFilterInfo info("app", 25, 3, 0.01, oldEntries, oldFiles);
+	info.setFilterSize(64 * 1000);
+	info.setTotalNum(oldEntries);
+	info.setRedundancy(0);
+	info.setDistinctEstimate(oldEntries, 0.01);
+	double projectedFPR = info.projectFPR(gen.getTotalEntries());
+	assert(projectedFPR > info.getFPR());
+	info.addEntries(gen.getTotalEntries(), 0, newFiles);
+	assert(info.getTotalNum() == allEntries);
+	assert(info.getFPR() == projectedFPR);
+	info.printInfoFile("app.txt");
+	assert(readFile("app.txt").find("distinct_kmer_estimate") == string::npos);
+
+	const char *files[] = { "old.fa", "new.fa", "both.fa", "all.bf",
+			"all_prescreen.bf", "app.bf", "app_prescreen.bf", "app.txt" };
+	for (unsigned i = 0; i < 8; ++i) {
+		remove(files[i]);
+	}
+	cout << "Append tests done" << endl;
+}
+
+/*
+ * Read pairs written to a spill file are read back unchanged, with names and
+ * quality values only if they are kept
+ */
+static void testReadSpill() {
+	const char *seqs[] = { "", "A", "acg", "ACGT", "ACGTa", "NNNNN",
+			"acgtACGTnNacgtRYacgt", "ggggggggggggggggggggggggggggggggg.T",
+			"TTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTt" };
+	const unsigned count = 9;
+	for (unsigned keep = 0; keep < 2; ++keep) {
+		{
+			ReadSpillWriter writer("spill.bin", keep);
+			for (unsigned i = 0; i + 1 < count; ++i) {
+				string seq1 = seqs[i];
+				string seq2 = seqs[i + 1];
+				writer.writePair("r1", seq1, string(seq1.length(), 'I'),
+						"read2", seq2, string(seq2.length(), '#'));
+			}
+			assert(writer.getPairs() == count - 1);
+		}
+		ReadSpillReader reader("spill.bin", keep);
+		string header, seq, qual;
+		for (unsigned i = 0; i + 1 < count; ++i) {
+			assert(reader.read(header, seq, qual));
+			assert(seq == seqs[i]);
+			assert(header == (keep ? "r1" : ""));
+			assert(qual == (keep ? string(seq.length(), 'I') : ""));
+			assert(reader.read(header, seq, qual));
+			assert(seq == seqs[i + 1]);
+			assert(header == (keep ? "read2" : ""));
+			assert(qual == (keep ? string(seq.length(), '#') : ""));
+		}
+		assert(!reader.read(header, seq, qual));
+	}
+	remove("spill.bin");
+	cout << "Read spill tests done" << endl;
+}
+
+/*
+ * A filter built through on-disk buckets (--max_mem) in several regions is
+ * the filter built in memory
+ */
+static void testExternalBuild() {
+	omp_set_num_threads(3);
+	srand(13);
+	writeFasta("ref.fa", randomSeq(20000));
+	vector<string> files(1, "ref.fa");
+	BloomFilterGenerator gen(files, 25, 3, 20000);
+	gen.setFilterSize(64 * 10000);
+	gen.generate("memory.bf");
+
+	//80000 byte filter in 100000 bytes: a quarter for the buffers leaves 2
+	//regions, and 3 threads need at least 12 KB of buffers per region
+	BloomFilterGenerator genExternal(files, 25, 3, 20000);
+	genExternal.setFilterSize(64 * 10000);
+	genExternal.generateExternal("external.bf", "", 100000, "ext");
+	assertSameFilter("external.bf", "memory.bf");
+
+	//in 40000 bytes the buffers of 1 thread for 3 regions take 12 KB
+	omp_set_num_threads(1);
+	genExternal.generateExternal("external.bf", "", 40000, "ext");
+	assertSameFilter("external.bf", "memory.bf");
+
+	remove("ref.fa");
+	remove("memory.bf");
+	remove("external.bf");
+	cout << "External build tests done" << endl;
+}
+
+/*
+ * Filters built from a manifest are the filters generate() builds, for jobs
+ * sharing their files with and without a subtract filter, and for groups read
+ * at the same time
+ */
+static void testManifest() {
+	omp_set_num_threads(4);
+	srand(23);
+	string shared = randomSeq(6000);
+	writeFasta("shared1.fa", shared.substr(0, 3000));
+	writeFasta("shared2.fa", shared.substr(3000));
+	writeFasta("other.fa", randomSeq(4000));
+	writeFasta("sub.fa", shared.substr(1000, 2000));
+	vector<string> subFiles(1, "sub.fa");
+	BloomFilterGenerator subGen(subFiles, 25, 3, 2000);
+	subGen.setFilterSize(64 * 1000);
+	subGen.generate("sub.bf");
+	BloomFilterInfo subInfo("sub", 25, 3, 0.02, 2000, subFiles);
+	subInfo.setTotalNum(subGen.getTotalEntries());
+	subInfo.setRedundancy(0);
+	subInfo.printInfoFile("sub.txt");
+
+	vector<FilterJob> jobs(3);
+	jobs[0].filterID = "plain";
+	jobs[0].files.push_back("shared1.fa");
+	jobs[0].files.push_back("shared2.fa");
+	jobs[1] = jobs[0];
+	jobs[1].filterID = "subtracted";
+	jobs[1].subtractFilter = "sub.bf";
+	jobs[2].filterID = "other";
+	jobs[2].files.push_back("other.fa");
+	const size_t entries = 6000;
+	ManifestBuilder builder(jobs, "", 25, 3, 0.02, entries);
+	builder.build();
+
+	size_t filterSize = BloomFilterInfo("plain", 25, 3, 0.02, entries,
+			jobs[0].files).getCalcuatedFilterSize();
+	BloomFilterGenerator gen(jobs[0].files, 25, 3, entries);
+	gen.setFilterSize(filterSize);
+	gen.generate("expected.bf");
+	assertSameFilter("plain.bf", "expected.bf");
+	gen.generate("expected.bf", "sub.bf");
+	assertSameFilter("subtracted.bf", "expected.bf");
+	assert(readBits("subtracted.bf") != readBits("plain.bf"));
+	BloomFilterGenerator otherGen(jobs[2].files, 25, 3, entries);
+	otherGen.setFilterSize(filterSize);
+	otherGen.generate("expected.bf");
+	assertSameFilter("other.bf", "expected.bf");
+
+	const char *files[] = { "shared1.fa", "shared2.fa", "other.fa", "sub.fa",
+			"sub.bf", "sub.txt", "expected.bf", "plain.bf", "plain.txt",
+			"subtracted.bf", "subtracted.txt", "other.bf", "other.txt" };
+	for (unsigned i = 0; i < 13; ++i) {
+		remove(files[i]);
+	}
+	cout << "Manifest tests done" << endl;
+}
+
+/*
+ * Folding a filter to a divisor of its size gives the filter built at that
+ * size
+ */
+static void testFold() {
+	omp_set_num_threads(1);
+	srand(17);
+	writeFasta("ref.fa", randomSeq(5000));
+	vector<string> files(1, "ref.fa");
+	BloomFilterGenerator gen(files, 25, 3, 5000);
+	gen.setFilterSize(64 * 2520);
+	gen.generate("small.bf");
+	gen.setFilterSize(64 * 2520 * 4);
+	gen.generate("folded.bf");
+
+	//2520 words is the smallest size of at least 2519 words dividing the size
+	assert(BloomFilterGenerator::foldFilter("folded.bf", 64 * (2520 - 1))
+			== 64 * 2520);
+	assert(readFile("folded.bf") == readFile("small.bf"));
+	//no size between 2519 and 2520 words divides 2520 words
+	assert(BloomFilterGenerator::foldFilter("folded.bf", 64 * 2519)
+			== 64 * 2520);
+	assert(readFile("folded.bf") == readFile("small.bf"));
+
+	remove("ref.fa");
+	remove("small.bf");
+	remove("folded.bf");
+	cout << "Fold tests done" << endl;
+}
+
+/*
+ * Long records read in pieces have each of their k-mers in exactly one piece,
+ * in order, and a filter loaded from the pieces by several threads is the
+ * filter of all the k-mers
+ */
+static void testChunkedLoading() {
+	srand(19);
+	const unsigned kmerSize = 25;
+	vector<string> records;
+	records.push_back(randomSeq(1000));
+	records.push_back(randomSeq(10));
+	records.push_back(randomSeq(kmerSize));
+	records.push_back(randomSeq(3001));
+	ofstream out("records.fa");
+	for (unsigned i = 0; i < records.size(); ++i) {
+		out << ">r" << i << "\n" << records[i] << "\n";
+	}
+	out.close();
+
+	size_t chunkSizes[] = { 1, 7, 100, 1000, 1 << 20 };
+	for (unsigned i = 0; i < 5; ++i) {
+		gzFile fp = gzopen("records.fa", "r");
+		kseq_t *seq = kseq_init(fp);
+		ChunkedSeqReader reader(seq, kmerSize, chunkSizes[i]);
+		//first bases of the k-mers of the pieces of each record
+		vector<string> starts;
+		string piece, name;
+		while (reader.next(piece, name)) {
+			assert(piece.length() <= chunkSizes[i] + kmerSize - 1);
+			if (reader.startsRecord()) {
+				assert(name == "r" + string(1, '0' + starts.size()));
+				starts.push_back(piece.length() < kmerSize ? piece : "");
+			}
+			if (piece.length() >= kmerSize) {
+				starts.back() += piece.substr(0, piece.length() - kmerSize + 1);
+			}
+		}
+		assert(starts.size() == records.size());
+		for (unsigned j = 0; j < records.size(); ++j) {
+			const string &record = records[j];
+			if (record.length() < kmerSize) {
+				assert(starts[j] == record);
+			} else {
+				assert(starts[j]
+						== record.substr(0, record.length() - kmerSize + 1));
+			}
+		}
+		assert(!reader.next(piece));
+		kseq_destroy(seq);
+		gzclose(fp);
+	}
+
+	//a record of several default sized pieces
+	omp_set_num_threads(4);
+	string ref = randomSeq(2 * ChunkedSeqReader::s_defaultChunkSize + 1000);
+	writeFasta("long.fa", ref);
+	vector<string> files(1, "long.fa");
+	BloomFilterGenerator gen(files, kmerSize, 3, ref.length());
+	gen.setFilterSize(64 * 200000);
+	gen.generate("chunked.bf");
+	BloomFilter direct(64 * 200000, 3, kmerSize);
+	for (ntHashIterator itr(ref, 3, kmerSize); itr != itr.end(); ++itr) {
+		direct.insert(*itr);
+	}
+	direct.storeFilter("direct.bf");
+	const size_t headerBytes = sizeof(BloomFilter::FileHeader);
+	assert(readFile("chunked.bf").substr(headerBytes)
+			== readFile("direct.bf").substr(headerBytes));
+
+	remove("records.fa");
+	remove("long.fa");
+	remove("chunked.bf");
+	remove("direct.bf");
+	cout << "Chunked loading tests done" << endl;
+}
+
 int main() {
+	testReadSpill();
+	testDeterministicProgressive();
+	testAppend();
+	testExternalBuild();
+	testManifest();
+	testFold();
+	testChunkedLoading();
 
 	//Load some testdata
 	string fileName = "ecoli.fasta";
@@ -0,0 +1,142 @@
+/*
+ * BloomFilterOpsTests.cpp
+ *
+ * Tests of the filter operations of biobloomfilterops on small filters
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "BioBloomMaker/FilterOps.hpp"
+#include "btl_bloomfilter/BloomFilter.hpp"
+#include "btl_bloomfilter/ntHashIterator.hpp"
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+static const size_t s_filterBits = 64 * 2000;
+static const unsigned s_hashNum = 3;
+static const unsigned s_kmerSize = 25;
+
+static string randomSeq(size_t length) {
+	static const char bases[] = "ACGT";
+	string seq(length, 'A');
+	for (size_t i = 0; i < length; ++i) {
+		seq[i] = bases[rand() % 4];
+	}
+	return seq;
+}
+
+static void insertSeq(BloomFilter &filter, const string &seq) {
+	for (ntHashIterator itr(seq, s_hashNum, s_kmerSize); itr != itr.end();
+			++itr) {
+		filter.insert(*itr);
+	}
+}
+
+/*
+ * Fraction of the k-mers of seq found in filter
+ */
+static double fractionFound(const BloomFilter &filter, const string &seq) {
+	size_t found = 0;
+	size_t total = 0;
+	for (ntHashIterator itr(seq, s_hashNum, s_kmerSize); itr != itr.end();
+			++itr) {
+		found += filter.contains(*itr);
+		++total;
+	}
+	return double(found) / double(total);
+}
+
+/*
+ * Combines the filter files by op into out.bf and loads the result
+ */
+static BloomFilter *runOp(FilterOps::Operation op,
+		const vector<string> &fileNames, size_t &pop) {
+	vector<FILE*> files(fileNames.size());
+	BloomFilter::FileHeader header;
+	for (unsigned i = 0; i < fileNames.size(); ++i) {
+		files[i] = FilterOps::openFilter(fileNames[i], header);
+	}
+	FILE *output = fopen("out.bf", "wb");
+	assert(output != NULL);
+	fwrite(&header, sizeof(BloomFilter::FileHeader), 1, output);
+	pop = FilterOps::combineFilters(op, files, fileNames, s_filterBits / 8,
+			output, "out.bf");
+	fclose(output);
+	for (unsigned i = 0; i < files.size(); ++i) {
+		fclose(files[i]);
+	}
+	BloomFilter *result = new BloomFilter("out.bf");
+	remove("out.bf");
+	return result;
+}
+
+int main() {
+	srand(5);
+	string seqA = randomSeq(3000);
+	string seqB = randomSeq(3000);
+	string shared = randomSeq(1000);
+
+	BloomFilter filterA(s_filterBits, s_hashNum, s_kmerSize);
+	BloomFilter filterB(s_filterBits, s_hashNum, s_kmerSize);
+	BloomFilter filterAll(s_filterBits, s_hashNum, s_kmerSize);
+	insertSeq(filterA, seqA);
+	insertSeq(filterA, shared);
+	insertSeq(filterB, seqB);
+	insertSeq(filterB, shared);
+	insertSeq(filterAll, seqA);
+	insertSeq(filterAll, seqB);
+	insertSeq(filterAll, shared);
+	filterA.storeFilter("a.bf");
+	filterB.storeFilter("b.bf");
+	vector<string> fileNames;
+	fileNames.push_back("a.bf");
+	fileNames.push_back("b.bf");
+
+	//union has the bits of a filter built from all of the k-mers
+	size_t pop;
+	BloomFilter *result = runOp(FilterOps::UNION, fileNames, pop);
+	assert(pop == filterAll.getPop());
+	assert(result->getPop() == pop);
+	assert(fractionFound(*result, seqA) == 1.0);
+	assert(fractionFound(*result, seqB) == 1.0);
+	delete result;
+
+	//intersection keeps the shared k-mers and few of the others
+	result = runOp(FilterOps::INTERSECT, fileNames, pop);
+	assert(pop < filterA.getPop() && pop < filterB.getPop());
+	assert(fractionFound(*result, shared) == 1.0);
+	assert(fractionFound(*result, seqA) < 0.1);
+	delete result;
+
+	//subtraction removes the k-mers of b, and loses about the expected
+	//fraction of the k-mers only in a
+	vector<FILE*> files(fileNames.size());
+	BloomFilter::FileHeader header;
+	for (unsigned i = 0; i < fileNames.size(); ++i) {
+		files[i] = FilterOps::openFilter(fileNames[i], header);
+	}
+	size_t subtractPop = FilterOps::unionPopcount(files, fileNames, 1,
+			s_filterBits / 8);
+	assert(subtractPop == filterB.getPop());
+	for (unsigned i = 0; i < files.size(); ++i) {
+		fclose(files[i]);
+	}
+	double loss = FilterOps::subtractLoss(subtractPop, s_filterBits,
+			s_hashNum);
+	result = runOp(FilterOps::SUBTRACT, fileNames, pop);
+	assert(fractionFound(*result, seqB) == 0.0);
+	assert(fractionFound(*result, shared) == 0.0);
+	assert(fabs(1.0 - fractionFound(*result, seqA) - loss) < 0.03);
+	delete result;
+
+	remove("a.bf");
+	remove("b.bf");
+	cout << "Filter operation tests done" << endl;
+	return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * HyperLogLogTests.cpp
+ *
+ * Tests of the distinct k-mer estimates of HyperLogLog
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "Common/HyperLogLog.hpp"
+#include <assert.h>
+#include <iostream>
+#include <cmath>
+#include <stdint.h>
+
+using namespace std;
+
+static const unsigned s_precision = 10;
+//standard errors an estimate may be off by
+static const double s_maxErrors = 4.0;
+
+/*
+ * Adds the values first to first + count - 1, each twice
+ */
+static void addRange(HyperLogLog &hll, uint64_t first, uint64_t count) {
+	for (uint64_t i = first; i < first + count; ++i) {
+		hll.add(i);
+		hll.add(i);
+	}
+}
+
+static void checkEstimate(const HyperLogLog &hll, uint64_t distinct) {
+	double error = fabs(hll.estimate() - double(distinct)) / double(distinct);
+	assert(error < s_maxErrors * hll.relativeError());
+}
+
+int main() {
+	HyperLogLog empty(s_precision);
+	assert(empty.estimate() == 0.0);
+
+	//counts up to 2.5 times the 1024 registers are linearly counted, the
+	//others use the raw estimate
+	const uint64_t counts[] = { 10, 100, 500, 2000, 5000, 50000, 1000000 };
+	for (unsigned i = 0; i < 7; ++i) {
+		for (uint64_t offset = 0; offset < 5; ++offset) {
+			HyperLogLog hll(s_precision);
+			addRange(hll, offset * counts[i] * 7919, counts[i]);
+			checkEstimate(hll, counts[i]);
+		}
+	}
+
+	//merging estimators gives the estimator of all of their values
+	HyperLogLog all(s_precision);
+	addRange(all, 0, 30000);
+	HyperLogLog first(s_precision);
+	addRange(first, 0, 20000);
+	HyperLogLog second(s_precision);
+	addRange(second, 10000, 20000);
+	HyperLogLog merged(s_precision);
+	merged.merge(second);
+	merged.merge(first);
+	assert(merged.estimate() == all.estimate());
+	first.merge(second);
+	assert(first.estimate() == all.estimate());
+	first.merge(empty);
+	assert(first.estimate() == all.estimate());
+	checkEstimate(first, 30000);
+
+	cout << "HyperLogLog tests done" << endl;
+	return 0;
+}
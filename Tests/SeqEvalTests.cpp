@@ -1,9 +1,113 @@
 #include "Common/SeqEval.h"
 #include <string>
+#include <vector>
 #include <iostream>
+#include <cstdlib>
 
 using namespace std;
 
+/*
+ * Scores computed one k-mer at a time, as before hit bitmaps, for comparison
+ */
+static double refScore(const string &rec, const BloomFilter &filter,
+		const BloomFilter *subtract, SDust *sduster,
+		opt::ScoringMethod method) {
+	const unsigned k = filter.getKmerSize();
+	double score = 0;
+	unsigned matchLen = 0;
+	unsigned streak = 0;
+	ntHashJumpIterator itr(rec, k, k);
+	size_t prevPos = 0;
+	while (itr != itr.end()) {
+		if (itr.pos() != prevPos + 1) {
+			streak = 0;
+			matchLen = 0;
+		}
+		if (!(sduster != NULL && sduster->isLowComp(itr.pos()))
+				&& filter.contains(*itr)) {
+			if (subtract == NULL || !subtract->contains(*itr)) {
+				if (method == opt::HARMONIC) {
+					score += streak == 0 ?
+							0.5 : 1.0 - 1.0 / (1.0 + double(streak));
+				} else if (method == opt::SIMPLE) {
+					score += streak == 0 ? 0.5 : 1.0;
+				} else {
+					++score;
+				}
+				matchLen = matchLen == 0 ? k : matchLen + 1;
+			}
+			prevPos = itr.pos();
+			++itr;
+			++streak;
+		} else {
+			if (method == opt::LENGTH || streak < opt::streakThreshold) {
+				prevPos = itr.pos();
+				++itr;
+			} else {
+				size_t lastPos = 0;
+				itr.skip(k, lastPos);
+				prevPos = lastPos;
+			}
+			streak = 0;
+			matchLen = 0;
+		}
+	}
+	switch (method) {
+	case opt::LENGTH:
+		return matchLen;
+	case opt::BINOMIAL:
+		return log10(
+				SeqEval::calcProbMatches(rec.size() - k + 1,
+						filter.getFPRPrecompute(), unsigned(score))) * -10;
+	default:
+		return SeqEval::normalizeScore(score, k, rec.size());
+	}
+}
+
+/*
+ * Compares the bitmap scores with refScore for every scoring method, with and
+ * without dust and a subtract filter
+ */
+static bool compareBitmapScores(const vector<string> &reads,
+		const BloomFilter &filter, const BloomFilter &subtract) {
+	const opt::ScoringMethod methods[] = { opt::SIMPLE, opt::LENGTH,
+			opt::HARMONIC, opt::BINOMIAL };
+	bool same = true;
+	for (unsigned m = 0; m < 4; ++m) {
+		opt::scoringMethod = methods[m];
+		for (unsigned dust = 0; dust < 2; ++dust) {
+			for (unsigned sub = 0; sub < 2; ++sub) {
+				const BloomFilter *bfsub = sub ? &subtract : NULL;
+				SeqEval::ScoreEvaluator eval = SeqEval::scoreEvaluator<
+						opt::SIMPLE>(dust, sub);
+				switch (methods[m]) {
+				case opt::LENGTH:
+					eval = SeqEval::scoreEvaluator<opt::LENGTH>(dust, sub);
+					break;
+				case opt::HARMONIC:
+					eval = SeqEval::scoreEvaluator<opt::HARMONIC>(dust, sub);
+					break;
+				case opt::BINOMIAL:
+					eval = SeqEval::scoreEvaluator<opt::BINOMIAL>(dust, sub);
+					break;
+				default:
+					break;
+				}
+				for (unsigned i = 0; i < reads.size(); ++i) {
+					SDust sduster(reads[i]);
+					same = same
+							&& eval(reads[i], filter, bfsub)
+									== refScore(reads[i], filter, bfsub,
+											dust ? &sduster : NULL,
+											methods[m]);
+				}
+			}
+		}
+	}
+	opt::scoringMethod = opt::SIMPLE;
+	return same;
+}
+
 int main()
 {
 	const size_t filterBits = 8000;
@@ -39,4 +143,65 @@ int main()
 	else
 		cerr << "FAILED" << endl;
 
+	cerr << "Query 'AAAAANNNNN' in windows of 2 k-mers gives the same "
+			<< "results... ";
+
+	vector<unsigned char> flags;
+	SeqEval::scanWindows(seq2, bloom, NULL, 2, flags);
+	bool same = true;
+	for (unsigned len = 4; len <= 7; ++len) {
+		same = same && SeqEval::replayRead(flags, bloom, seq2.size(), len)
+				== SeqEval::evalRead(seq2, bloom, len);
+	}
+	same = same && SeqEval::replayScore(flags, bloom, seq2.size())
+			== SeqEval::evalScore(seq2, bloom);
+
+	if (same)
+		cerr << "PASSED" << endl;
+	else
+		cerr << "FAILED" << endl;
+
+	cerr << "Bitmap scores of reads with errors, Ns and low complexity "
+			<< "regions match per k-mer scoring... ";
+
+	const char bases[] = "ACGT";
+	srand(3);
+	string ref(3000, 'A');
+	for (size_t i = 0; i < ref.size(); ++i) {
+		ref[i] = bases[rand() % 4];
+	}
+	//low complexity stretches for dust to mask
+	ref.replace(500, 80, 80, 'A');
+	for (size_t i = 1500; i < 1580; i += 2) {
+		ref.replace(i, 2, "AT");
+	}
+	BloomFilter refFilter(64 * 1000, 3, 15);
+	BloomFilter subFilter(64 * 1000, 4, 15);
+	for (ntHashIterator i(ref, 4, 15); i != i.end(); ++i) {
+		refFilter.insert(*i);
+		if (i.pos() > 2000) {
+			subFilter.insert(*i);
+		}
+	}
+	vector<string> reads;
+	for (unsigned i = 0; i < 500; ++i) {
+		string read = ref.substr(rand() % (ref.size() - 300), 150 + i % 150);
+		for (unsigned j = rand() % 8; j > 0; --j) {
+			read[rand() % read.size()] = bases[rand() % 4];
+		}
+		if (i % 4 == 0) {
+			read[rand() % read.size()] = 'N';
+		}
+		reads.push_back(read);
+	}
+	same = compareBitmapScores(reads, refFilter, subFilter);
+	opt::streakThreshold = 1;
+	same = same && compareBitmapScores(reads, refFilter, subFilter);
+	opt::streakThreshold = 3;
+
+	if (same)
+		cerr << "PASSED" << endl;
+	else
+		cerr << "FAILED" << endl;
+
 }
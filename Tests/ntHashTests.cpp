@@ -1,11 +1,52 @@
 #include <vector>
 #include "btl_bloomfilter/stHashIterator.hpp"
+#include "btl_bloomfilter/ntHashIterator.hpp"
+#include "Common/ntHashJumpIterator.hpp"
 #include <string>
 #include <iostream>
 #include <cassert>
 
 using namespace std;
 
+/*
+ * Compares ntHashJumpIterator with ntHashIterator on seq, skipping dist
+ * k-mers after every hit of a pattern of visits. The k-mers reached and
+ * passed over and their hash values must be those of ntHashIterator.
+ */
+static void compareJumpIterator(const string &seq, unsigned h, unsigned k,
+		size_t dist) {
+	vector<size_t> positions;
+	vector<vector<uint64_t> > hashes;
+	for (ntHashIterator itr(seq, h, k); itr != itr.end(); ++itr) {
+		positions.push_back(itr.pos());
+		hashes.push_back(vector<uint64_t>(*itr, *itr + h));
+	}
+	size_t i = 0;
+	unsigned step = 0;
+	ntHashJumpIterator itr(seq, h, k);
+	while (itr != itr.end()) {
+		assert(i < positions.size());
+		assert(itr.pos() == positions[i]);
+		assert(vector<uint64_t>(*itr, *itr + h) == hashes[i]);
+		if (++step % 3 == 0) {
+			const size_t target = itr.pos() + dist;
+			size_t lastPos = 0;
+			size_t passed = itr.skip(dist, lastPos);
+			size_t expected = 0;
+			while (i < positions.size() && positions[i] < target) {
+				++expected;
+				++i;
+			}
+			assert(passed == expected);
+			assert(lastPos == positions[i - 1]);
+		} else {
+			++itr;
+			++i;
+		}
+	}
+	assert(i == positions.size());
+}
+
 int main()
 {
 	std::vector<string> ss;
@@ -28,4 +69,15 @@ int main()
 
 	assert((*itr1)[0] == (*itr2)[1]);
 	assert((*itr1)[1] == (*itr2)[0]);
+
+	//short skips roll the hash, longer ones recompute it, and skips over Ns
+	//step through each k-mer
+	string seqN = "ACGTTGCANNACGGATCCATGCATGCAAGGTTNCCATGGACTAGNNNNNNNNNNNNN"
+			"TTACGGATCAGCATCGACTTACGATCNAGCTAGCTAGGATCGATCGA";
+	for (size_t dist = 1; dist <= 20; ++dist) {
+		compareJumpIterator(seqN, 4, 12, dist);
+		compareJumpIterator(seqN, 1, 5, dist);
+		compareJumpIterator(seqN, 3, 31, dist);
+	}
+	cerr << "ntHashJumpIterator tests done" << endl;
 }